@@ -46,6 +46,28 @@ namespace ChefDevr {
         template <typename Scalar>
         Matrix<Scalar> createZZt_centered(const char *fileDirectory, RowVector<Scalar> &meanBRDF);
 
+        /**
+        * @brief Creates a low rank factor V of the centered ZZt matrix (ZZt ~ V * V transposed) without building ZZt
+        * @param[in] fileDirectory the path of the directory where all the BRDFs are stored
+        * @param[in] rank the number of columns of V
+        * @param[out] meanBRDF The mean BRDF of the brdfs set
+        * @param[out] traceZZt The trace of the centered ZZt matrix (squared Frobenius norm of the centered Z)
+        * @param[in] powerIterations the number of power iterations refining the range of ZZt
+        * @return the n x rank factor V, with its columns sorted by decreasing norm
+        *
+        * Initializes the list of BRDFs filePaths and filenames in the order in which they were read.
+        *
+        * A randomised range finder : Z is read by blocks of coefficients of every BRDF, the first pass
+        * accumulates Z * Omega for a gaussian matrix Omega of rank + 10 columns, the mean BRDF and the squared norm of Z.
+        * Each power iteration is another pass accumulating Z * Zt * Q, where Q is an orthonormal basis of the last range.
+        * The columns of V are the Ritz vectors of ZZt in this range scaled by the square root of their Ritz values.
+        * Only n x (rank + 10) matrices and one block of coefficients are held in RAM.
+        */
+        template <typename Scalar>
+        Matrix<Scalar> createLowRankFactor_centered(const char *fileDirectory, unsigned int rank,
+                                                    RowVector<Scalar> &meanBRDF, Scalar &traceZZt,
+                                                    unsigned int powerIterations = 1);
+
         /**
          * @return the list of BRDF filenames in the order in which they were read
          */
@@ -98,6 +120,17 @@ namespace ChefDevr {
         template<typename Scalar>
         RowVector <Scalar> read_brdf(unsigned int index_brdf);
 
+        /**
+         * @brief Reads the same consecutive coefficients of all the BRDFs
+         * @param[out] block The matrix of the coefficients where each row represents a BRDF
+         * @param first Index of the first coefficient to read
+         * @param size Number of coefficients to read
+         *
+         * The files are read in parallel. If a file is not found, returns an error
+         */
+        template<typename Scalar>
+        void read_coefficient_block(Matrix<Scalar> &block, long first, long size);
+
         /* ------------*/
         /* Friends */
         /* ------------*/
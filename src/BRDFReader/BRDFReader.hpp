@@ -4,6 +4,12 @@
 
 #include "Parametrisation/MERLReader.h"
 
+#include <Eigen/Eigenvalues>
+#include <Eigen/QR>
+#include <algorithm>
+#include <exception>
+#include <random>
+
 
 namespace ChefDevr {
     using namespace Eigen;
@@ -64,6 +70,113 @@ namespace ChefDevr {
         return ZZt_centered;
     }
 
+    template <typename Scalar>
+    Matrix<Scalar> BRDFReader::createLowRankFactor_centered(const char *fileDirectory, const unsigned int rank,
+                                                            RowVector<Scalar> &meanBRDF, Scalar &traceZZt,
+                                                            const unsigned int powerIterations) {
+        // Number of values of a block of coefficients of all the BRDFs
+        constexpr long blockElements = 1L << 22;
+        constexpr long oversampling = 10;
+        // The gaussian matrix is drawn again with the same seed by every run
+        constexpr unsigned int seed = 5489u;
+
+        extract_brdfFilePaths(fileDirectory);
+
+        const long num_brdfs = brdf_filePaths.size();
+        const long num_coefficients = MERLReader::num_coefficientsBRDF;
+        const long blockSize = std::max(1L, blockElements / num_brdfs);
+        const long k = std::min(long(rank) + oversampling, num_brdfs);
+        const long r = std::min(long(rank), num_brdfs);
+
+        meanBRDF.resize(num_coefficients);
+        Matrix<Scalar> block;
+        Matrix<Scalar> omega;
+        Matrix<Scalar> Y{Matrix<Scalar>::Zero(num_brdfs, k)};
+        Scalar squaredNormZ{0};
+        mt19937 generator{seed};
+        normal_distribution<double> gaussian;
+
+        for (long first = 0; first < num_coefficients; first += blockSize) {
+            const long size = std::min(blockSize, num_coefficients - first);
+            read_coefficient_block(block, first, size);
+
+            meanBRDF.segment(first, size) = block.colwise().mean();
+            squaredNormZ += block.squaredNorm();
+
+            omega.resize(size, k);
+            for (long i = 0; i < size; ++i) {
+                for (long j = 0; j < k; ++j) {
+                    omega(i, j) = gaussian(generator);
+                }
+            }
+            Y.noalias() += block * omega;
+        }
+
+        // The centered Z is P * Z with P = I - 1 * 1t / n : P is applied to the n x k products only
+        traceZZt = squaredNormZ - Scalar(num_brdfs) * meanBRDF.squaredNorm();
+        Matrix<Scalar> Q;
+        Matrix<Scalar> centeredQ;
+        for (unsigned int iteration = 0; ; ++iteration) {
+            Y.rowwise() -= Y.colwise().mean();
+            Q = HouseholderQR<Matrix<Scalar>>{Y}.householderQ() * Matrix<Scalar>::Identity(num_brdfs, k);
+
+            // The centered ZZt times Q is P * Z * Zt * (P * Q)
+            centeredQ = Q.rowwise() - Q.colwise().mean();
+            Y.setZero();
+            for (long first = 0; first < num_coefficients; first += blockSize) {
+                const long size = std::min(blockSize, num_coefficients - first);
+                read_coefficient_block(block, first, size);
+                Y.noalias() += block * (block.transpose() * centeredQ);
+            }
+            Y.rowwise() -= Y.colwise().mean();
+            if (iteration == powerIterations) {
+                break;
+            }
+        }
+
+        // Rayleigh-Ritz projection of ZZt on the range of Q
+        const Matrix<Scalar> B{Q.transpose() * Y};
+        const SelfAdjointEigenSolver<Matrix<Scalar>> eigenSolver{Scalar(0.5) * (B + B.transpose())};
+        Matrix<Scalar> V{num_brdfs, r};
+        for (long j = 0; j < r; ++j) {
+            // The eigen values are sorted in increasing order
+            const long e = k - 1 - j;
+            Vector<Scalar> eigenVector{Q * eigenSolver.eigenvectors().col(e)};
+            long largest;
+            eigenVector.cwiseAbs().maxCoeff(&largest);
+            if (eigenVector[largest] < 0) {
+                eigenVector = -eigenVector;
+            }
+            V.col(j) = eigenVector * sqrt(std::max(eigenSolver.eigenvalues()[e], Scalar(0)));
+        }
+        return V;
+    }
+
+    template<typename Scalar>
+    void BRDFReader::read_coefficient_block(Matrix<Scalar> &block, const long first, const long size) {
+        const long num_brdfs = brdf_filePaths.size();
+        Eigen::Matrix<double, Dynamic, Dynamic, RowMajor> coefficients{num_brdfs, size};
+        // Exceptions cannot leave a parallel region : the first one is thrown after it
+        exception_ptr readError;
+
+#pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < num_brdfs; ++i) {
+            try {
+                MERLReader::read_brdf_coefficients(brdf_filePaths[i].c_str(), first, size, coefficients.row(i).data());
+            }
+            catch (...) {
+#pragma omp critical
+                if (!readError) {
+                    readError = current_exception();
+                }
+            }
+        }
+        if (readError) {
+            rethrow_exception(readError);
+        }
+        block = coefficients.template cast<Scalar>();
+    }
+
     template<typename Scalar>
     RowVector <Scalar> BRDFReader::read_brdf(unsigned int index_brdf) {
         const char* path(brdf_filePaths[index_brdf].c_str());
@@ -1,6 +1,7 @@
 #include "Albedo.h"
 #include <cmath>
 
+#include "Parametrisation/Reduction.h"
 #include "Parametrisation/MERLReader.h"
 
 
@@ -31,40 +32,42 @@ namespace ChefDevr
         const double normalizeIrradiance(1./(thnum*thnum*phnum*phnum*M_PI));
         const double thstep = 0.5 * M_PI / num_sampling;
         const double phstep = 2.0 * M_PI / phnum;
-        #pragma omp parallel reduction(+:r,g,b)
+        // One term per incident theta, computed from its index and not accumulated by each thread.
+        // The terms are added in an order that does not depend on the number of threads
+        const Eigen::Array3d rgb(deterministicSum<Eigen::Array3d>(thnum, [&](const long thindex)
         {
-            unsigned int thondex, thindex, phondex, phindex;
-            double tho(0), thi(0), pho(0), phi(0);
-            double costhi(0), coscos(0);
+            unsigned int thondex, phondex, phindex;
+            double tho(0), pho(0), phi(0);
+            double coscos(0);
             double red, green, blue;
-            #pragma omp for
-            for (thindex=0; thindex < thnum; ++thindex)
+            Eigen::Array3d sum(Eigen::Array3d::Zero());
+            const double thi((thindex + 1) * thstep);
+            const double costhi(std::cos(thi));
+            for (phindex=0; phindex < phnum; ++phindex)
             {
-                thi += thstep;
-                costhi = std::cos(thi);
-                for (phindex=0; phindex < phnum; ++phindex)
+                phi += phstep;
+                for (thondex=0; thondex < thnum; ++thondex)
                 {
-                    phi += phstep;
-                    for (thondex=0; thondex < thnum; ++thondex)
+                    tho += thstep;
+                    coscos = costhi * std::cos(tho);
+                    for (phondex=0; phondex < phnum; ++phondex)
                     {
-                        tho += thstep;
-                        coscos = costhi * std::cos(tho);
-                        for (phondex=0; phondex < phnum; ++phondex)
-                        {
-                            pho += phstep;
+                        pho += phstep;
 
-                            MERLReader::lookup_brdf_val(brdf, thi, phi, tho, pho, red, green, blue);
-                            r += red*coscos;
-                            g += green*coscos;
-                            b += blue*coscos;
-                        }
-                        pho = 0.0;
+                        MERLReader::lookup_brdf_val(brdf, thi, phi, tho, pho, red, green, blue);
+                        sum[0] += red*coscos;
+                        sum[1] += green*coscos;
+                        sum[2] += blue*coscos;
                     }
-                    tho = 0.0;
+                    pho = 0.0;
                 }
-                phi = 0.0;
+                tho = 0.0;
             }
-        }
+            return sum;
+        }, Eigen::Array3d(Eigen::Array3d::Zero()), 1));
+        r = rgb[0];
+        g = rgb[1];
+        b = rgb[2];
         r = std::min(r*normalizeIrradiance, 1.);
         g = std::min(g*normalizeIrradiance, 1.);
         b = std::min(b*normalizeIrradiance, 1.);
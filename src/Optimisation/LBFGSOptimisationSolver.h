@@ -0,0 +1,168 @@
+#ifndef LBFGSOPTIMISATIONSOLVER_H
+#define LBFGSOPTIMISATIONSOLVER_H
+
+/**
+ * @file LBFGSOptimisationSolver.h
+ */
+
+#include "OptimisationSolver.h"
+#include "../../tests/OptimisationTest.h"
+
+#include <deque>
+
+
+namespace ChefDevr
+{
+    /**
+     * @brief Solves the same optimisation problem as OptimisationSolver
+     * with a gradient based method : L-BFGS with box constraints (L-BFGS-B)
+     * @tparam Scalar The type of scalar number to do computations with.
+     * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+     *
+     * The latent coordinates are constrained in [-1; 1].
+     * The gradient of the cost function is computed analytically :
+     * d(cost)/dK = 0.5 * (D * K_minus1 - K_minus1 * ZZt * K_minus1)
+     * where D is the number of BRDF coefficients.
+     *
+     * Each iteration is reported to the observers as a sweep : its step is the length of the line search step,
+     * its accepted and rejected moves are the accepted and backtracked trial points.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class LBFGSOptimisationSolver : public OptimisationSolver<Scalar, Dim> {
+    public:
+
+        /**
+         * @brief Constructor
+         * @param num_BRDFCoefficients Number of coefficients of each BRDF
+         * @param tolerance Value of the projected gradient infinity norm below which solution is considered optimal
+         * @param ZZt Z * (Z transposed) where Z is the centered BRDF data matrix (BRDFs stored in row major)
+         * @param latentDim Dimension of optimised latent space
+         * @param maxIterations Maximum number of iterations
+         * @param historySize Number of corrections kept to approximate the inverse hessian
+         * @param mu Value of the mu constant of the covariance function
+         * @param l Value of the l constant of the covariance function
+         */
+        LBFGSOptimisationSolver(
+            long num_BRDFCoefficients,
+            Scalar tolerance,
+            const Matrix<Scalar>& ZZt,
+            unsigned int latentDim,
+            unsigned int maxIterations = 1000,
+            unsigned int historySize = 10,
+            Scalar mu = MU_DEFAULT,
+            Scalar l = L_DEFAULT);
+
+        ~LBFGSOptimisationSolver() = default;
+
+        /**
+         * @brief Computes the optimized parametrisation of the BRDFs manifold.
+         * Uses L-BFGS-B method to solve the optimisation
+         */
+        void optimizeMapping () override;
+
+    private:
+
+        using OptimisationSolver<Scalar, Dim>::step0;
+        using OptimisationSolver<Scalar, Dim>::step;
+        using OptimisationSolver<Scalar, Dim>::nb_data;
+        using OptimisationSolver<Scalar, Dim>::num_BRDFCoefficients;
+        using OptimisationSolver<Scalar, Dim>::ZZt;
+        using OptimisationSolver<Scalar, Dim>::latentDim;
+        using OptimisationSolver<Scalar, Dim>::dimension;
+        using OptimisationSolver<Scalar, Dim>::mu;
+        using OptimisationSolver<Scalar, Dim>::l;
+        using OptimisationSolver<Scalar, Dim>::X;
+        using OptimisationSolver<Scalar, Dim>::K_minus1;
+        using OptimisationSolver<Scalar, Dim>::K;
+        using OptimisationSolver<Scalar, Dim>::detK;
+        using OptimisationSolver<Scalar, Dim>::costval;
+        using OptimisationSolver<Scalar, Dim>::cost;
+        using OptimisationSolver<Scalar, Dim>::invertCovariance;
+        using OptimisationSolver<Scalar, Dim>::initX;
+        using OptimisationSolver<Scalar, Dim>::sweepStats;
+        using OptimisationSolver<Scalar, Dim>::startPhase;
+        using OptimisationSolver<Scalar, Dim>::endPhase;
+        using OptimisationSolver<Scalar, Dim>::notifySweep;
+        using OptimisationSolver<Scalar, Dim>::stopRequested;
+        using OptimisationSolver<Scalar, Dim>::initialX;
+
+        /**
+         * @brief Value of the projected gradient infinity norm below which solution is considered optimal
+         */
+        const Scalar tolerance;
+
+        /**
+         * @brief Maximum number of iterations
+         */
+        const unsigned int maxIterations;
+
+        /**
+         * @brief Number of corrections kept to approximate the inverse hessian
+         */
+        const unsigned int historySize;
+
+        /**
+         * @brief Lower bound of the latent coordinates
+         */
+        static constexpr Scalar lowerBound = -1.f;
+
+        /**
+         * @brief Upper bound of the latent coordinates
+         */
+        static constexpr Scalar upperBound = 1.f;
+
+        /**
+         * @brief Computes K, K_minus1, detK and the cost for the latent variables X
+         * @param X Latent variables vector
+         * @param K_minus1 Inverse mapping matrix to fill
+         * @param detK Determinant of K to fill
+         * @param costValue Value of the cost to fill
+         *
+         * K is stored in OptimisationSolver::K
+         */
+        void evaluate (
+            const Vector<Scalar>& X,
+            Matrix<Scalar>& K_minus1,
+            Scalar& detK,
+            Scalar& costValue);
+
+        /**
+         * @brief Computes the gradient of the cost function with respect to the latent variables
+         * @param grad The gradient to fill
+         * @param X Latent variables vector
+         * @param K Covariance matrix of X
+         * @param K_minus1 Inverse of K (complete matrix)
+         */
+        void gradient (
+            Vector<Scalar>& grad,
+            const Vector<Scalar>& X,
+            const Matrix<Scalar>& K,
+            const Matrix<Scalar>& K_minus1) const;
+
+        /**
+         * @brief Computes the search direction with the L-BFGS two-loop recursion
+         * restricted to the variables that are not blocked on a bound
+         * @param direction The search direction to fill
+         * @param grad Gradient of the cost function
+         * @param freeMask Mask of the free variables (1 if free, 0 otherwise)
+         * @param S History of the latent variables differences
+         * @param Y History of the gradient differences
+         */
+        void searchDirection (
+            Vector<Scalar>& direction,
+            const Vector<Scalar>& grad,
+            const Vector<Scalar>& freeMask,
+            const std::deque<Vector<Scalar>>& S,
+            const std::deque<Vector<Scalar>>& Y) const;
+
+        /* ------------*/
+        /* Friends */
+        /* ------------*/
+
+        friend OptimisationTest;
+    };
+} // namespace ChefDevr
+
+#include "LBFGSOptimisationSolver.hpp"
+
+#endif // LBFGSOPTIMISATIONSOLVER_H
@@ -0,0 +1,205 @@
+#include "LBFGSOptimisationSolver.h"
+
+/**
+ * @file LBFGSOptimisationSolver.hpp
+ */
+
+#include <cmath>
+#include <limits>
+
+namespace ChefDevr
+{
+    template <typename Scalar, int Dim>
+    LBFGSOptimisationSolver<Scalar, Dim>::LBFGSOptimisationSolver(
+        const long num_BRDFCoefficients,
+        const Scalar _tolerance,
+        const Matrix<Scalar>& _ZZt,
+        const unsigned int _latentDim,
+        const unsigned int _maxIterations,
+        const unsigned int _historySize,
+        const Scalar _mu,
+        const Scalar _l) :
+        OptimisationSolver<Scalar, Dim>(num_BRDFCoefficients, Scalar(0), _ZZt, _latentDim, _mu, _l),
+        tolerance(_tolerance),
+        maxIterations(_maxIterations),
+        historySize(_historySize){}
+
+    template <typename Scalar, int Dim>
+    void LBFGSOptimisationSolver<Scalar, Dim>::optimizeMapping ()
+    {
+        // Sufficient decrease constant of the line search (Armijo condition)
+        const Scalar c1(1e-4);
+        // Relative decrease of the cost below which the optimisation stops
+        const Scalar relativeDecrease(1e7 * std::numeric_limits<Scalar>::epsilon());
+        const unsigned int maxLineSearch(30);
+        const long nbcoefs(latentDim*nb_data);
+
+        Vector<Scalar> new_X(nbcoefs), grad(nbcoefs), new_grad(nbcoefs);
+        Vector<Scalar> direction(nbcoefs), freeMask(nbcoefs);
+        Matrix<Scalar> new_K_minus1(nb_data, nb_data);
+        Scalar new_costval, new_detK, slope, t;
+        std::deque<Vector<Scalar>> S, Y;
+        bool accepted;
+
+        // Init X
+        if (initialX.size() == X.size())
+        {
+            X = initialX;
+        }
+        else
+        {
+            initX(ZZt);
+        }
+        evaluate(X, K_minus1, detK, costval);
+        gradient(grad, X, K, K_minus1);
+        sweepStats = SweepEvent<Scalar>();
+        sweepStats.inversions = 1;
+
+        for (unsigned int iteration(0); iteration < maxIterations && !stopRequested; ++iteration)
+        {
+            startPhase();
+            // Variables blocked on a bound by the gradient are fixed
+            for (long i(0); i < nbcoefs; ++i)
+            {
+                freeMask[i] = ((X[i] <= lowerBound && grad[i] > Scalar(0)) ||
+                           (X[i] >= upperBound && grad[i] < Scalar(0))) ? Scalar(0) : Scalar(1);
+            }
+            if (grad.cwiseProduct(freeMask).cwiseAbs().maxCoeff() < tolerance)
+            {
+                break;
+            }
+
+            searchDirection(direction, grad, freeMask, S, Y);
+            slope = grad.dot(direction);
+            if (!(slope < Scalar(0)))
+            {
+                // Not a descent direction : restart from the projected steepest descent
+                S.clear();
+                Y.clear();
+                direction = -grad.cwiseProduct(freeMask);
+            }
+
+            // Without history the first trial moves the coordinates by at most step0
+            t = S.empty() ? std::min(Scalar(1), step0 / direction.cwiseAbs().maxCoeff()) : Scalar(1);
+
+            // Backtracking line search along the projected path
+            accepted = false;
+            for (unsigned int i(0); i < maxLineSearch && !accepted; ++i)
+            {
+                new_X = (X + t*direction).cwiseMax(Scalar(lowerBound)).cwiseMin(Scalar(upperBound));
+                evaluate(new_X, new_K_minus1, new_detK, new_costval);
+                accepted = new_costval <= costval + c1 * grad.dot(new_X - X);
+                ++sweepStats.inversions;
+                if (accepted)
+                {
+                    ++sweepStats.acceptedMoves;
+                }
+                else
+                {
+                    ++sweepStats.rejectedMoves;
+                }
+                t *= Scalar(0.5);
+            }
+            if (!accepted)
+            {
+                break;
+            }
+            // Reported as the step of the sweep
+            step = Scalar(2) * t;
+
+            // K holds the covariance matrix of new_X
+            gradient(new_grad, new_X, K, new_K_minus1);
+
+            S.push_back(new_X - X);
+            Y.push_back(new_grad - grad);
+            // Keep the inverse hessian approximation positive definite
+            if (S.back().dot(Y.back()) <= std::numeric_limits<Scalar>::epsilon() * Y.back().squaredNorm())
+            {
+                S.pop_back();
+                Y.pop_back();
+            }
+            if (S.size() > historySize)
+            {
+                S.pop_front();
+                Y.pop_front();
+            }
+
+            const bool converged(costval - new_costval <= relativeDecrease * abs(costval));
+            X.swap(new_X);
+            K_minus1.swap(new_K_minus1);
+            grad.swap(new_grad);
+            detK = new_detK;
+            costval = new_costval;
+            sweepStats.exploratoryTime = endPhase();
+            notifySweep();
+            if (converged)
+            {
+                break;
+            }
+        }
+    }
+
+    template <typename Scalar, int Dim>
+    void LBFGSOptimisationSolver<Scalar, Dim>::evaluate (
+        const Vector<Scalar>& X,
+        Matrix<Scalar>& K_minus1,
+        Scalar& detK,
+        Scalar& costValue)
+    {
+        computeCovMatrix<Scalar, Dim>(K, X, dimension(), mu, l);
+        K_minus1 = K;
+        invertCovariance(K_minus1, detK);
+        cost(costValue, K_minus1, detK);
+    }
+
+    template <typename Scalar, int Dim>
+    void LBFGSOptimisationSolver<Scalar, Dim>::gradient (
+        Vector<Scalar>& grad,
+        const Vector<Scalar>& X,
+        const Matrix<Scalar>& K,
+        const Matrix<Scalar>& K_minus1) const
+    {
+        // H = (D * K_minus1 - K_minus1 * ZZt * K_minus1) o K
+        const Matrix<Scalar> Km1_ZZt(K_minus1 * ZZt);
+        Matrix<Scalar> H(Scalar(num_BRDFCoefficients) * K_minus1);
+        H.noalias() -= Km1_ZZt * K_minus1;
+        H = H.cwiseProduct(K);
+
+        // d(cost)/d(x_ic) = -1/l^2 * sum_j H_ij * (x_ic - x_jc)
+        const Eigen::Map<const Eigen::Matrix<Scalar, Dim, Eigen::Dynamic>> Xt(X.data(), dimension(), nb_data);
+        Eigen::Map<Eigen::Matrix<Scalar, Dim, Eigen::Dynamic>> gradt(grad.data(), dimension(), nb_data);
+        const Vector<Scalar> Hsum(H.rowwise().sum());
+        gradt.noalias() = Xt * H;
+        gradt = (gradt - Xt * Hsum.asDiagonal()) / (l*l);
+    }
+
+    template <typename Scalar, int Dim>
+    void LBFGSOptimisationSolver<Scalar, Dim>::searchDirection (
+        Vector<Scalar>& direction,
+        const Vector<Scalar>& grad,
+        const Vector<Scalar>& freeMask,
+        const std::deque<Vector<Scalar>>& S,
+        const std::deque<Vector<Scalar>>& Y) const
+    {
+        const unsigned int m(S.size());
+        std::vector<Scalar> alpha(m), rho(m);
+
+        direction = grad.cwiseProduct(freeMask);
+        for (unsigned int i(m); i-- > 0;)
+        {
+            rho[i] = Scalar(1) / Y[i].dot(S[i]);
+            alpha[i] = rho[i] * S[i].dot(direction);
+            direction -= alpha[i] * Y[i].cwiseProduct(freeMask);
+        }
+        if (m > 0)
+        {
+            direction *= S[m-1].dot(Y[m-1]) / Y[m-1].squaredNorm();
+        }
+        for (unsigned int i(0); i < m; ++i)
+        {
+            const Scalar beta(rho[i] * Y[i].dot(direction));
+            direction += (alpha[i] - beta) * S[i].cwiseProduct(freeMask);
+        }
+        direction = -direction.cwiseProduct(freeMask);
+    }
+} // namespace ChefDevr
@@ -0,0 +1,275 @@
+#ifndef MULTISTARTOPTIMISATION_H
+#define MULTISTARTOPTIMISATION_H
+
+/**
+ * @file MultiStartOptimisation.h
+ */
+
+#include "OptimisationSolver.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace ChefDevr
+{
+    /**
+     * @brief Runs several OptimisationSolver concurrently from different starting points
+     * and keeps the solution of lowest cost
+     * @tparam Scalar The type of scalar number to do computations with.
+     * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+     *
+     * The first start is the PCA initialisation of OptimisationSolver.
+     * The other ones are the PCA initialisation plus a gaussian perturbation,
+     * or uniformly random latent variables.
+     * All the solvers share the same ZZt. Each run is stopped by its own criteria only,
+     * unless the early stop is enabled (see setEarlyStop).
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class MultiStartOptimisation {
+    public:
+
+        /**
+         * @brief Constructor
+         * @param num_BRDFCoefficients Number of coefficients of each BRDF
+         * @param minStep Step below which solution is considered optimal
+         * @param ZZt Z * (Z transposed) where Z is the centered BRDF data matrix (BRDFs stored in row major).
+         * It is shared by the solvers and must outlive them
+         * @param latentDim Dimension of optimised latent space
+         * @param nbStarts Number of runs
+         * @param nbRandomStarts Number of runs that start from uniformly random latent variables
+         * @param perturbation Standard deviation of the perturbation of the PCA initialisation
+         * @param seed Seed of the random starting points
+         * @param mu Value of the mu constant of the covariance function
+         * @param l Value of the l constant of the covariance function
+         */
+        MultiStartOptimisation(
+            long num_BRDFCoefficients,
+            Scalar minStep,
+            const Matrix<Scalar>& ZZt,
+            unsigned int latentDim,
+            unsigned int nbStarts,
+            unsigned int nbRandomStarts = 0,
+            Scalar perturbation = Scalar(0.1),
+            unsigned int seed = 0,
+            Scalar mu = MU_DEFAULT,
+            Scalar l = L_DEFAULT);
+
+        /**
+         * @brief Runs the optimisations concurrently
+         */
+        void optimizeMapping ();
+
+        /**
+         * @brief Sets the number of threads of each run
+         * @param threads Number of threads (all the available threads divided by the number of runs by default)
+         */
+        inline void setThreadsPerStart (unsigned int threads) { threadsPerStart = std::max(threads, 1u); }
+
+        /**
+         * @brief Sets the early stop (disabled by default)
+         * @param margin A run is stopped when its cost at the end of a sweep exceeds the best cost reached
+         * by any run at the end of a sweep of the same step by more than margin times the absolute value
+         * of this best cost (negative to disable)
+         * @param minSweeps Number of sweeps before a run can be stopped
+         *
+         * The runs are compared at equal steps, so that runs following different step schedules
+         * (see setAdaptiveStep and setActiveSet) are compared at the same resolution of the search.
+         * A run that is behind can still converge to a lower cost with smaller steps :
+         * the margin bounds how far behind a run may be before it is given up.
+         */
+        inline void setEarlyStop (Scalar margin, unsigned int minSweeps = 3) { stopMargin = margin; stopMinSweeps = minSweeps; }
+
+        /**
+         * @brief Sets the number of coordinates evaluated concurrently by every run (see OptimisationSolver::setSpeculativeBatch)
+         */
+        inline void setSpeculativeBatch (unsigned int batch)
+        {
+            for (auto& solver : solvers)
+            {
+                solver->setSpeculativeBatch(batch);
+            }
+        }
+        
+        /**
+         * @brief Sets the stopping criteria of every run (see OptimisationSolver::setStoppingCriteria)
+         */
+        inline void setStoppingCriteria (Scalar relativeDecrease, unsigned int maxSweeps, double timeBudget)
+        {
+            for (auto& solver : solvers)
+            {
+                solver->setStoppingCriteria(relativeDecrease, maxSweeps, timeBudget);
+            }
+        }
+
+        /**
+         * @brief Sets the step policy of every run (see OptimisationSolver::setAdaptiveStep)
+         */
+        inline void setAdaptiveStep (bool adaptive, Scalar expansion = Scalar(2), Scalar failureReduction = Scalar(.25))
+        {
+            for (auto& solver : solvers)
+            {
+                solver->setAdaptiveStep(adaptive, expansion, failureReduction);
+            }
+        }
+
+        /**
+         * @brief Sets the active set of every run (see OptimisationSolver::setActiveSet)
+         */
+        inline void setActiveSet (unsigned int revisitPeriod, unsigned int failureThreshold = 2, Scalar nearMove = Scalar(1e-9))
+        {
+            for (auto& solver : solvers)
+            {
+                solver->setActiveSet(revisitPeriod, failureThreshold, nearMove);
+            }
+        }
+
+        /**
+         * @brief Sets the drift monitor of every run (see OptimisationSolver::setDriftMonitor)
+         */
+        inline void setDriftMonitor (unsigned int probeInterval, Scalar tolerance, unsigned int nbProbes = 2)
+        {
+            for (auto& solver : solvers)
+            {
+                solver->setDriftMonitor(probeInterval, tolerance, nbProbes);
+            }
+        }
+
+        /**
+         * @return A reference of the latent variables vector of the best run
+         */
+        inline const Vector<Scalar>& getLatentVariables() const { return solvers[best]->getLatentVariables(); }
+
+        /**
+         * @return A reference of the inverse mapping matrix of the best run
+         */
+        inline const Matrix<Scalar>& getInverseMapping() const { return solvers[best]->getInverseMapping(); }
+
+        /**
+         * @return A reference of the value of the cost function for the best run
+         */
+        inline const Scalar& getCostValue() const { return solvers[best]->getCostValue(); }
+
+        /**
+         * @return The index of the run of lowest cost
+         */
+        inline unsigned int getBestStart() const { return best; }
+
+        /**
+         * @param start Index of a run
+         * @return The final cost of the run
+         */
+        inline const Scalar& getCostValue(unsigned int start) const { return solvers[start]->getCostValue(); }
+
+        /**
+         * @param start Index of a run
+         * @return True if the run has been stopped before convergence
+         */
+        inline bool wasStopped(unsigned int start) const { return stopped[start]; }
+
+        /**
+         * @brief Gives the ownership of the solver of the best run to the caller
+         * @return The solver of the best run (must be deleted by the caller)
+         *
+         * The other getters cannot be called anymore
+         */
+        OptimisationSolver<Scalar, Dim>* releaseBestSolver ();
+
+    private:
+
+        /**
+         * @brief Reports the end of the sweeps of a run to the driver
+         */
+        class TrajectoryObserver : public OptimisationObserver<Scalar>
+        {
+        public:
+            TrajectoryObserver (MultiStartOptimisation& _driver, unsigned int _start) :
+                driver(_driver), start(_start){}
+
+            void onSweep (const SweepEvent<Scalar>& event) override { driver.compareTrajectory(start, event); }
+
+        private:
+            MultiStartOptimisation& driver;
+            const unsigned int start;
+        };
+
+        /**
+         * @brief Z*Ztransposed
+         */
+        const Matrix<Scalar>& ZZt;
+
+        /**
+         * @brief Number of runs that start from uniformly random latent variables
+         */
+        const unsigned int nbRandomStarts;
+
+        /**
+         * @brief Standard deviation of the perturbation of the PCA initialisation
+         */
+        const Scalar perturbation;
+
+        /**
+         * @brief Seed of the random starting points
+         */
+        const unsigned int seed;
+
+        /**
+         * @brief Number of threads of each run
+         */
+        unsigned int threadsPerStart;
+
+        /**
+         * @brief Relative margin of the early stop (negative when disabled)
+         */
+        Scalar stopMargin;
+
+        /**
+         * @brief Number of sweeps before a run can be stopped
+         */
+        unsigned int stopMinSweeps;
+
+        /**
+         * @brief Solvers of the runs
+         */
+        std::vector<std::unique_ptr<OptimisationSolver<Scalar, Dim>>> solvers;
+
+        /**
+         * @brief Observers of the runs
+         */
+        std::vector<std::unique_ptr<TrajectoryObserver>> observers;
+
+        /**
+         * @brief Best cost reached by any run at the end of a sweep of each step
+         */
+        std::map<Scalar, Scalar> bestCostAtStep;
+
+        /**
+         * @brief 1 if the run has been stopped before convergence
+         */
+        std::vector<char> stopped;
+
+        /**
+         * @brief Protects bestCostAtStep and stopped
+         */
+        std::mutex trajectoryMutex;
+
+        /**
+         * @brief Index of the run of lowest cost
+         */
+        unsigned int best;
+
+        /**
+         * @brief Records the cost of a run after a sweep and, with the early stop,
+         * stops the run if it is too far behind the other runs at the same step
+         * @param start Index of the run
+         * @param event Summary of the sweep
+         */
+        void compareTrajectory (unsigned int start, const SweepEvent<Scalar>& event);
+    };
+} // namespace ChefDevr
+
+#include "MultiStartOptimisation.hpp"
+
+#endif // MULTISTARTOPTIMISATION_H
@@ -0,0 +1,130 @@
+#include "MultiStartOptimisation.h"
+
+/**
+ * @file MultiStartOptimisation.hpp
+ */
+
+#include <algorithm>
+#include <random>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace ChefDevr
+{
+    template <typename Scalar, int Dim>
+    MultiStartOptimisation<Scalar, Dim>::MultiStartOptimisation(
+        const long num_BRDFCoefficients,
+        const Scalar minStep,
+        const Matrix<Scalar>& _ZZt,
+        const unsigned int latentDim,
+        const unsigned int nbStarts,
+        const unsigned int _nbRandomStarts,
+        const Scalar _perturbation,
+        const unsigned int _seed,
+        const Scalar mu,
+        const Scalar l) :
+        ZZt(_ZZt),
+        nbRandomStarts(_nbRandomStarts),
+        perturbation(_perturbation),
+        seed(_seed),
+        threadsPerStart(1),
+        stopMargin(Scalar(-1)),
+        stopMinSweeps(3),
+        stopped(std::max(nbStarts, 1u), 0),
+        best(0)
+    {
+        #ifdef _OPENMP
+        threadsPerStart = std::max(omp_get_max_threads() / int(stopped.size()), 1);
+        #endif
+        for (unsigned int i = 0; i < stopped.size(); ++i)
+        {
+            solvers.emplace_back(new OptimisationSolver<Scalar, Dim>(num_BRDFCoefficients, minStep, ZZt, latentDim, mu, l));
+            observers.emplace_back(new TrajectoryObserver(*this, i));
+            solvers[i]->addObserver(observers[i].get());
+        }
+    }
+
+    template <typename Scalar, int Dim>
+    void MultiStartOptimisation<Scalar, Dim>::optimizeMapping ()
+    {
+        const int nbStarts(solvers.size());
+        // The pattern search keeps the latent coordinates in ]-1; 1[
+        const double bound(1. - 1e-3);
+        std::mt19937 generator(seed);
+        std::normal_distribution<double> normal(0., double(perturbation));
+        std::uniform_real_distribution<double> uniform(-bound, bound);
+
+        // Starting points
+        solvers[0]->initX(ZZt);
+        const Vector<Scalar> pca(solvers[0]->X);
+        solvers[0]->setInitialLatentVariables(pca);
+        for (int i = 1; i < nbStarts; ++i)
+        {
+            Vector<Scalar> X0(pca.rows());
+            const bool random(i >= nbStarts - int(nbRandomStarts));
+            for (long j = 0; j < X0.rows(); ++j)
+            {
+                X0[j] = random ? Scalar(uniform(generator)) :
+                        std::min(std::max(pca[j] + Scalar(normal(generator)), Scalar(-bound)), Scalar(bound));
+            }
+            solvers[i]->setInitialLatentVariables(X0);
+        }
+
+        bestCostAtStep.clear();
+        std::fill(stopped.begin(), stopped.end(), 0);
+
+        #ifdef _OPENMP
+        // Each run parallelises its own computations with threadsPerStart threads
+        const int maxActiveLevels(omp_get_max_active_levels());
+        omp_set_max_active_levels(std::max(maxActiveLevels, 2));
+        #endif
+        # pragma omp parallel for num_threads(nbStarts) schedule(dynamic, 1)
+        for (int i = 0; i < nbStarts; ++i)
+        {
+            #ifdef _OPENMP
+            omp_set_num_threads(threadsPerStart);
+            #endif
+            solvers[i]->optimizeMapping();
+        }
+        #ifdef _OPENMP
+        omp_set_max_active_levels(maxActiveLevels);
+        #endif
+
+        best = 0;
+        for (int i = 1; i < nbStarts; ++i)
+        {
+            if (solvers[i]->getCostValue() < solvers[best]->getCostValue())
+            {
+                best = i;
+            }
+        }
+    }
+
+    template <typename Scalar, int Dim>
+    void MultiStartOptimisation<Scalar, Dim>::compareTrajectory (const unsigned int start, const SweepEvent<Scalar>& event)
+    {
+        std::lock_guard<std::mutex> lock(trajectoryMutex);
+        // The steps are the initial step times powers of the step factors : equal steps compare exactly
+        const auto inserted(bestCostAtStep.emplace(event.step, event.cost));
+        Scalar& bestCost(inserted.first->second);
+        if (inserted.second || event.cost < bestCost)
+        {
+            bestCost = event.cost;
+        }
+        else if (stopMargin >= Scalar(0) && event.sweep + 1 >= stopMinSweeps &&
+                 event.cost > bestCost + stopMargin * abs(bestCost))
+        {
+            stopped[start] = 1;
+            solvers[start]->requestStop();
+        }
+    }
+
+    template <typename Scalar, int Dim>
+    OptimisationSolver<Scalar, Dim>* MultiStartOptimisation<Scalar, Dim>::releaseBestSolver ()
+    {
+        // The observer of the run is owned by the driver
+        solvers[best]->observers.clear();
+        return solvers[best].release();
+    }
+} // namespace ChefDevr
@@ -0,0 +1,45 @@
+#ifndef OPTI_DATA_READER__H
+#define OPTI_DATA_READER__H
+
+/**
+* @file OptiDataReader.h
+* @brief Provides the functions to read back the latent space data written by OptiDataWriter,
+* so that BRDFs can be reconstructed without optimising the parametrisation again
+*/
+
+#include "Parametrisation/types.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace ChefDevr
+{
+    /**
+    * @brief Reads the data that defines a parametrisation (see writeParametrisationData for the file format)
+    * @param path Path of the file
+    * @param[out] brdfsFilenames List of the BRDF files used for the parametrisation, in the order of the latent variables
+    * @param[out] X Latent variables vector
+    * @param[out] K_minus1 Inverse mapping matrix
+    * @return The dimension of the latent space
+    *
+    * Throws a ParametrisationDataError if the file cannot be read or is not consistent
+    */
+    template <typename Scalar>
+    unsigned int readParametrisationData (
+        const std::string& path,
+        std::vector<std::string>& brdfsFilenames,
+        Vector<Scalar>& X,
+        Matrix<Scalar>& K_minus1);
+
+    class ParametrisationDataError : public std::runtime_error {
+    public:
+        explicit ParametrisationDataError(const std::string& msg) :
+                std::runtime_error(msg){}
+    };
+} // ChefDevr
+
+#include "OptiDataReader.hpp"
+
+#endif // OPTI_DATA_READER__H
@@ -0,0 +1,71 @@
+#include <fstream>
+#include <sstream>
+
+/**
+ * @file OptiDataReader.hpp
+ */
+
+namespace ChefDevr
+{
+    template <typename Scalar>
+    unsigned int readParametrisationData (
+        const std::string& path,
+        std::vector<std::string>& brdfsFilenames,
+        Vector<Scalar>& X,
+        Matrix<Scalar>& K_minus1)
+    {
+        std::ifstream file(path);
+        if (!file.is_open()){
+            throw ParametrisationDataError{"Could not open file \"" + path + "\""};
+        }
+
+        // The comment lines are skipped, the values are then read in the order they were written
+        std::stringstream values;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] != '#')
+            {
+                values << line << '\n';
+            }
+        }
+
+        long rows, cols;
+        values >> rows >> cols;
+        if (!values || rows <= 0 || rows != cols)
+        {
+            throw ParametrisationDataError{"The inverse mapping matrix of \"" + path + "\" is not square"};
+        }
+        K_minus1.resize(rows, cols);
+        for (long i(0); i < rows; ++i)
+        {
+            for (long j(0); j < cols; ++j)
+            {
+                values >> K_minus1(i, j);
+            }
+        }
+
+        long nbLVars;
+        unsigned int latentDim;
+        values >> nbLVars >> latentDim;
+        if (!values || nbLVars != rows || latentDim == 0)
+        {
+            throw ParametrisationDataError{"The latent variables of \"" + path + "\" do not match the inverse mapping matrix"};
+        }
+        brdfsFilenames.resize(nbLVars);
+        X.resize(nbLVars * latentDim);
+        for (long ivar(0); ivar < nbLVars; ++ivar)
+        {
+            values >> brdfsFilenames[ivar];
+            for (unsigned int c(0); c < latentDim; ++c)
+            {
+                values >> X[ivar*latentDim + c];
+            }
+        }
+        if (!values)
+        {
+            throw ParametrisationDataError{"The file \"" + path + "\" is truncated"};
+        }
+        return latentDim;
+    }
+} // namespace ChefDevr
@@ -53,16 +53,22 @@ namespace ChefDevr
     * @param height Height of the image in number of pixels
     * @param latentWidth Width of the plotted latent space (centered on 0)
     * @param latentHeight Height of the plotted latent space (centered on 0)
+    * @param batchSize Number of pixels reconstructed together
+    *
+    * The pixels are reconstructed by batches (see BRDFReconstructor::reconstructBatch) :
+    * the model is read once per batch instead of once per pixel,
+    * at the cost of holding batchSize reconstructed BRDFs in memory.
     */
-    template <typename Scalar>
+    template <typename Scalar, int Dim>
     void writeAlbedoMap(
         const std::string& path,
-        const BRDFReconstructor<Scalar>* reconstructor,
+        const BRDFReconstructor<Scalar, Dim>* reconstructor,
         unsigned int albedoSampling = 4,
         unsigned int width = 16,
         unsigned int height = 16,
         double latentWidth = 3.,
-        double latentHeight = 3);
+        double latentHeight = 3,
+        unsigned int batchSize = 8);
     
     /**
     * @brief Writes the data that defines the parametrisation (without Z)
@@ -3,6 +3,7 @@
 #include "Parametrisation/Parametrisation.h"
 #include "bitmap_image.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <cmath>
@@ -50,15 +51,16 @@ namespace ChefDevr
     }
     */
     
-    template <typename Scalar>
+    template <typename Scalar, int Dim>
     void writeAlbedoMap (
         const std::string& path,
-        const BRDFReconstructor<Scalar>* reconstructor,
+        const BRDFReconstructor<Scalar, Dim>* reconstructor,
         const unsigned int albedoSampling,
         const unsigned int width,
         const unsigned int height,
         const double latentWidth,
-        const double latentHeight)
+        const double latentHeight,
+        const unsigned int batchSize)
     {
          if (reconstructor->getLatentDim() != 2){
             std::cerr << "Cannot produce a map of a latent space whose dim is different than 2" << std::endl;
@@ -66,29 +68,41 @@ namespace ChefDevr
         }
         bitmap_image map(width, height);
         const double color_max(255);
+        const unsigned int nbPixels(width*height);
         double r, g, b;
         Scalar xstep(latentHeight/width), ystep(latentHeight/height);
         RowVector<Scalar> brdf(reconstructor->getBRDFCoeffNb());
+        Matrix<Scalar> brdfs;
+        // Coordinates of the pixels, pixel (pixx, pixy) is the column pixx*height+pixy
+        Matrix<Scalar> coords(2, nbPixels);
         Vector<Scalar> coord(2);
         coord << (xstep-latentWidth)*0.5, (ystep-latentHeight)*0.5;
-        std::cout << "Compute albedo map" << std::endl;
         for (unsigned int pixx(0); pixx < width; ++pixx)
         {
             coord[0] += xstep;
             for (unsigned int pixy(0); pixy < height; ++pixy)
             {
-                progressBar(double(pixx*height+pixy) / (width*height));
                 coord[1] += ystep;
-                reconstructor->reconstruct(brdf, coord);
+                coords.col(pixx*height+pixy) = coord;
+            }
+            coord[1] = (ystep-latentHeight)*0.5;
+        }
+        std::cout << "Compute albedo map" << std::endl;
+        for (unsigned int first(0); first < nbPixels; first += batchSize)
+        {
+            const unsigned int size(std::min(batchSize, nbPixels - first));
+            progressBar(double(first) / nbPixels);
+            reconstructor->reconstructBatch(brdfs, coords.middleCols(first, size));
+            for (unsigned int p(0); p < size; ++p)
+            {
                 // clamp BRDF values in [0; +inf)
-                brdf = brdf.cwiseMax(Scalar(0));
+                brdf = brdfs.row(p).cwiseMax(Scalar(0));
                 Albedo::computeAlbedo<Scalar>(brdf, r, g, b, albedoSampling);
-                map.set_pixel(pixx, pixy,
+                map.set_pixel((first+p) / height, (first+p) % height,
                               r*color_max,
                               g*color_max,
                               b*color_max);
             }
-            coord[1] = (ystep-latentHeight)*0.5;
         }
         std::cout << std::endl;
         map.save_image(path.c_str());   
@@ -0,0 +1,251 @@
+#ifndef OPTIMISATIONOBSERVER_H
+#define OPTIMISATIONOBSERVER_H
+
+/**
+ * @file OptimisationObserver.h
+ */
+
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+
+namespace ChefDevr
+{
+    /**
+     * @brief Accepted move of one latent coordinate during an exploratory move
+     * @tparam Scalar The type of scalar number the optimisation is computed with
+     */
+    template <typename Scalar>
+    struct MoveEvent
+    {
+        /** @brief Number of the sweep (exploratory move followed by pattern moves) */
+        unsigned int sweep;
+        /** @brief Index of the moved coordinate in the latent variables vector */
+        unsigned int coefficient;
+        /** @brief Number of coordinates of the latent variables vector */
+        unsigned int nbCoefficients;
+        /** @brief Value added to the coordinate */
+        Scalar move;
+        /** @brief Change of the cost function */
+        Scalar deltaCost;
+        /** @brief Value of the cost function after the move */
+        Scalar cost;
+    };
+
+    /**
+     * @brief Summary of one sweep of the optimisation
+     * @tparam Scalar The type of scalar number the optimisation is computed with
+     *
+     * For the pattern search, a sweep is an exploratory move followed by the pattern moves;
+     * for L-BFGS-B, a sweep is an iteration.
+     */
+    template <typename Scalar>
+    struct SweepEvent
+    {
+        /** @brief Number of the sweep */
+        unsigned int sweep;
+        /** @brief Value of the cost function at the end of the sweep */
+        Scalar cost;
+        /** @brief Step of the sweep */
+        Scalar step;
+        /** @brief Number of accepted coordinate moves */
+        unsigned long acceptedMoves;
+        /** @brief Number of coordinates that did not move */
+        unsigned long rejectedMoves;
+        /** @brief Number of coordinates skipped by the active set */
+        unsigned long skippedMoves;
+        /** @brief Number of accepted pattern moves */
+        unsigned long patternMoves;
+        /** @brief Number of low rank updates of the inverse matrix (Sherman-Morisson) */
+        unsigned long updates;
+        /** @brief Number of factorisations of a covariance matrix */
+        unsigned long inversions;
+        /** @brief Wall time of the exploratory move in seconds */
+        double exploratoryTime;
+        /** @brief Wall time of the pattern moves in seconds */
+        double patternTime;
+    };
+
+    /**
+     * @brief Criterion that ended an optimisation
+     */
+    enum class StopReason
+    {
+        /** @brief The step went below the minimum step */
+        MinStep,
+        /** @brief The relative decrease of the cost over the last sweeps went below the tolerance */
+        RelativeDecrease,
+        /** @brief The maximum number of sweeps has been done */
+        MaxSweeps,
+        /** @brief The wall-clock budget has been spent */
+        TimeBudget,
+        /** @brief A stop has been requested */
+        Requested
+    };
+
+    /**
+     * @return The name of a stop reason
+     */
+    inline const char* stopReasonName (StopReason reason)
+    {
+        switch (reason)
+        {
+            case StopReason::MinStep: return "minimum step reached";
+            case StopReason::RelativeDecrease: return "relative cost decrease below tolerance";
+            case StopReason::MaxSweeps: return "maximum number of sweeps reached";
+            case StopReason::TimeBudget: return "time budget spent";
+            default: return "stop requested";
+        }
+    }
+
+    /**
+     * @brief Summary of a run of the pattern search : stopping criteria, step policy and outcome
+     * @tparam Scalar The type of scalar number the optimisation is computed with
+     */
+    template <typename Scalar>
+    struct OptimisationSummary
+    {
+        /** @brief Relative cost decrease below which the run stops (0 if disabled) */
+        Scalar relativeTolerance;
+        /** @brief Maximum number of sweeps (0 if unlimited) */
+        unsigned int maxSweeps;
+        /** @brief Wall-clock budget in seconds (0 if unlimited) */
+        double timeBudget;
+        /** @brief True if the step is adapted to the outcome of each sweep, false if it is halved */
+        bool adaptiveStep;
+        /** @brief Number of sweeps done */
+        unsigned int sweeps;
+        /** @brief Number of sweeps without any accepted move */
+        unsigned int failedSweeps;
+        /** @brief Number of step expansions */
+        unsigned int expansions;
+        /** @brief Number of step reductions */
+        unsigned int reductions;
+        /** @brief Number of evaluated coordinates */
+        unsigned long evaluations;
+        /** @brief Number of coordinates skipped by the active set */
+        unsigned long skipped;
+        /** @brief Number of probes of the numerical drift of the inverse matrix */
+        unsigned int driftProbes;
+        /** @brief Number of refactorisations triggered by the drift probes */
+        unsigned int refactorisations;
+        /** @brief Largest relative residual measured by the drift probes */
+        Scalar maxResidual;
+        /** @brief Value of the cost function at the start of the run */
+        Scalar initialCost;
+        /** @brief Value of the cost function at the end of the run */
+        Scalar finalCost;
+        /** @brief Step at the end of the run */
+        Scalar finalStep;
+        /** @brief Wall time of the run in seconds */
+        double wallTime;
+        /** @brief Criterion that ended the run */
+        StopReason stopReason;
+    };
+
+    /**
+     * @brief Prints a summary of a run
+     * @param out The output stream
+     * @param summary The summary
+     */
+    template <typename Scalar>
+    std::ostream& operator<< (std::ostream& out, const OptimisationSummary<Scalar>& summary);
+
+    /**
+     * @brief Interface of the objects notified during the optimisation
+     * @tparam Scalar The type of scalar number the optimisation is computed with
+     *
+     * The solvers only call an observer when one is attached : they do not measure time
+     * nor build events otherwise.
+     */
+    template <typename Scalar>
+    class OptimisationObserver
+    {
+    public:
+        virtual ~OptimisationObserver() = default;
+
+        /**
+         * @brief Called after each accepted move of a coordinate
+         * @param event The move
+         */
+        virtual void onMove (const MoveEvent<Scalar>& event) { (void)event; }
+
+        /**
+         * @brief Called at the end of each sweep
+         * @param event The summary of the sweep
+         */
+        virtual void onSweep (const SweepEvent<Scalar>& event) { (void)event; }
+    };
+
+    /**
+     * @brief Writes one line per sweep in a CSV file
+     * @tparam Scalar The type of scalar number the optimisation is computed with
+     */
+    template <typename Scalar>
+    class CSVObserver : public OptimisationObserver<Scalar>
+    {
+    public:
+        /**
+         * @brief Constructor
+         * @param path Path of the CSV file to create
+         * @param logMoves If true, the accepted moves are written too (with a "move" kind)
+         */
+        explicit CSVObserver (const std::string& path, bool logMoves = false);
+
+        void onMove (const MoveEvent<Scalar>& event) override;
+
+        void onSweep (const SweepEvent<Scalar>& event) override;
+
+    private:
+        /**
+         * @brief The CSV file
+         */
+        std::ofstream file;
+
+        /**
+         * @brief True if the accepted moves are written
+         */
+        const bool logMoves;
+    };
+
+    /**
+     * @brief Prints a progress line on the standard output at most once per interval
+     * @tparam Scalar The type of scalar number the optimisation is computed with
+     */
+    template <typename Scalar>
+    class ConsoleObserver : public OptimisationObserver<Scalar>
+    {
+    public:
+        /**
+         * @brief Constructor
+         * @param interval Minimum wall time in seconds between two lines
+         */
+        explicit ConsoleObserver (double interval = 1.);
+
+        void onMove (const MoveEvent<Scalar>& event) override;
+
+        void onSweep (const SweepEvent<Scalar>& event) override;
+
+    private:
+        /**
+         * @brief Minimum wall time in seconds between two lines
+         */
+        const double interval;
+
+        /**
+         * @brief Time of the last printed line
+         */
+        std::chrono::steady_clock::time_point lastPrint;
+
+        /**
+         * @return True if a line can be printed now
+         */
+        bool due ();
+    };
+} // namespace ChefDevr
+
+#include "OptimisationObserver.hpp"
+
+#endif // OPTIMISATIONOBSERVER_H
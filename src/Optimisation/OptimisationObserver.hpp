@@ -0,0 +1,127 @@
+#include "OptimisationObserver.h"
+
+/**
+ * @file OptimisationObserver.hpp
+ */
+
+#include <iostream>
+
+namespace ChefDevr
+{
+    template <typename Scalar>
+    std::ostream& operator<< (std::ostream& out, const OptimisationSummary<Scalar>& summary)
+    {
+        out << "Optimisation summary :" << std::endl
+            << "\tstopped after " << summary.sweeps << " sweeps (" << stopReasonName(summary.stopReason)
+            << ") in " << summary.wallTime << " s" << std::endl
+            << "\tcost " << double(summary.initialCost) << " -> " << double(summary.finalCost)
+            << ", final step " << double(summary.finalStep) << std::endl
+            << "\tstep policy : " << (summary.adaptiveStep ? "adaptive" : "halving") << ", "
+            << summary.expansions << " expansions, " << summary.reductions << " reductions, "
+            << summary.failedSweeps << " failed sweeps" << std::endl
+            << "\t" << summary.evaluations << " coordinates evaluated, " << summary.skipped << " skipped by the active set" << std::endl
+            << "\t" << summary.driftProbes << " drift probes (largest residual " << double(summary.maxResidual) << "), "
+            << summary.refactorisations << " refactorisations" << std::endl
+            << "\tcriteria : relative decrease ";
+        if (summary.relativeTolerance > Scalar(0))
+        {
+            out << double(summary.relativeTolerance);
+        }
+        else
+        {
+            out << "off";
+        }
+        out << ", max sweeps ";
+        if (summary.maxSweeps > 0)
+        {
+            out << summary.maxSweeps;
+        }
+        else
+        {
+            out << "off";
+        }
+        out << ", time budget ";
+        if (summary.timeBudget > 0)
+        {
+            out << summary.timeBudget << " s";
+        }
+        else
+        {
+            out << "off";
+        }
+        return out << std::endl;
+    }
+
+    template <typename Scalar>
+    CSVObserver<Scalar>::CSVObserver (const std::string& path, const bool _logMoves) :
+        file(path),
+        logMoves(_logMoves)
+    {
+        if (!file.is_open())
+        {
+            std::cerr << "Could not create file \"" << path << "\"" << std::endl;
+        }
+        file.precision(17);
+        file << "kind,sweep,cost,step,accepted,rejected,skipped,pattern,updates,inversions,exploratory_s,pattern_s,coefficient,move,delta_cost" << std::endl;
+    }
+
+    template <typename Scalar>
+    void CSVObserver<Scalar>::onMove (const MoveEvent<Scalar>& event)
+    {
+        if (logMoves)
+        {
+            file << "move," << event.sweep << ',' << double(event.cost) << ",,,,,,,,,,"
+                 << event.coefficient << ',' << double(event.move) << ',' << double(event.deltaCost) << '\n';
+        }
+    }
+
+    template <typename Scalar>
+    void CSVObserver<Scalar>::onSweep (const SweepEvent<Scalar>& event)
+    {
+        file << "sweep," << event.sweep << ',' << double(event.cost) << ',' << double(event.step) << ','
+             << event.acceptedMoves << ',' << event.rejectedMoves << ',' << event.skippedMoves << ',' << event.patternMoves << ','
+             << event.updates << ',' << event.inversions << ','
+             << event.exploratoryTime << ',' << event.patternTime << ",,," << std::endl;
+    }
+
+    template <typename Scalar>
+    ConsoleObserver<Scalar>::ConsoleObserver (const double _interval) :
+        interval(_interval),
+        lastPrint(std::chrono::steady_clock::now()){}
+
+    template <typename Scalar>
+    bool ConsoleObserver<Scalar>::due ()
+    {
+        const auto now(std::chrono::steady_clock::now());
+        if (std::chrono::duration<double>(now - lastPrint).count() < interval)
+        {
+            return false;
+        }
+        lastPrint = now;
+        return true;
+    }
+
+    template <typename Scalar>
+    void ConsoleObserver<Scalar>::onMove (const MoveEvent<Scalar>& event)
+    {
+        if (due())
+        {
+            std::cout << "sweep " << event.sweep << " : coordinate " << event.coefficient + 1 << "/" << event.nbCoefficients
+                      << ", cost " << double(event.cost) << std::endl;
+        }
+    }
+
+    template <typename Scalar>
+    void ConsoleObserver<Scalar>::onSweep (const SweepEvent<Scalar>& event)
+    {
+        if (due())
+        {
+            std::cout << "sweep " << event.sweep << " : cost " << double(event.cost) << ", step " << double(event.step)
+                      << ", " << event.acceptedMoves << " moves accepted, " << event.rejectedMoves << " rejected, "
+                      << event.skippedMoves << " skipped, "
+                      << event.patternMoves << " pattern moves, " << event.updates << " updates, "
+                      << event.inversions << " inversions ("
+                      << event.exploratoryTime << " s + " << event.patternTime << " s)" << std::endl;
+        }
+    }
+} // namespace ChefDevr
@@ -6,45 +6,73 @@
  */
 
 #include "Parametrisation/types.h"
+#include "Parametrisation/Parametrisation.h"
+#include "OptimisationObserver.h"
 #include "../../tests/OptimisationTest.h"
+#include <atomic>
 #include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 
 namespace ChefDevr
 {
+    template <typename Scalar, int Dim>
+    class MultiStartOptimisation;
+    
     /**
      * @brief Class that solves the optimisation problem defined in the research paper:
      * A Versatile Parametrisation for Measured Materials Manifold.
      * Computes an optimised mapping from BRDFs space to a latent space
      * @tparam Scalar The type of scalar number to do computations with.
      * The precision of this type is crucial to reconstruct an accurate BRDF from the latent space
+     * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise.
+     * A fixed dimension lets the compiler unroll the loops over the coordinates of a latent variable
+     *
+     * Memory : besides the shared ZZt, optimizeMapping holds three nb_data x nb_data matrices of Scalar,
+     * K_minus1, the inverse mapping of the pattern moves and the cached covariance matrix K,
+     * that is 3 * nb_data^2 * sizeof(Scalar) bytes (48 * nb_data^2 with a 16 bytes long double).
+     * The nb_data x latentDim matrices expStepX and expMinusStepX are negligible next to them.
      */
-    template <typename Scalar>
+    template <typename Scalar, int Dim = Eigen::Dynamic>
     class OptimisationSolver {
     public:
         
         /**
          * @brief Constructor
          * @param minStep Step below which solution is considered optimal
-         * @param ZZt Z * (Z transposed) where Z is the centered BRDF data matrix (BRDFs stored in row major)
-         * @param latentDim Dimension of optimised latent space
+         * @param ZZt Z * (Z transposed) where Z is the centered BRDF data matrix (BRDFs stored in row major).
+         * It is not copied : it must outlive the solver, and may be shared by several solvers
+         * @param latentDim Dimension of optimised latent space (equal to Dim when Dim is fixed)
+         * @param mu Value of the mu constant of the covariance function
+         * @param l Value of the l constant of the covariance function
          */
         OptimisationSolver(
             long num_BRDFCoefficients,
             Scalar minStep,
             const Matrix<Scalar>& ZZt,
-            unsigned int latentDim);
+            unsigned int latentDim,
+            Scalar mu = MU_DEFAULT,
+            Scalar l = L_DEFAULT);
         
-        ~OptimisationSolver() = default;
+        virtual ~OptimisationSolver() = default;
 
         /**
          * @brief Computes the optimized parametrisation of the BRDFs manifold.
          * Uses Hook & Jeeves method to solve the optimisation
          */
-        void optimizeMapping ();
+        virtual void optimizeMapping ();
         
         /**
          * @return A reference of the inverse mapping matrix
+         * 
+         * The matrix is complete once optimizeMapping has returned
          */
         inline const Matrix<Scalar>& getInverseMapping() const { return K_minus1; }
         
@@ -58,7 +86,128 @@ namespace ChefDevr
          */
         inline const Scalar& getCostValue() const { return costval; }
         
-    private:
+        /**
+         * @brief Sets the number of coordinates whose moves are evaluated concurrently
+         * during an exploratory move
+         * @param batch Number of coordinates per batch (1 for a sequential exploratory move)
+         *
+         * The moves of a batch are evaluated in parallel against the same K_minus1,
+         * then accepted in order. A move that follows accepted moves of the same batch
+         * is corrected with their rank-2 updates in O(nb_data) operations each before being accepted,
+         * so that the cost never increases. A move of a latent variable that has already moved
+         * in the batch changes its whole covariance vector : it is evaluated again in the next batch.
+         * The path of the optimisation depends on the batch size.
+         */
+        inline void setSpeculativeBatch(unsigned int batch) { speculativeBatch = batch; }
+        
+        /**
+         * @brief Sets the criteria that stop the pattern search before the step goes below minStep
+         * @param relativeDecrease The optimisation stops when the cost decreased by less than
+         * relativeDecrease times its absolute value over the last convergenceWindow sweeps (0 to disable)
+         * @param maxSweeps Maximum number of sweeps (0 to disable)
+         * @param timeBudget Wall-clock budget in seconds (0 to disable)
+         *
+         * The time budget is checked after each batch of an exploratory move,
+         * the other criteria at the end of each sweep.
+         * The criteria apply to one call of optimizeMapping : a resumed run starts counting again.
+         */
+        void setStoppingCriteria(Scalar relativeDecrease, unsigned int maxSweeps, double timeBudget);
+        
+        /**
+         * @brief Sets the policy that updates the step after each sweep
+         * @param adaptive If false, the step is multiplied by reduceStep after each sweep
+         * @param expansion Factor applied to the step after a sweep with accepted pattern moves
+         * (the step never exceeds step0)
+         * @param failureReduction Factor applied to the step after a sweep without any accepted move
+         *
+         * With the adaptive policy, the step is multiplied by reduceStep after the other sweeps.
+         */
+        void setAdaptiveStep(bool adaptive, Scalar expansion = Scalar(2), Scalar failureReduction = Scalar(.25));
+        
+        /**
+         * @brief Restricts the exploratory moves to the coordinates that still move
+         * @param revisitPeriod Coordinates that failed to move in failureThreshold consecutive sweeps
+         * are evaluated once every revisitPeriod sweeps at the same step (0 to disable the active set)
+         * @param failureThreshold Number of consecutive failed sweeps after which a coordinate is skipped
+         * @param nearMove A coordinate whose best move increases the cost by less than nearMove times
+         * the absolute value of the cost is considered as nearly moved and stays active
+         *
+         * With the active set, the step is kept while the sweeps decrease the cost,
+         * and reduced only after a sweep over all the coordinates without any decrease,
+         * so that the solution at each step is checked on every coordinate.
+         * The active set is reset when the step changes and is not stored in the checkpoints.
+         */
+        void setActiveSet(unsigned int revisitPeriod, unsigned int failureThreshold = 2, Scalar nearMove = Scalar(1e-9));
+        
+        /**
+         * @brief Monitors the numerical drift of K_minus1 during the exploratory moves
+         * @param probeInterval Number of accepted moves between two probes (0 to disable the monitor)
+         * @param tolerance Relative residual ||K * (K_minus1 * v) - v|| / ||v|| above which
+         * K_minus1, detK and the cost are computed again from a factorisation of K
+         * @param nbProbes Number of random vectors v of a probe
+         *
+         * The Sherman-Morisson updates of the accepted moves accumulate rounding errors in K_minus1 and detK.
+         * A probe costs 2 * nbProbes matrix-vector products, against a factorisation for the refactorisation.
+         * Bounding the drift lets the optimisation run with lower precision Scalar types.
+         */
+        void setDriftMonitor(unsigned int probeInterval, Scalar tolerance, unsigned int nbProbes = 2);
+        
+        /**
+         * @return The summary of the last call of optimizeMapping
+         */
+        inline const OptimisationSummary<Scalar>& getSummary() const { return summary; }
+        
+        /**
+         * @brief Enables periodic checkpoints of the solver state during optimizeMapping
+         * @param path Path of the checkpoint file
+         * @param interval Wall time in seconds after which a checkpoint is written (0 to disable)
+         * @param sweeps Number of exploratory moves after which a checkpoint is written (0 to disable)
+         *
+         * The wall time is checked after each batch of an exploratory move, so that a checkpoint
+         * may be written in the middle of a sweep. The file is written next to path then renamed,
+         * so that a checkpoint is never left half written.
+         */
+        void setCheckpoint(const std::string& path, double interval, unsigned int sweeps);
+        
+        /**
+         * @brief Restores the state of the solver from a checkpoint file
+         * @param path Path of the checkpoint file
+         * @throw OptimisationSolverError if the file cannot be read or was written for another problem
+         *
+         * The solver must be constructed with the same ZZt, latent dimension, mu and l.
+         * optimizeMapping then resumes where the checkpoint was written,
+         * without initialising X nor inverting K.
+         */
+        void loadCheckpoint(const std::string& path);
+        
+        /**
+         * @brief Sets the latent variables the optimisation starts from, instead of the PCA initialisation
+         * @param X0 Latent variables vector, with coordinates in ]-1; 1[
+         */
+        inline void setInitialLatentVariables(const Vector<Scalar>& X0) { initialX = X0; }
+        
+        /**
+         * @brief Asks a running optimisation to stop as soon as possible
+         *
+         * May be called from another thread or from an observer.
+         * optimizeMapping returns at the end of the current batch of coordinates
+         * with a consistent solution (X, K_minus1, detK and costval)
+         */
+        inline void requestStop() { stopRequested = true; }
+        
+        /**
+         * @brief Attaches an observer notified of the accepted moves and of the end of each sweep
+         * @param observer The observer (not owned by the solver, must outlive the optimisation)
+         */
+        inline void addObserver(OptimisationObserver<Scalar>* observer) { observers.push_back(observer); }
+        
+        class OptimisationSolverError : public std::runtime_error {
+        public:
+            explicit OptimisationSolverError(const std::string& msg) :
+                std::runtime_error(msg){}
+        };
+        
+    protected:
 
         /**
          * @brief Initial value of the step
@@ -70,6 +219,16 @@ namespace ChefDevr
          */
         static constexpr Scalar reduceStep = .5f;
 
+        /**
+         * @brief Number of columns of K_minus1 summed by one thread when computing the cost
+         */
+        static constexpr long costBlockSize = 8;
+
+        /**
+         * @brief Number of sweeps over which the relative decrease of the cost is measured
+         */
+        static constexpr unsigned int convergenceWindow = 3;
+
         /** @brief Step below wich solution is considered optimal */
         const Scalar minStep;
 
@@ -89,14 +248,29 @@ namespace ChefDevr
         const long num_BRDFCoefficients;
         
         /**
-         * @brief Z*Ztransposed
+         * @brief Z*Ztransposed (shared, not copied)
          */
-        const Matrix<Scalar> ZZt;
+        const Matrix<Scalar>& ZZt;
 
         /**
          * @brief Dimension of produced latent space
          */
         unsigned int latentDim;
+        
+        /**
+         * @return The dimension of the latent space, a compile time constant when Dim is fixed
+         */
+        inline unsigned int dimension() const { return Dim == Eigen::Dynamic ? latentDim : Dim; }
+        
+        /**
+         * @brief Value of the mu constant of the covariance function
+         */
+        const Scalar mu;
+        
+        /**
+         * @brief Value of the l constant of the covariance function
+         */
+        const Scalar l;
 
         /**
          * @brief Latent variables vector
@@ -111,11 +285,34 @@ namespace ChefDevr
         /**
          * @brief Inverse of K : Inverse mapping matrix
          *
-         * We do not store K because the algorithm doesnt require it directly :
-         * we compute only columns of K when necessary instead -> covariance vectors
+         * K itself is cached in K during the exploratory moves, whose covariance vectors are its columns
+         *
+         * K_minus1 is symmetric : only its lower triangle is kept up to date during the optimisation
         */
         Matrix<Scalar> K_minus1;
         
+        /**
+         * @brief Covariance matrix K of the current latent variables,
+         * cached during exploratory moves
+         *
+         * Its columns are the covariance vectors of the latent variables.
+         * They are updated in place when a move is accepted
+         * and recomputed at the beginning of each exploratory move.
+         */
+        Matrix<Scalar> K;
+        
+        /**
+         * @brief exp(step * X / l^2) for every latent coordinate
+         * (one row per latent variable, one column per latent dimension)
+         */
+        Matrix<Scalar> expStepX;
+        
+        /**
+         * @brief exp(-step * X / l^2) for every latent coordinate
+         * (one row per latent variable, one column per latent dimension)
+         */
+        Matrix<Scalar> expMinusStepX;
+        
         /**
          * @brief Determinant of K
          */
@@ -126,10 +323,209 @@ namespace ChefDevr
          */
         Scalar costval;
         
+        /**
+         * @brief Number of coordinates whose moves are evaluated concurrently during an exploratory move
+         */
+        unsigned int speculativeBatch;
+        
+        /**
+         * @brief Path of the checkpoint file (empty if checkpoints are disabled)
+         */
+        std::string checkpointPath;
+        
+        /**
+         * @brief Wall time in seconds between two checkpoints (0 if disabled)
+         */
+        double checkpointInterval;
+        
+        /**
+         * @brief Number of exploratory moves between two checkpoints (0 if disabled)
+         */
+        unsigned int checkpointSweeps;
+        
+        /**
+         * @brief Number of exploratory moves since the last checkpoint
+         */
+        unsigned int sweepsSinceCheckpoint;
+        
+        /**
+         * @brief Time of the last checkpoint
+         */
+        std::chrono::steady_clock::time_point lastCheckpoint;
+        
+        /**
+         * @brief Index of the coordinate from which the next exploratory move starts
+         * (not 0 when resuming from a checkpoint written in the middle of a sweep)
+         */
+        unsigned int firstCoefficient;
+        
+        /**
+         * @brief True if the state has been restored from a checkpoint
+         */
+        bool resumed;
+        
+        /**
+         * @brief Latent variables the optimisation starts from (empty for the PCA initialisation)
+         */
+        Vector<Scalar> initialX;
+        
+        /**
+         * @brief True if the optimisation has to stop
+         */
+        std::atomic<bool> stopRequested;
+        
+        /**
+         * @brief Observers notified during the optimisation
+         */
+        std::vector<OptimisationObserver<Scalar>*> observers;
+        
+        /**
+         * @brief Statistics of the current sweep
+         */
+        SweepEvent<Scalar> sweepStats;
+        
+        /**
+         * @brief Start time of the current phase of the sweep (only measured with observers)
+         */
+        std::chrono::steady_clock::time_point phaseStart;
+        
+        /**
+         * @brief Relative decrease of the cost below which the optimisation stops (0 if disabled)
+         */
+        Scalar relativeTolerance;
+        
+        /**
+         * @brief Maximum number of sweeps (0 if disabled)
+         */
+        unsigned int maxSweeps;
+        
+        /**
+         * @brief Wall-clock budget of the optimisation in seconds (0 if disabled)
+         */
+        double timeBudget;
+        
+        /**
+         * @brief True if the step is adapted to the outcome of each sweep
+         */
+        bool adaptiveStep;
+        
+        /**
+         * @brief Factor applied to the step after a sweep with accepted pattern moves (adaptive policy)
+         */
+        Scalar stepExpansion;
+        
+        /**
+         * @brief Factor applied to the step after a sweep without any accepted move (adaptive policy)
+         */
+        Scalar failureReduction;
+        
+        /**
+         * @brief Start time of the current call of optimizeMapping
+         */
+        std::chrono::steady_clock::time_point runStart;
+        
+        /**
+         * @brief Summary of the current call of optimizeMapping
+         */
+        OptimisationSummary<Scalar> summary;
+        
+        /**
+         * @brief Number of sweeps between two evaluations of the stagnant coordinates (0 if the active set is disabled)
+         */
+        unsigned int activeSetPeriod;
+        
+        /**
+         * @brief Number of consecutive failed sweeps after which a coordinate is stagnant
+         */
+        unsigned int stagnationThreshold;
+        
+        /**
+         * @brief Relative cost increase below which a rejected move is considered as nearly accepted
+         */
+        Scalar nearMoveTolerance;
+        
+        /**
+         * @brief Number of consecutive sweeps at the current step in which each coordinate failed to move
+         */
+        std::vector<unsigned int> stagnation;
+        
+        /**
+         * @brief Number of sweeps done at the current step
+         */
+        unsigned int sweepsAtStep;
+        
+        /**
+         * @brief True if the next exploratory move has to evaluate every coordinate
+         */
+        bool forceFullSweep;
+        
+        /**
+         * @brief True if the last exploratory move has evaluated every coordinate
+         */
+        bool fullSweep;
+        
+        /**
+         * @brief Number of accepted moves between two drift probes (0 if the monitor is disabled)
+         */
+        unsigned int driftInterval;
+        
+        /**
+         * @brief Relative residual above which K_minus1 is refactorised
+         */
+        Scalar driftTolerance;
+        
+        /**
+         * @brief Number of random vectors of a drift probe
+         */
+        unsigned int driftProbes;
+        
+        /**
+         * @brief Number of accepted moves since the last drift probe
+         */
+        unsigned int movesSinceProbe;
+        
+        /**
+         * @brief Generator of the random vectors of the drift probes
+         */
+        std::mt19937 probeGenerator;
+        
+        /**
+         * @brief Symmetric rank-2 update of K_minus1 : new_K_minus1 = K_minus1 - w1*ut - w2*vt
+         */
+        struct SymmetricUpdate
+        {
+            Vector<Scalar> w1, w2, u, v;
+            /** @brief det(new_K) / det(K) */
+            Scalar detFactor;
+        };
+        
+        /**
+         * @brief Move of one coordinate of X evaluated during an exploratory move
+         */
+        struct MoveCandidate
+        {
+            /** @brief True for a +step move, false for a -step move */
+            bool positive;
+            /** @brief True if the move does not increase the cost */
+            bool improves;
+            /** @brief Change of the cost function */
+            Scalar deltaCost;
+            /** @brief Lowest change of the cost function among the evaluated moves */
+            Scalar bestDeltaCost;
+            /** @brief Change of the covariance vector of the moved latent variable */
+            Vector<Scalar> diff_cov_vector;
+            /** @brief Update of K_minus1 */
+            SymmetricUpdate update;
+            /** @brief ZZt * update.w1, kept to correct the move after the accepted moves of the batch */
+            Vector<Scalar> ZZt_w1;
+            /** @brief ZZt * update.w2, kept to correct the move after the accepted moves of the batch */
+            Vector<Scalar> ZZt_w2;
+        };
+        
         /**
          * @brief Computes the cost of the solution defined by K_minus1
          * @param cost value of the cost to fill
-         * @param K_minus1 Inverse mapping
+         * @param K_minus1 Inverse mapping (only its lower triangle is read)
          * @param detK Determinant of the matrix K
          */
         void cost (Scalar& cost, const Matrix<Scalar>& K_minus1, const Scalar& detK) const;
@@ -139,10 +535,85 @@ namespace ChefDevr
          * @return True if has moved, false otherwise
          * 
          * Adds and substracts step from each element
-         * and reevaluate the cost function to check for better solutions
+         * and reevaluate the cost function to check for better solutions.
+         * With the active set, the stagnant coordinates are skipped (their move is 0)
          */
         bool exploratoryMove ();
 
+        /**
+         * @brief Evaluates the +step move of a coordinate of X, and the -step move if the first one does not improve the cost
+         * @param i Index of the coordinate in X
+         * @param candidate The evaluated move (filled in this function)
+         */
+        void evaluateCoefficient (unsigned int i, MoveCandidate& candidate) const;
+        
+        /**
+         * @brief Evaluates the change of the cost function when a coordinate of X moves
+         * @param i Index of the coordinate in X
+         * @param positive True for a +step move, false for a -step move
+         * @param candidate The evaluated move (filled in this function)
+         *
+         * K_minus1 is not modified : the cost change is computed from the rank-2 update
+         * in O(nb_data^2) operations without building the new inverse matrix
+         */
+        void evaluateMove (unsigned int i, bool positive, MoveCandidate& candidate) const;
+        
+        /**
+         * @brief Corrects an evaluated move after another move of the batch has been accepted
+         * @param i Index of the coordinate in X of the evaluated move
+         * @param candidate The evaluated move, against K_minus1 before the accepted move (corrected in this function)
+         * @param moved Number of the latent variable of the accepted move (not the one of i)
+         * @param accepted The accepted move
+         *
+         * Only the covariance between the two latent variables changes in diff_cov_vector,
+         * and K_minus1 changes by the rank-2 update of the accepted move :
+         * w1, w2 and their products by ZZt are corrected in O(nb_data) operations, without any product by a matrix.
+         */
+        void correctMove (unsigned int i, MoveCandidate& candidate, unsigned int moved, const MoveCandidate& accepted) const;
+        
+        /**
+         * @brief Applies an evaluated move to X, X_move, K_minus1, detK, costval and the covariance cache
+         * @param i Index of the coordinate in X
+         * @param candidate The evaluated move
+         */
+        void acceptMove (unsigned int i, const MoveCandidate& candidate);
+        
+        /**
+         * @brief Computes K, expStepX and expMinusStepX from the current X and step
+         */
+        void updateCovarianceCache ();
+        
+        /**
+         * @brief Computes the change of the covariance vector of a latent variable
+         * when one of its coordinates moves by +step or -step
+         * @param diff_cov_vector The difference between the covariance vector after and before the move (to fill)
+         * @param lv_num Number of the latent variable that moves
+         * @param coord Index of the coordinate that moves in the latent variable
+         * @param positive True for a +step move, false for a -step move
+         *
+         * With the RBF kernel, moving one coordinate multiplies each covariance
+         * by exp(-(2*move*(x_lv - x_j) + move^2) / (2*l^2)) : the cached column of K is multiplied
+         * by precomputed exponentials instead of evaluating the covariance function again.
+         * The factor does not apply to the mu term : the covariances with the latent variables that
+         * coincide with the moving one before or after the move are evaluated with covariance().
+         */
+        void computeDiffCovVector (
+            Vector<Scalar>& diff_cov_vector,
+            unsigned int lv_num,
+            unsigned int coord,
+            bool positive) const;
+        
+        /**
+         * @brief Applies an accepted move of one coordinate to the cached K, expStepX and expMinusStepX
+         * @param lv_num Number of the latent variable that has moved
+         * @param coord Index of the coordinate that has moved in the latent variable
+         * @param diff_cov_vector The difference between the covariance vector after and before the move
+         */
+        void moveCovarianceCache (
+            unsigned int lv_num,
+            unsigned int coord,
+            const Vector<Scalar>& diff_cov_vector);
+        
         /**
          * @brief Apply X_move to the latent variable vector X.
          * Updates new_X, new_K_minus1, new_detK accordingly
@@ -156,8 +627,8 @@ namespace ChefDevr
         /**
          * @brief Computes the new inverse matrix K_minus1 and the new determinant of K
          * using Sherman-Morisson formula
-         * @param old_K_minus1 K_minus1 matrix before K had changed
-         * @param new_K_minus1 K_minus1 matrix after K has changed (computed in this function)
+         * @param old_K_minus1 K_minus1 matrix before K had changed (only its lower triangle is read)
+         * @param new_K_minus1 K_minus1 matrix after K has changed (only its lower triangle is computed in this function)
          * @param old_detK Determinant of K before K had changed
          * @param new_detK Determinant of K after K has changed (computed in this function)
          * @param lv_num Number of the latent variable that has changed
@@ -168,7 +639,8 @@ namespace ChefDevr
          * @pre old_detK != 0
          *
          * Computes new_K_minus_1 and new_detK from their previous values using Sherman-Morisson formula.
-         * The formula for the inverse and determinant are applied twice : one for the row modification, and another one for the column modification.
+         * The row and column modifications are applied at once as a symmetric rank-2 update (Woodbury formula),
+         * so that the lower triangle of old_K_minus1 is read and the one of new_K_minus1 written in a single pass.
          */
         void shermanMorissonUpdate (
             const Matrix<Scalar>& old_K_minus1,
@@ -178,18 +650,172 @@ namespace ChefDevr
             unsigned int lv_num,
             Vector<Scalar>& diff_cov_vector) const;
         
+        /**
+         * @brief Computes the symmetric rank-2 update of K_minus1 given by Sherman-Morisson formula
+         * @param K_minus1 K_minus1 matrix before K changes (only its lower triangle is read)
+         * @param lv_num Number of the latent variable that changes
+         * @param diff_cov_vector The difference between
+         * the column/row of K that changes and the column/row before it changes.
+         * Although this parameter is not const it remains unchanged when the function returns
+         * @param update The update to fill
+         */
+        void prepareUpdate (
+            const Matrix<Scalar>& K_minus1,
+            unsigned int lv_num,
+            Vector<Scalar>& diff_cov_vector,
+            SymmetricUpdate& update) const;
+        
+        /**
+         * @brief Computes the coefficients of a symmetric rank-2 update from its vectors w1 and w2
+         * @param lv_num Number of the latent variable that changes
+         * @param diff_cov_vector The difference between
+         * the column/row of K that changes and the column/row before it changes.
+         * Although this parameter is not const it remains unchanged when the function returns
+         * @param update The update whose w1 and w2 are set (u, v and detFactor are computed in this function)
+         */
+        void solveUpdate (
+            unsigned int lv_num,
+            Vector<Scalar>& diff_cov_vector,
+            SymmetricUpdate& update) const;
+        
+        /**
+         * @brief Applies a symmetric rank-2 update to the lower triangle of K_minus1
+         * @param old_K_minus1 K_minus1 matrix before the update
+         * @param new_K_minus1 K_minus1 matrix after the update (may be old_K_minus1 itself)
+         * @param update The update to apply
+         */
+        void applyUpdate (
+            const Matrix<Scalar>& old_K_minus1,
+            Matrix<Scalar>& new_K_minus1,
+            const SymmetricUpdate& update) const;
+        
+        /**
+         * @brief Replaces the covariance matrix K by its inverse and computes its determinant
+         * @param K Covariance matrix, replaced by its inverse
+         * @param detK Determinant of K to fill
+         * 
+         * Uses a Cholesky factorisation since K is symmetric positive definite
+         */
+        void invertCovariance (Matrix<Scalar>& K, Scalar& detK) const;
+        
         /**
          * @brief Initializes the latent coordinates vector X by applying the PCA method
-         * on the Z matrix and reducing its coordinates between [-1; 1]
+         * on the Z matrix (leading eigen vectors of K) and reducing its coordinates between [-1; 1]
          * @param K Variance-covariance matrix used to compute eigen vectors & values
          */
         void initX (const Matrix<Scalar>& K);
+        
+        /**
+         * @brief Version of the checkpoint file format
+         */
+        static constexpr std::uint32_t checkpointVersion = 1;
+        
+        /**
+         * @return The 8 characters that identify a checkpoint file
+         */
+        static inline const char* checkpointMagic() { return "CDOPTCKP"; }
+        
+        /**
+         * @brief Writes the binary representation of count values in a file
+         */
+        template <typename T>
+        static inline void writeRaw(std::ostream& file, const T* data, std::size_t count)
+        {
+            file.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+        }
+        
+        /**
+         * @brief Reads the binary representation of count values from a file
+         */
+        template <typename T>
+        static inline void readRaw(std::istream& file, T* data, std::size_t count)
+        {
+            file.read(reinterpret_cast<char*>(data), count * sizeof(T));
+        }
+        
+        /**
+         * @brief Starts measuring the wall time of a phase of the sweep if an observer is attached
+         */
+        void startPhase ();
+        
+        /**
+         * @brief Ends the measure of the current phase and starts the next one
+         * @return The wall time of the phase in seconds (0 without observer)
+         */
+        double endPhase ();
+        
+        /**
+         * @brief Notifies the observers of an accepted move
+         * @param i Index of the coordinate in X
+         * @param move Value added to the coordinate
+         * @param deltaCost Change of the cost function
+         */
+        void notifyMove (unsigned int i, Scalar move, Scalar deltaCost) const;
+        
+        /**
+         * @brief Notifies the observers of the end of a sweep and resets the statistics of the sweep
+         */
+        void notifySweep ();
+        
+        /**
+         * @return True if the wall-clock budget of the optimisation is spent
+         */
+        bool budgetSpent () const;
+        
+        /**
+         * @brief Updates the step according to the outcome of a sweep
+         * @param accepted Number of accepted coordinate moves of the sweep
+         * @param patterns Number of accepted pattern moves of the sweep
+         * @param progress True if the sweep has decreased the cost
+         */
+        void updateStep (unsigned long accepted, unsigned long patterns, bool progress);
+        
+        /**
+         * @brief Computes the relative residual of K_minus1 with respect to the cached covariance matrix K
+         * @param nbProbes Number of random vectors
+         * @return ||K * (K_minus1 * V) - V|| / ||V|| for a matrix V of random signs
+         */
+        Scalar inverseResidual (unsigned int nbProbes);
+        
+        /**
+         * @brief Probes the drift of K_minus1 and refactorises K when the residual exceeds the tolerance
+         */
+        void monitorDrift ();
+        
+        /**
+         * @brief Updates the active set after the evaluation of a coordinate
+         * @param i Index of the coordinate in X
+         * @param candidate The evaluated move
+         * @param accepted True if the move has been accepted
+         */
+        void updateStagnation (unsigned int i, const MoveCandidate& candidate, bool accepted);
+        
+        /**
+         * @brief Checks the stopping criteria at the end of a sweep
+         * @param recentCosts Costs at the end of the last sweeps (the oldest first)
+         * @return True if the optimisation has to stop, the reason is then stored in the summary
+         */
+        bool stopCriterionMet (const std::deque<Scalar>& recentCosts);
+        
+        /**
+         * @return True if the wall time since the last checkpoint exceeds the checkpoint interval
+         */
+        bool checkpointDue () const;
+        
+        /**
+         * @brief Writes the state of the solver in the checkpoint file
+         * @param nextCoefficient Index of the coordinate from which the exploratory move resumes
+         *
+         * A failure is reported on the error output and does not stop the optimisation
+         */
+        void writeCheckpoint (unsigned int nextCoefficient);
 
         /* ------------*/
         /* Friends */
         /* ------------*/
 
         friend OptimisationTest;
+        friend class MultiStartOptimisation<Scalar, Dim>;
     };
 } // namespace ChefDevr
 
@@ -1,5 +1,7 @@
 #include "OptimisationSolver.h"
+#include "SymmetricEigenSolver.h"
 #include "Parametrisation/Parametrisation.h"
+#include "Parametrisation/Reduction.h"
 
 /**
  * @file OptimisationSolver.h
@@ -7,225 +9,661 @@
 
 #include <cmath>
 #include <Eigen/LU>
+#include <Eigen/Cholesky>
 #include <Eigen/SVD>
 #include <Eigen/Eigenvalues>
+#include <algorithm>
+#include <limits>
 #include <numeric>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 
 namespace ChefDevr
 {
-    template <typename Scalar>
-    OptimisationSolver<Scalar>::OptimisationSolver(
+    template <typename Scalar, int Dim>
+    OptimisationSolver<Scalar, Dim>::OptimisationSolver(
         const long num_BRDFCoefficients,
         Scalar _minStep,
         const Matrix<Scalar>& _ZZt,
-        const unsigned int _latentDim) :
+        const unsigned int _latentDim,
+        const Scalar _mu,
+        const Scalar _l) :
         minStep(_minStep),
         step(step0),
         nb_data(_ZZt.rows()),
         num_BRDFCoefficients{num_BRDFCoefficients},
         ZZt(_ZZt),
         latentDim(_latentDim),
+        mu(_mu),
+        l(_l),
         X(_ZZt.rows()*latentDim),
         X_move(_ZZt.rows()*latentDim),
-        K_minus1(_ZZt.rows(), _ZZt.rows()){}
+        K_minus1(_ZZt.rows(), _ZZt.rows()),
+        K(_ZZt.rows(), _ZZt.rows()),
+        expStepX(_ZZt.rows(), latentDim),
+        expMinusStepX(_ZZt.rows(), latentDim),
+        speculativeBatch(1),
+        checkpointInterval(0),
+        checkpointSweeps(0),
+        sweepsSinceCheckpoint(0),
+        firstCoefficient(0),
+        resumed(false),
+        stopRequested(false),
+        sweepStats(),
+        relativeTolerance(0),
+        maxSweeps(0),
+        timeBudget(0),
+        adaptiveStep(false),
+        stepExpansion(2),
+        failureReduction(.25f),
+        summary(),
+        activeSetPeriod(0),
+        stagnationThreshold(2),
+        nearMoveTolerance(1e-9f),
+        sweepsAtStep(0),
+        forceFullSweep(false),
+        fullSweep(true),
+        driftInterval(0),
+        driftTolerance(1e-8f),
+        driftProbes(2),
+        movesSinceProbe(0),
+        probeGenerator(0)
+    {
+        eigen_assert(Dim == Eigen::Dynamic || _latentDim == static_cast<unsigned int>(Dim));
+    }
     
-    template <typename Scalar>
-    void OptimisationSolver<Scalar>::optimizeMapping ()
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::optimizeMapping ()
     {
-        Vector<Scalar> new_X(latentDim*nb_data);
+        Vector<Scalar> new_X(dimension()*nb_data);
         Matrix<Scalar> new_K_minus1(nb_data, nb_data);
         Scalar new_costval, new_detK;
         
-        // Init X
-        initX(ZZt);
-        
-        // Compute K
-        // (We use K_minus1 to store it because we don't need K anymore after)
-        for (unsigned int i=0; i < nb_data; ++i)
+        // The state restored from a checkpoint is used as is
+        if (!resumed)
         {
+            // Init X
+            if (initialX.size() == X.size())
+            {
+                X = initialX;
+            }
+            else
+            {
+                initX(ZZt);
+            }
+            
+            // Compute K
+            // (We use K_minus1 to store it because we don't need K anymore after)
+            computeCovMatrix<Scalar, Dim>(K_minus1, X, dimension(), mu, l);
             
-            computeCovVector<Scalar>(K_minus1.col(i).data(), X,
-                             X.segment(latentDim*i, latentDim),
-                             latentDim, nb_data);
+            // Compute detK and K_minus1 from K
+            invertCovariance(K_minus1, detK);
+            // Init cost
+            cost(costval, K_minus1, detK);
         }
+        lastCheckpoint = std::chrono::steady_clock::now();
+        sweepsSinceCheckpoint = 0;
+        sweepStats = SweepEvent<Scalar>();
+        sweepStats.inversions = resumed ? 0 : 1;
         
-        // Compute detK
-        detK = K_minus1.determinant();
-        // Compute K_minus1 from K
-        K_minus1 = K_minus1.inverse().eval();
-        // Init cost
-        cost(costval, K_minus1, detK);
+        summary = OptimisationSummary<Scalar>();
+        summary.relativeTolerance = relativeTolerance;
+        summary.maxSweeps = maxSweeps;
+        summary.timeBudget = timeBudget;
+        summary.adaptiveStep = adaptiveStep;
+        summary.initialCost = costval;
+        summary.stopReason = StopReason::MinStep;
+        runStart = lastCheckpoint;
+        std::deque<Scalar> recentCosts(1, costval);
+        bool stop;
+        
+        if (activeSetPeriod > 0)
+        {
+            stagnation.assign(X.size(), 0);
+        }
+        sweepsAtStep = 0;
+        forceFullSweep = false;
+        movesSinceProbe = 0;
         
-        #ifdef DEBUG
-        std::cout << "cost :" << costval << std::endl;
-        std::cout << "detK :" << detK << std::endl;
-        std::cout << "K_minus1 :" << std::endl << K_minus1 << std::endl;
-        std::cout << "X :" << std::endl << X << std::endl << std::endl;
-        #endif
         // Optimisation loop
         do
         {
-            #ifdef DEBUG
-            std::cout << " ================ Exploratory Move ================ " << std::endl;
-            #endif
-            if(exploratoryMove())
+            const Scalar sweepStartCost(costval);
+            startPhase();
+            const bool explored(exploratoryMove());
+            sweepStats.exploratoryTime = endPhase();
+            // A stopped exploratory move has not updated the whole X_move
+            if(explored && !stopRequested)
             {
-                #ifdef DEBUG
-                std::cout << "~~~ exploratory moved ~~~" << std::endl;
-                std::cout << "cost :" << costval << std::endl;
-                std::cout << "detK :" << detK << std::endl;
-                std::cout << "K_minus1 :" << std::endl << K_minus1 << std::endl;
-                std::cout << "X :" << std::endl << X << std::endl << std::endl;
-                assert(X.minCoeff() > Scalar(-1) && X.maxCoeff() < Scalar(1));
-                #endif
                 do
                 {   
                     if(patternMove(new_X, new_K_minus1, new_detK))
                     {
-                        #ifdef DEBUG
-                        std::cout << "~~~ pattern moved ~~~" << std::endl;
-                        assert(X.minCoeff() > Scalar(-1) && X.maxCoeff() < Scalar(1));
-                        #endif 
+                        ++sweepStats.inversions;
                         cost(new_costval, new_K_minus1, new_detK);
                         if (new_costval < costval)
                         {
-                            #ifdef DEBUG
-                            std::cout << "    effective ! :)" << std::endl;
-                            #endif
                             costval = new_costval;
-                            X.noalias() = new_X; 
-                            K_minus1.noalias() = new_K_minus1;
+                            X.swap(new_X);
+                            K_minus1.swap(new_K_minus1);
                             detK = new_detK;
-                            #ifdef DEBUG
-                            std::cout << "cost :" << costval << std::endl;
-                            std::cout << "detK :" << detK << std::endl;
-                            std::cout << "K_minus1 :" << std::endl << K_minus1 << std::endl;
-                            std::cout << "X :" << std::endl << X << std::endl << std::endl;
-                            #endif
+                            ++sweepStats.patternMoves;
                         }
                         else
                         {
-                            #ifdef DEBUG
-                            std::cout << "____ineffective____" << std::endl;
-                            #endif
                             break;
                         }
                     }
                     else
                     {
-                        #ifdef DEBUG
-                        std::cout << "~~~ pattern didn't move : out of bounds ~~~" << std::endl;
-                        #endif 
+                        // out of bounds
                         break;
                     }
                 }
                 while(true);
             }
-            step *= reduceStep;
-        }while(step >= minStep);
-        #ifdef DEBUG
-        std::cout << " ================ OPTIMIZATION HAS CONVERGED ================ " << std::endl;
-        std::cout << "cost :" << costval << std::endl;
-        std::cout << "detK :" << detK << std::endl;
-        std::cout << "K_minus1 :" << std::endl << K_minus1 << std::endl;
-        std::cout << "X :" << std::endl << X << std::endl << std::endl;
-        #endif
+            sweepStats.patternTime = endPhase();
+            const unsigned long accepted(sweepStats.acceptedMoves), patterns(sweepStats.patternMoves);
+            summary.evaluations += accepted + sweepStats.rejectedMoves;
+            summary.skipped += sweepStats.skippedMoves;
+            notifySweep();
+            updateStep(accepted, patterns, accepted + patterns > 0 && costval < sweepStartCost);
+            ++summary.sweeps;
+            recentCosts.push_back(costval);
+            if (recentCosts.size() > convergenceWindow + 1)
+            {
+                recentCosts.pop_front();
+            }
+            stop = stopCriterionMet(recentCosts);
+            ++sweepsSinceCheckpoint;
+            if (!checkpointPath.empty() && step >= minStep &&
+                ((checkpointSweeps > 0 && sweepsSinceCheckpoint >= checkpointSweeps) || checkpointDue()))
+            {
+                writeCheckpoint(0);
+            }
+        }while(!stop);
+        // Only the lower triangle of K_minus1 is maintained during the optimisation
+        K_minus1.template triangularView<Eigen::StrictlyUpper>() = K_minus1.transpose();
+        
+        summary.finalCost = costval;
+        summary.finalStep = step;
+        summary.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
     }
     
-    template <typename Scalar>
-    void OptimisationSolver<Scalar>::cost(Scalar& cost, const Matrix<Scalar>& K_minus1, const Scalar& detK) const
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::setStoppingCriteria(const Scalar relativeDecrease, const unsigned int _maxSweeps, const double _timeBudget)
     {
-        Scalar trace(0);
-        // Compute trace of K_minus1 * ZZt
-        # pragma omp parallel for reduction(+:trace)
-        for (unsigned int i = 0; i < ZZt.cols(); ++i)
+        relativeTolerance = relativeDecrease;
+        maxSweeps = _maxSweeps;
+        timeBudget = _timeBudget;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::setAdaptiveStep(const bool adaptive, const Scalar expansion, const Scalar _failureReduction)
+    {
+        adaptiveStep = adaptive;
+        stepExpansion = expansion;
+        failureReduction = _failureReduction;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::setActiveSet(const unsigned int revisitPeriod, const unsigned int failureThreshold, const Scalar nearMove)
+    {
+        activeSetPeriod = revisitPeriod;
+        stagnationThreshold = std::max(failureThreshold, 1u);
+        nearMoveTolerance = nearMove;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::setDriftMonitor(const unsigned int probeInterval, const Scalar tolerance, const unsigned int nbProbes)
+    {
+        driftInterval = probeInterval;
+        driftTolerance = tolerance;
+        driftProbes = nbProbes;
+    }
+    
+    template <typename Scalar, int Dim>
+    bool OptimisationSolver<Scalar, Dim>::budgetSpent () const
+    {
+        const std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - runStart);
+        return timeBudget > 0 && elapsed.count() >= timeBudget;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::updateStep (const unsigned long accepted, const unsigned long patterns, const bool progress)
+    {
+        const Scalar previousStep(step);
+        
+        if (accepted == 0)
+        {
+            ++summary.failedSweeps;
+        }
+        if (activeSetPeriod > 0 && !(adaptiveStep && patterns > 0))
+        {
+            if (progress)
+            {
+                // Keep on moving the active coordinates at this step
+                ++sweepsAtStep;
+                forceFullSweep = false;
+                return;
+            }
+            if (!fullSweep)
+            {
+                // Check the stagnant coordinates before reducing the step
+                ++sweepsAtStep;
+                forceFullSweep = true;
+                return;
+            }
+        }
+        if (adaptiveStep && patterns > 0)
+        {
+            // The moves go in a good direction : try larger ones
+            if (step < step0)
+            {
+                step = std::min(step * stepExpansion, Scalar(step0));
+                ++summary.expansions;
+            }
+        }
+        else
+        {
+            // No move at this scale : refine faster
+            step *= adaptiveStep && accepted == 0 ? failureReduction : Scalar(reduceStep);
+            ++summary.reductions;
+        }
+        
+        if (activeSetPeriod > 0)
+        {
+            if (step != previousStep)
+            {
+                // The active set is only valid for one step
+                std::fill(stagnation.begin(), stagnation.end(), 0);
+                sweepsAtStep = 0;
+            }
+            else
+            {
+                ++sweepsAtStep;
+            }
+            forceFullSweep = false;
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::updateStagnation (const unsigned int i, const MoveCandidate& candidate, const bool accepted)
+    {
+        if (accepted || candidate.bestDeltaCost <= nearMoveTolerance * abs(costval))
+        {
+            stagnation[i] = 0;
+        }
+        else if (stagnation[i] < stagnationThreshold)
         {
-            trace += K_minus1.row(i).dot(ZZt.col(i));
+            ++stagnation[i];
         }
+    }
+    
+    template <typename Scalar, int Dim>
+    bool OptimisationSolver<Scalar, Dim>::stopCriterionMet (const std::deque<Scalar>& recentCosts)
+    {
+        if (stopRequested)
+        {
+            // The time budget may have stopped the exploratory move
+            if (summary.stopReason != StopReason::TimeBudget)
+            {
+                summary.stopReason = StopReason::Requested;
+            }
+        }
+        else if (step < minStep)
+        {
+            summary.stopReason = StopReason::MinStep;
+        }
+        else if (maxSweeps > 0 && summary.sweeps >= maxSweeps)
+        {
+            summary.stopReason = StopReason::MaxSweeps;
+        }
+        else if (relativeTolerance > Scalar(0) && recentCosts.size() > convergenceWindow &&
+                 recentCosts.front() - costval <= relativeTolerance * abs(costval))
+        {
+            summary.stopReason = StopReason::RelativeDecrease;
+        }
+        else if (budgetSpent())
+        {
+            summary.stopReason = StopReason::TimeBudget;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::cost(Scalar& cost, const Matrix<Scalar>& K_minus1, const Scalar& detK) const
+    {
+        const long n(ZZt.cols());
+        // Compute trace of K_minus1 * ZZt
+        // Both matrices are symmetric : only their lower triangles are read
+        // The sum does not depend on the number of threads, so that runs can be reproduced on any machine
+        const Scalar trace(deterministicSum<Scalar>(n, [&](const long j)
+        {
+            return Scalar(2) * K_minus1.col(j).tail(n-j).dot(ZZt.col(j).tail(n-j)) - K_minus1(j,j) * ZZt(j,j);
+        }, Scalar(0), costBlockSize));
         cost = Scalar(0.5) * (num_BRDFCoefficients * log(detK) + trace);
     }
     
-    template <typename Scalar>
-    bool OptimisationSolver<Scalar>::exploratoryMove ()
+    template <typename Scalar, int Dim>
+    bool OptimisationSolver<Scalar, Dim>::exploratoryMove ()
     {
-        const auto& nbcoefs(X.rows());
-        Scalar new_detK, new_costval(std::numeric_limits<Scalar>::infinity());
-        Vector<Scalar> cov_vector(nb_data), diff_cov_vector(nb_data);
-        Matrix<Scalar> new_K_minus1(K_minus1.rows(), K_minus1.cols());
-        Vector<Scalar> X_move(nbcoefs);
-        unsigned int lv_num;
-        bool moved(false);
+        const unsigned int nbcoefs(X.rows());
+        const unsigned int batchSize(std::max(speculativeBatch, 1u));
+        std::vector<MoveCandidate> candidates(std::min(batchSize, nbcoefs));
+        std::vector<unsigned int> coordinates, batch, deferred, acceptedMoves;
+        unsigned int next, size, i, p;
+        // When resuming in the middle of a sweep, X_move holds the moves already done
+        bool moved((X_move.head(firstCoefficient).array() != Scalar(0)).any());
+        
+        updateCovarianceCache();
+        // Resynchronise the cost with K_minus1 and detK
+        cost(costval, K_minus1, detK);
+        
+        // Coordinates evaluated by this sweep : the stagnant ones are only evaluated periodically
+        const bool revisit(activeSetPeriod == 0 || forceFullSweep || sweepsAtStep % activeSetPeriod == 0);
+        coordinates.reserve(nbcoefs - firstCoefficient);
+        for (i = firstCoefficient; i < nbcoefs; ++i)
+        {
+            if (revisit || stagnation[i] < stagnationThreshold)
+            {
+                coordinates.push_back(i);
+            }
+            else
+            {
+                X_move[i] = Scalar(0);
+                ++sweepStats.skippedMoves;
+            }
+        }
+        const unsigned int nbvisited(coordinates.size());
+        fullSweep = nbvisited == nbcoefs - firstCoefficient;
         
-        for (unsigned int i(0); i < nbcoefs;++i)
+        for (next = 0; (next < nbvisited || !deferred.empty()) && !stopRequested;)
         {
-            new_costval = std::numeric_limits<Scalar>::infinity();
-            lv_num = i/latentDim;
-            computeCovVector<Scalar>(cov_vector.data(), X,
-                             X.segment(latentDim*lv_num, latentDim),
-                             latentDim, nb_data);
+            // The moves deferred by the previous batch come first
+            batch.swap(deferred);
+            deferred.clear();
+            for (; batch.size() < batchSize && next < nbvisited; ++next)
+            {
+                batch.push_back(coordinates[next]);
+            }
+            size = batch.size();
             
-            X[i] += step;
-            X_move[i] = step;
-            if ( X[i] < Scalar(1)) // latent variable constraint
+            // Evaluate the moves of the batch concurrently against the current K_minus1
+            # pragma omp parallel for schedule(dynamic) if(size > 1)
+            for (p = 0; p < size; ++p)
             {
-                computeCovVector<Scalar>(diff_cov_vector.data(), X,
-                                 X.segment(latentDim*lv_num,latentDim),
-                                 latentDim, nb_data);
-                diff_cov_vector = diff_cov_vector - cov_vector;
-                
-                // Update K_minus1 and detK with Sherman-Morisson formula
-                shermanMorissonUpdate(K_minus1, new_K_minus1,
-                                      detK, new_detK,
-                                      lv_num, diff_cov_vector);
-                // Update costval
-                cost(new_costval, new_K_minus1, new_detK);
+                evaluateCoefficient(batch[p], candidates[p]);
             }
-            if (new_costval > costval)
+            
+            // Accept the improving moves in order
+            acceptedMoves.clear();
+            for (p = 0; p < size; ++p)
             {
-                X[i] -= Scalar(2)*step;
-                X_move[i] = -step;
-                if (X[i] > Scalar(-1)) // latent variable constraint
+                i = batch[p];
+                MoveCandidate& candidate(candidates[p]);
+                if (candidate.improves && !acceptedMoves.empty())
                 {
-                    computeCovVector<Scalar>(diff_cov_vector.data(), X,
-                                     X.segment(latentDim*lv_num, latentDim),
-                                     latentDim, nb_data);
-                    diff_cov_vector = diff_cov_vector - cov_vector;
-                    
-                    // Update K_minus1 and detK with Sherman-Morisson formula
-                    shermanMorissonUpdate(K_minus1, new_K_minus1, 
-                                          detK, new_detK,
-                                          lv_num, diff_cov_vector);
-                    // Update cost
-                    cost(new_costval, new_K_minus1, new_detK);
-                }   
-                if (new_costval > costval)
+                    const auto sameLatentVariable([&](const unsigned int q) { return batch[q]/dimension() == i/dimension(); });
+                    if (std::any_of(acceptedMoves.begin(), acceptedMoves.end(), sameLatentVariable))
+                    {
+                        X_move[i] = Scalar(0);
+                        deferred.push_back(i);
+                        continue;
+                    }
+                    // Previous moves of the batch have changed K_minus1 : correct the chosen move in their order
+                    for (const unsigned int q : acceptedMoves)
+                    {
+                        correctMove(i, candidate, batch[q]/dimension(), candidates[q]);
+                    }
+                    candidate.improves = candidate.deltaCost <= Scalar(0);
+                }
+                if (candidate.improves)
                 {
-                    X[i] += step;
-                    X_move[i] = Scalar(0);
+                    acceptMove(i, candidate);
+                    acceptedMoves.push_back(p);
+                    moved = true;
+                    ++sweepStats.acceptedMoves;
+                    ++sweepStats.updates;
+                    notifyMove(i, X_move[i], candidate.deltaCost);
                 }
                 else
                 {
-                    costval = new_costval;
-                    // cost has changed -> keep new_K_minus1 and new_detK
-                    K_minus1.noalias() = new_K_minus1;
-                    detK = new_detK;
-                    moved = true;
+                    X_move[i] = Scalar(0);
+                    ++sweepStats.rejectedMoves;
+                }
+                if (activeSetPeriod > 0)
+                {
+                    updateStagnation(i, candidate, candidate.improves);
                 }
             }
-            else
+            if (driftInterval > 0 && movesSinceProbe >= driftInterval)
+            {
+                monitorDrift();
+            }
+            
+            // A checkpoint cannot hold the deferred moves
+            if (!checkpointPath.empty() && next < nbvisited && deferred.empty() && checkpointDue())
             {
-                costval = new_costval;
-                // cost has changed -> keep new_K_minus1 and new_detK
-                K_minus1.noalias() = new_K_minus1;
-                detK = new_detK;
-                moved = true;
+                writeCheckpoint(coordinates[next]);
+            }
+            if ((next < nbvisited || !deferred.empty()) && budgetSpent())
+            {
+                // Stops like requestStop : the solution stays consistent
+                summary.stopReason = StopReason::TimeBudget;
+                stopRequested = true;
             }
         }
+        firstCoefficient = 0;
         return moved;
     }
     
-    template <typename Scalar>
-    void OptimisationSolver<Scalar>::shermanMorissonUpdate (
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::evaluateCoefficient (
+        const unsigned int i,
+        MoveCandidate& candidate) const
+    {
+        candidate.improves = false;
+        candidate.bestDeltaCost = std::numeric_limits<Scalar>::infinity();
+        if (X[i] + step < Scalar(1)) // latent variable constraint
+        {
+            evaluateMove(i, true, candidate);
+            candidate.improves = candidate.deltaCost <= Scalar(0);
+            candidate.bestDeltaCost = candidate.deltaCost;
+        }
+        if (!candidate.improves && X[i] - step > Scalar(-1)) // latent variable constraint
+        {
+            evaluateMove(i, false, candidate);
+            candidate.improves = candidate.deltaCost <= Scalar(0);
+            candidate.bestDeltaCost = std::min(candidate.bestDeltaCost, candidate.deltaCost);
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::evaluateMove (
+        const unsigned int i,
+        const bool positive,
+        MoveCandidate& candidate) const
+    {
+        const unsigned int lv_num(i/dimension());
+        SymmetricUpdate& update(candidate.update);
+        
+        candidate.positive = positive;
+        computeDiffCovVector(candidate.diff_cov_vector, lv_num, i%dimension(), positive);
+        prepareUpdate(K_minus1, lv_num, candidate.diff_cov_vector, update);
+        
+        // new_K_minus1 = K_minus1 - w1*ut - w2*vt
+        // so tr(new_K_minus1*ZZt) = tr(K_minus1*ZZt) - ut*ZZt*w1 - vt*ZZt*w2
+        candidate.ZZt_w1.noalias() = ZZt.template selfadjointView<Eigen::Lower>() * update.w1;
+        candidate.ZZt_w2.noalias() = ZZt.template selfadjointView<Eigen::Lower>() * update.w2;
+        const Scalar traceDecrease(update.u.dot(candidate.ZZt_w1) + update.v.dot(candidate.ZZt_w2));
+        
+        candidate.deltaCost = Scalar(0.5) * (num_BRDFCoefficients * log(update.detFactor) - traceDecrease);
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::correctMove (
+        const unsigned int i,
+        MoveCandidate& candidate,
+        const unsigned int moved,
+        const MoveCandidate& accepted) const
+    {
+        const unsigned int lv_num(i/dimension());
+        SymmetricUpdate& update(candidate.update);
+        const SymmetricUpdate& acceptedUpdate(accepted.update);
+        Vector<Scalar>& diff_cov_vector(candidate.diff_cov_vector);
+        
+        // Covariance between the moved latent variable and lv_num after the evaluated move
+        LatentVector<Scalar, Dim> after(X.segment(dimension()*lv_num, dimension()));
+        after[i%dimension()] += candidate.positive ? step : -step;
+        const LatentVector<Scalar, Dim> x_moved(X.segment(dimension()*moved, dimension()));
+        const Scalar delta(covariance<Scalar, Dim>(x_moved, after, mu, l) - K(moved, lv_num) - diff_cov_vector[moved]);
+        
+        // diff_cov_vector changes by delta*e_moved, and K_minus1*e_moved is the w1 of the accepted move
+        diff_cov_vector[moved] += delta;
+        update.w2 += delta * acceptedUpdate.w1;
+        candidate.ZZt_w2 += delta * accepted.ZZt_w1;
+        
+        // new_K_minus1*x = K_minus1*x - w1*(ut*x) - w2*(vt*x) for x = e_lv_num and x = diff_cov_vector
+        const Scalar centerCoeff(diff_cov_vector[lv_num]);
+        diff_cov_vector[lv_num] = Scalar(0);
+        const Scalar u1(acceptedUpdate.u[lv_num]), v1(acceptedUpdate.v[lv_num]);
+        const Scalar u2(acceptedUpdate.u.dot(diff_cov_vector)), v2(acceptedUpdate.v.dot(diff_cov_vector));
+        diff_cov_vector[lv_num] = centerCoeff;
+        update.w1 -= u1 * acceptedUpdate.w1 + v1 * acceptedUpdate.w2;
+        update.w2 -= u2 * acceptedUpdate.w1 + v2 * acceptedUpdate.w2;
+        candidate.ZZt_w1 -= u1 * accepted.ZZt_w1 + v1 * accepted.ZZt_w2;
+        candidate.ZZt_w2 -= u2 * accepted.ZZt_w1 + v2 * accepted.ZZt_w2;
+        
+        solveUpdate(lv_num, diff_cov_vector, update);
+        const Scalar traceDecrease(update.u.dot(candidate.ZZt_w1) + update.v.dot(candidate.ZZt_w2));
+        candidate.deltaCost = Scalar(0.5) * (num_BRDFCoefficients * log(update.detFactor) - traceDecrease);
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::acceptMove (
+        const unsigned int i,
+        const MoveCandidate& candidate)
+    {
+        X_move[i] = candidate.positive ? step : -step;
+        X[i] += X_move[i];
+        // cost has changed -> update K_minus1 and detK in place
+        applyUpdate(K_minus1, K_minus1, candidate.update);
+        detK *= candidate.update.detFactor;
+        costval += candidate.deltaCost;
+        moveCovarianceCache(i/dimension(), i%dimension(), candidate.diff_cov_vector);
+        ++movesSinceProbe;
+    }
+    
+    template <typename Scalar, int Dim>
+    Scalar OptimisationSolver<Scalar, Dim>::inverseResidual (const unsigned int nbProbes)
+    {
+        std::bernoulli_distribution sign;
+        Matrix<Scalar> V(nb_data, std::max(nbProbes, 1u)), W;
+        for (long j = 0; j < V.cols(); ++j)
+        {
+            for (long i = 0; i < nb_data; ++i)
+            {
+                V(i,j) = sign(probeGenerator) ? Scalar(1) : Scalar(-1);
+            }
+        }
+        // Only the lower triangle of K_minus1 is up to date
+        W.noalias() = K_minus1.template selfadjointView<Eigen::Lower>() * V;
+        V.noalias() -= K * W;
+        return V.norm() / sqrt(Scalar(nb_data * V.cols()));
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::monitorDrift ()
+    {
+        const Scalar residual(inverseResidual(driftProbes));
+        movesSinceProbe = 0;
+        ++summary.driftProbes;
+        summary.maxResidual = std::max(summary.maxResidual, residual);
+        if (residual > driftTolerance)
+        {
+            // Start again from the covariance matrix of X
+            computeCovMatrix<Scalar, Dim>(K, X, dimension(), mu, l);
+            K_minus1 = K;
+            invertCovariance(K_minus1, detK);
+            cost(costval, K_minus1, detK);
+            ++sweepStats.inversions;
+            ++summary.refactorisations;
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::updateCovarianceCache ()
+    {
+        const Scalar scale(step/(l*l));
+        
+        computeCovMatrix<Scalar, Dim>(K, X, dimension(), mu, l);
+        
+        // Coordinates of the latent variables as a structure of arrays
+        expStepX = (scale * toStructureOfArrays<Scalar, Dim>(X, dimension())).array().exp();
+        expMinusStepX = expStepX.cwiseInverse();
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::computeDiffCovVector (
+        Vector<Scalar>& diff_cov_vector,
+        const unsigned int lv_num,
+        const unsigned int coord,
+        const bool positive) const
+    {
+        const Scalar scale(step/(l*l));
+        const Scalar x(X[dimension()*lv_num + coord]);
+        
+        // covariance after move = covariance before move * factor * exp(+/-step*x_j/l^2)
+        if (positive)
+        {
+            const Scalar factor(exp(-Scalar(0.5)*step*scale - scale*x));
+            diff_cov_vector.array() = K.col(lv_num).array() * (factor*expStepX.col(coord).array() - Scalar(1));
+        }
+        else
+        {
+            const Scalar factor(exp(-Scalar(0.5)*step*scale + scale*x));
+            diff_cov_vector.array() = K.col(lv_num).array() * (factor*expMinusStepX.col(coord).array() - Scalar(1));
+        }
+        // The covariance of a latent variable with itself does not depend on its position
+        diff_cov_vector[lv_num] = Scalar(0);
+        
+        // The factor only applies to the exponential part : the covariances that have or get the mu term
+        // (latent variables that coincide with the moving one before or after the move) are computed again
+        const Scalar epsilon(std::numeric_limits<Scalar>::epsilon());
+        const LatentVector<Scalar, Dim> before(X.segment(dimension()*lv_num, dimension()));
+        LatentVector<Scalar, Dim> after(before);
+        after[coord] += positive ? step : -step;
+        for (unsigned int j = 0; j < nb_data; ++j)
+        {
+            const LatentVector<Scalar, Dim> x_j(X.segment(dimension()*j, dimension()));
+            if (j != lv_num && ((x_j - before).squaredNorm() < epsilon || (x_j - after).squaredNorm() < epsilon))
+            {
+                diff_cov_vector[j] = covariance<Scalar, Dim>(x_j, after, mu, l) - K(j, lv_num);
+            }
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::moveCovarianceCache (
+        const unsigned int lv_num,
+        const unsigned int coord,
+        const Vector<Scalar>& diff_cov_vector)
+    {
+        K.col(lv_num) += diff_cov_vector;
+        K.row(lv_num) = K.col(lv_num).transpose();
+        
+        expStepX(lv_num, coord) = exp(step/(l*l) * X[dimension()*lv_num + coord]);
+        expMinusStepX(lv_num, coord) = Scalar(1) / expStepX(lv_num, coord);
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::shermanMorissonUpdate (
         const Matrix<Scalar>& old_K_minus1,
         Matrix<Scalar>& new_K_minus1,
         const Scalar& old_detK,
@@ -237,91 +675,294 @@ namespace ChefDevr
         assert(old_detK != 0.0);
         #endif
         
-        Scalar centerCoeff(diff_cov_vector[lv_num]);
+        SymmetricUpdate update;
+        prepareUpdate(old_K_minus1, lv_num, diff_cov_vector, update);
         
-        // ===== One row modification =====
-        Scalar dotp1(diff_cov_vector.dot(old_K_minus1.col(lv_num)) + Scalar(1));
-        // Determinant update
-        new_detK = dotp1 * old_detK;
+        new_detK = update.detFactor * old_detK;
+        applyUpdate(old_K_minus1, new_K_minus1, update);
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::prepareUpdate (
+        const Matrix<Scalar>& K_minus1,
+        const unsigned int lv_num,
+        Vector<Scalar>& diff_cov_vector,
+        SymmetricUpdate& update) const
+    {
+        const long n(K_minus1.rows());
+        const Scalar centerCoeff(diff_cov_vector[lv_num]);
         
-        // Inverse update 
-        new_K_minus1.noalias() =
-            (old_K_minus1 - ( ((old_K_minus1.col(lv_num)*(diff_cov_vector.transpose()/dotp1))*old_K_minus1))
-            ).eval();
+        // The row and the column lv_num of K change together, so that K stays symmetric :
+        // new_K = K + U*S*Ut with U = [e, d] and S = [[centerCoeff, 1], [1, 0]]
+        // where e is the lv_num-th unit vector and d is diff_cov_vector without its lv_num-th coefficient.
+        // Woodbury formula gives new_K_minus1 = K_minus1 - W*inverse(M)*Wt
+        // with W = K_minus1*U and M = inverse(S) + Ut*K_minus1*U
+        diff_cov_vector[lv_num] = Scalar(0);
         
-        // ===== One column modification =====
+        update.w1.resize(n);
+        // w1 = K_minus1*e : column lv_num of K_minus1 read from its lower triangle
+        update.w1.head(lv_num) = K_minus1.row(lv_num).head(lv_num).transpose();
+        update.w1.tail(n-lv_num) = K_minus1.col(lv_num).tail(n-lv_num);
+        // w2 = K_minus1*d
+        update.w2.noalias() = K_minus1.template selfadjointView<Eigen::Lower>() * diff_cov_vector;
+        
+        diff_cov_vector[lv_num] = centerCoeff;
+        solveUpdate(lv_num, diff_cov_vector, update);
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::solveUpdate (
+        const unsigned int lv_num,
+        Vector<Scalar>& diff_cov_vector,
+        SymmetricUpdate& update) const
+    {
+        const Scalar centerCoeff(diff_cov_vector[lv_num]);
         diff_cov_vector[lv_num] = Scalar(0);
         
-        dotp1 = new_K_minus1.row(lv_num).dot(diff_cov_vector) + Scalar(1);
+        const Scalar m11(update.w1[lv_num]);
+        const Scalar m12(update.w2[lv_num] + Scalar(1));
+        const Scalar m22(diff_cov_vector.dot(update.w2) - centerCoeff);
+        const Scalar detM(m11*m22 - m12*m12);
         
-        // Determinant update
-        new_detK = dotp1 * new_detK;
+        // Determinant update : det(new_K) = det(K) * det(S) * det(M) with det(S) = -1
+        update.detFactor = -detM;
         
-        // Inverse update
-        new_K_minus1 = 
-            (new_K_minus1 - ( new_K_minus1*(diff_cov_vector/dotp1)*new_K_minus1.row(lv_num))
-            ).eval();
+        // [u v] = W*inverse(M)
+        update.u.noalias() = (m22*update.w1 - m12*update.w2) / detM;
+        update.v.noalias() = (m11*update.w2 - m12*update.w1) / detM;
         
         diff_cov_vector[lv_num] = centerCoeff;
     }
     
-    template <typename Scalar>
-    bool OptimisationSolver<Scalar>::patternMove (Vector<Scalar>& new_X, Matrix<Scalar>& new_K_minus1, Scalar& new_detK) const
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::applyUpdate (
+        const Matrix<Scalar>& old_K_minus1,
+        Matrix<Scalar>& new_K_minus1,
+        const SymmetricUpdate& update) const
+    {
+        const long n(old_K_minus1.rows());
+        // Lower triangle only : new_K_minus1 = K_minus1 - w1*ut - w2*vt
+        # pragma omp parallel for schedule(guided)
+        for (long j = 0; j < n; ++j)
+        {
+            new_K_minus1.col(j).tail(n-j) = old_K_minus1.col(j).tail(n-j)
+                                            - update.u[j]*update.w1.tail(n-j) - update.v[j]*update.w2.tail(n-j);
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    bool OptimisationSolver<Scalar, Dim>::patternMove (Vector<Scalar>& new_X, Matrix<Scalar>& new_K_minus1, Scalar& new_detK) const
     {
-        unsigned int i;
         new_X = X + X_move;
         if (new_X.minCoeff() > Scalar(-1) && new_X.maxCoeff() < Scalar(1))
         {
             // Compute new_K (in new_K_minus1 so we don't have to allocate more memory)
-            for (i=0; i<nb_data; ++i){
-                computeCovVector<Scalar>(new_K_minus1.col(i).data(), new_X,
-                                 new_X.segment(i*latentDim, latentDim),
-                                 latentDim, nb_data);
-            }
-            // Compute new_detK
-            new_detK = new_K_minus1.determinant();
-            // Compute new_K_minus1
-            new_K_minus1 = new_K_minus1.inverse().eval();
+            computeCovMatrix<Scalar, Dim>(new_K_minus1, new_X, dimension(), mu, l);
+            // Compute new_detK and new_K_minus1
+            invertCovariance(new_K_minus1, new_detK);
             return true;
         }
         return false;
     }
     
-    template <typename Scalar>
-    void OptimisationSolver<Scalar>::initX (const Matrix<Scalar>& ZZt)
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::invertCovariance (Matrix<Scalar>& K, Scalar& detK) const
     {
-        // Use EigenSolver to compute eigen vector/values decomposition
-        Eigen::EigenSolver<Matrix<Scalar>> solver(ZZt, true);
-
-        const Vector<Scalar>& eigenValues(solver.eigenvalues().real());
-        const Matrix<Scalar>& eigenVectors(solver.eigenvectors().real());
-         
-        // Use std::sort to sort an indices vector in the same way eigen values should be ordered
-        // initialize original index locations
-        std::vector<size_t> idx(eigenValues.size());
-        std::iota(idx.begin(), idx.end(), 0);
-        // sort indexes based on comparing values in eigenValues
-        std::function<size_t(size_t, size_t)> cmpIndices(
-            [&eigenValues](size_t i1, size_t i2) {
-                return eigenValues[i1] > eigenValues[i2];
-            }
-        );
-
-        std::sort(idx.begin(), idx.end(),cmpIndices);
-        
-        // Build V the transposed matrix of ordered eigen vectors 
-        Matrix<Scalar> V(latentDim, eigenVectors.cols());
-        # pragma omp parallel for
-        for (unsigned int i=0; i<latentDim; ++i)
+        // K is symmetric positive definite (mu > 0) : Cholesky factorisation
+        const Eigen::LLT<Matrix<Scalar>> llt(K);
+        if (llt.info() == Eigen::Success)
+        {
+            const Scalar detL(llt.matrixLLT().diagonal().prod());
+            detK = detL * detL;
+            K.setIdentity();
+            llt.solveInPlace(K);
+        }
+        else
         {
-            // use sorted indices to retrieve eigen vectors in descending order
-            V.row(i).noalias() = eigenVectors.col(idx[i]).transpose();
+            // Not numerically positive definite : fall back on LU factorisation
+            const Eigen::PartialPivLU<Matrix<Scalar>> lu(K);
+            detK = lu.determinant();
+            K = lu.inverse();
         }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::initX (const Matrix<Scalar>& ZZt)
+    {
+        // Only the latentDim leading eigen vectors of the symmetric matrix ZZt are needed
+        Vector<Scalar> eigenValues;
+        Matrix<Scalar> eigenVectors;
+        computeLeadingEigenPairs(ZZt, dimension(), eigenValues, eigenVectors);
         
-        // X as column vector
-        X  = Eigen::Map<Vector<Scalar>>(V.data(), latentDim*nb_data, 1);
+        // X as column vector : the coordinates of a latent variable are contiguous
+        const Matrix<Scalar> V(eigenVectors.transpose());
+        X  = Eigen::Map<const Vector<Scalar>>(V.data(), dimension()*nb_data, 1);
 
         // normalize X
         X = X / (std::numeric_limits<Scalar>::epsilon() + std::max(abs(X.maxCoeff()), abs(X.minCoeff())));
     }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::setCheckpoint(const std::string& path, const double interval, const unsigned int sweeps)
+    {
+        checkpointPath = path;
+        checkpointInterval = interval;
+        checkpointSweeps = sweeps;
+    }
+    
+    template <typename Scalar, int Dim>
+    bool OptimisationSolver<Scalar, Dim>::checkpointDue () const
+    {
+        const std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - lastCheckpoint);
+        return checkpointInterval > 0 && elapsed.count() >= checkpointInterval;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::writeCheckpoint (const unsigned int nextCoefficient)
+    {
+        const std::string tmpPath(checkpointPath + ".tmp");
+        const std::uint32_t version(checkpointVersion), scalarSize(sizeof(Scalar)), dim(latentDim), next(nextCoefficient);
+        const std::int64_t n(nb_data), D(num_BRDFCoefficients);
+        
+        lastCheckpoint = std::chrono::steady_clock::now();
+        sweepsSinceCheckpoint = 0;
+        
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Could not create checkpoint file \"" << tmpPath << "\"" << std::endl;
+            return;
+        }
+        
+        writeRaw(file, checkpointMagic(), 8);
+        writeRaw(file, &version, 1);
+        writeRaw(file, &scalarSize, 1);
+        writeRaw(file, &n, 1);
+        writeRaw(file, &dim, 1);
+        writeRaw(file, &D, 1);
+        writeRaw(file, &mu, 1);
+        writeRaw(file, &l, 1);
+        writeRaw(file, &next, 1);
+        writeRaw(file, &step, 1);
+        writeRaw(file, &detK, 1);
+        writeRaw(file, &costval, 1);
+        writeRaw(file, X.data(), X.size());
+        writeRaw(file, X_move.data(), X_move.size());
+        // Only the lower triangle of K_minus1 is up to date
+        for (long j = 0; j < nb_data; ++j)
+        {
+            writeRaw(file, K_minus1.col(j).data() + j, nb_data - j);
+        }
+        file.close();
+        
+        if (!file)
+        {
+            std::cerr << "Could not write checkpoint file \"" << tmpPath << "\"" << std::endl;
+            std::remove(tmpPath.c_str());
+        }
+        else if (std::rename(tmpPath.c_str(), checkpointPath.c_str()) != 0)
+        {
+            std::cerr << "Could not rename checkpoint file \"" << tmpPath << "\" to \"" << checkpointPath << "\"" << std::endl;
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::loadCheckpoint (const std::string& path)
+    {
+        char magic[8];
+        std::uint32_t version, scalarSize, dim, next;
+        std::int64_t n, D;
+        Scalar file_mu, file_l;
+        
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw OptimisationSolverError("Could not open checkpoint file \"" + path + "\"");
+        }
+        
+        readRaw(file, magic, 8);
+        readRaw(file, &version, 1);
+        if (!file || std::memcmp(magic, checkpointMagic(), 8) != 0 || version != checkpointVersion)
+        {
+            throw OptimisationSolverError("\"" + path + "\" is not a checkpoint file of this version");
+        }
+        readRaw(file, &scalarSize, 1);
+        readRaw(file, &n, 1);
+        readRaw(file, &dim, 1);
+        readRaw(file, &D, 1);
+        readRaw(file, &file_mu, 1);
+        readRaw(file, &file_l, 1);
+        if (!file || scalarSize != sizeof(Scalar) || n != nb_data || dim != latentDim ||
+            D != num_BRDFCoefficients || file_mu != mu || file_l != l)
+        {
+            throw OptimisationSolverError("Checkpoint file \"" + path + "\" was written for another problem");
+        }
+        
+        readRaw(file, &next, 1);
+        readRaw(file, &step, 1);
+        readRaw(file, &detK, 1);
+        readRaw(file, &costval, 1);
+        readRaw(file, X.data(), X.size());
+        readRaw(file, X_move.data(), X_move.size());
+        for (long j = 0; j < nb_data; ++j)
+        {
+            readRaw(file, K_minus1.col(j).data() + j, nb_data - j);
+        }
+        if (!file || file.peek() != std::ifstream::traits_type::eof() || next > X.size())
+        {
+            throw OptimisationSolverError("Checkpoint file \"" + path + "\" is corrupted");
+        }
+        
+        firstCoefficient = next;
+        resumed = true;
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::startPhase ()
+    {
+        if (!observers.empty())
+        {
+            phaseStart = std::chrono::steady_clock::now();
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    double OptimisationSolver<Scalar, Dim>::endPhase ()
+    {
+        if (observers.empty())
+        {
+            return 0.;
+        }
+        const auto now(std::chrono::steady_clock::now());
+        const std::chrono::duration<double> elapsed(now - phaseStart);
+        phaseStart = now;
+        return elapsed.count();
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::notifyMove (const unsigned int i, const Scalar move, const Scalar deltaCost) const
+    {
+        if (!observers.empty())
+        {
+            const MoveEvent<Scalar> event{sweepStats.sweep, i, static_cast<unsigned int>(X.rows()), move, deltaCost, costval};
+            for (auto observer : observers)
+            {
+                observer->onMove(event);
+            }
+        }
+    }
+    
+    template <typename Scalar, int Dim>
+    void OptimisationSolver<Scalar, Dim>::notifySweep ()
+    {
+        sweepStats.cost = costval;
+        sweepStats.step = step;
+        for (auto observer : observers)
+        {
+            observer->onSweep(sweepStats);
+        }
+        const unsigned int sweep(sweepStats.sweep);
+        sweepStats = SweepEvent<Scalar>();
+        sweepStats.sweep = sweep + 1;
+    }
 } // namespace ChefDevr
@@ -0,0 +1,317 @@
+#ifndef SPARSEOPTIMISATIONSOLVER_H
+#define SPARSEOPTIMISATIONSOLVER_H
+
+/**
+ * @file SparseOptimisationSolver.h
+ */
+
+#include "Parametrisation/types.h"
+#include "Parametrisation/Parametrisation.h"
+#include <cmath>
+
+
+namespace ChefDevr
+{
+    /**
+     * @brief Class that solves a sparse approximation of the optimisation problem defined in the research paper:
+     * A Versatile Parametrisation for Measured Materials Manifold.
+     * Computes an optimised mapping from BRDFs space to a latent space
+     * using m inducing points in the latent space
+     * @tparam Scalar The type of scalar number to do computations with.
+     *
+     * The covariance matrix K of the latent variables is approximated by Q + mu*I
+     * where Q = Knm * inverse(Kmm) * Kmn is the Nystrom approximation given by the inducing points,
+     * and the cost function is the negative variational bound of Titsias (2009) :
+     * 0.5 * (D * log(det(Q + mu*I)) + tr(inverse(Q + mu*I) * ZZt)) + D/(2*mu) * tr(Knn - Q).
+     * No n x n matrix is stored : ZZt is given as a low rank factor V (ZZt ~ V*Vt)
+     * and every move of a latent coordinate costs O(m^2 + m*r) operations.
+     * The inducing points are chosen among the initial latent variables and do not move.
+     */
+    template <typename Scalar>
+    class SparseOptimisationSolver {
+    public:
+
+        /**
+         * @brief Constructor
+         * @param num_BRDFCoefficients Number of coefficients of each BRDF
+         * @param minStep Step below which solution is considered optimal
+         * @param V Low rank factor of Z * (Z transposed) : ZZt ~ V * (V transposed),
+         * with its columns sorted by decreasing norm (see lowRankFactor, or BRDFReader::createLowRankFactor_centered which streams Z)
+         * @param traceZZt Trace of Z * (Z transposed)
+         * @param latentDim Dimension of optimised latent space
+         * @param nbInducing Number of inducing points
+         * @param mu Value of the mu constant of the covariance function
+         * @param l Value of the l constant of the covariance function
+         */
+        SparseOptimisationSolver(
+            long num_BRDFCoefficients,
+            Scalar minStep,
+            const Matrix<Scalar>& V,
+            Scalar traceZZt,
+            unsigned int latentDim,
+            unsigned int nbInducing,
+            Scalar mu = MU_DEFAULT,
+            Scalar l = L_DEFAULT);
+
+        ~SparseOptimisationSolver() = default;
+
+        /**
+         * @brief Computes the optimized parametrisation of the BRDFs manifold.
+         * Uses Hook & Jeeves method to solve the optimisation
+         */
+        void optimizeMapping ();
+
+        /**
+         * @return A reference of the latent variables vector
+         */
+        inline const Vector<Scalar>& getLatentVariables() const { return X; }
+
+        /**
+         * @return A reference of the inducing points vector (coordinates stored like the latent variables)
+         */
+        inline const Vector<Scalar>& getInducingPoints() const { return Xu; }
+
+        /**
+         * @return A reference of the sparse inverse mapping matrix inverse(A) * Kmn (m x n)
+         * where A = mu * Kmm + Kmn * Knm
+         *
+         * The matrix is computed once optimizeMapping has returned.
+         * A BRDF is reconstructed from the covariance vector k between its coordinates and the inducing points
+         * as kt * inverse(A) * Kmn * Z
+         */
+        inline const Matrix<Scalar>& getInverseMapping() const { return projection; }
+
+        /**
+         * @return A reference of the value of the cost function for the solution
+         */
+        inline const Scalar& getCostValue() const { return state.cost; }
+
+        /**
+         * @brief Computes a low rank factor V of a symmetric positive semi-definite matrix such that ZZt ~ V * (V transposed)
+         * @param ZZt Z * (Z transposed)
+         * @param rank Number of columns of V
+         * @return The factor V whose columns are the leading eigen vectors scaled by the square root of their eigen values
+         */
+        static Matrix<Scalar> lowRankFactor (const Matrix<Scalar>& ZZt, unsigned int rank);
+
+    private:
+
+        /**
+         * @brief Initial value of the step
+         */
+        static constexpr Scalar step0 = .5f;
+
+        /**
+         * @brief Factor of step reduction
+         */
+        static constexpr Scalar reduceStep = .5f;
+
+        /** @brief Step below wich solution is considered optimal */
+        const Scalar minStep;
+
+        /**
+         * @brief Value of the step for Hooke & Jeeves method
+         */
+        Scalar step;
+
+        /**
+         * @brief Number of BRDFs
+         */
+        const long nb_data;
+
+        /**
+         * @brief Number of inducing points
+         */
+        const long nb_inducing;
+
+        /**
+         * @brief Number of coefficients of each BRDF
+         */
+        const long num_BRDFCoefficients;
+
+        /**
+         * @brief Low rank factor of Z*Ztransposed
+         */
+        const Matrix<Scalar> V;
+
+        /**
+         * @brief Trace of Z*Ztransposed
+         */
+        const Scalar traceZZt;
+
+        /**
+         * @brief Dimension of produced latent space
+         */
+        unsigned int latentDim;
+
+        /**
+         * @brief Value of the mu constant of the covariance function
+         */
+        const Scalar mu;
+
+        /**
+         * @brief Value of the l constant of the covariance function
+         */
+        const Scalar l;
+
+        /**
+         * @brief Latent variables vector
+         */
+        Vector<Scalar> X;
+
+        /**
+         * @brief The movement vector of X that should improve the solution
+         */
+        Vector<Scalar> X_move;
+
+        /**
+         * @brief Inducing points vector
+         */
+        Vector<Scalar> Xu;
+
+        /**
+         * @brief Inducing points stored as a structure of arrays
+         */
+        LatentMatrix<Scalar> XuSoa;
+
+        /**
+         * @brief Covariance matrix of the inducing points (Kmm + mu*I)
+         */
+        Matrix<Scalar> Kmm;
+
+        /**
+         * @brief Inverse of Kmm + mu*I
+         */
+        Matrix<Scalar> Kmm_minus1;
+
+        /**
+         * @brief Logarithm of the determinant of Kmm + mu*I
+         */
+        Scalar logDetKmm;
+
+        /**
+         * @brief Part of the solution that depends on the latent variables
+         */
+        struct State
+        {
+            /** @brief Covariance matrix between the inducing points and the latent variables (m x n) */
+            Matrix<Scalar> Kmn;
+            /** @brief Inverse of A = mu * Kmm + Kmn * Knm */
+            Matrix<Scalar> A_minus1;
+            /** @brief Logarithm of the determinant of A */
+            Scalar logDetA;
+            /** @brief Kmn * V */
+            Matrix<Scalar> B;
+            /** @brief B * Bt */
+            Matrix<Scalar> C;
+            /** @brief tr(inverse(A) * C) */
+            Scalar traceAC;
+            /** @brief tr(Q) */
+            Scalar traceQ;
+            /** @brief Value of the cost function */
+            Scalar cost;
+        };
+
+        /**
+         * @brief Current solution
+         */
+        State state;
+
+        /**
+         * @brief sparse inverse mapping matrix inverse(A) * Kmn
+         */
+        Matrix<Scalar> projection;
+
+        /**
+         * @brief Move of one coordinate of X evaluated during an exploratory move
+         */
+        struct MoveCandidate
+        {
+            /** @brief Covariance vector between the moved latent variable and the inducing points */
+            Vector<Scalar> k;
+            /** @brief Difference between k and the covariance vector before the move */
+            Vector<Scalar> delta;
+            /** @brief B * V.row(lv_num) transposed */
+            Vector<Scalar> b;
+            /** @brief inverse(A) * [k_old, delta] */
+            Matrix<Scalar> W;
+            /** @brief 2 x 2 capacitance matrix of the update of inverse(A) */
+            Eigen::Matrix<Scalar, 2, 2> M_minus1;
+            /** @brief det(new_A) / det(A) */
+            Scalar detFactor;
+            /** @brief Change of tr(inverse(A) * C) */
+            Scalar deltaTraceAC;
+            /** @brief Change of tr(Q) */
+            Scalar deltaTraceQ;
+            /** @brief Change of the cost function */
+            Scalar deltaCost;
+        };
+
+        /**
+         * @brief Computes the cost function from the other members of a state
+         * @param st The state whose cost is computed
+         */
+        void cost (State& st) const;
+
+        /**
+         * @brief Computes the whole state for latent variables
+         * @param X Latent variables vector
+         * @param st The state to fill
+         *
+         * Costs O(n*m^2 + n*m*r) operations
+         */
+        void computeState (const Vector<Scalar>& X, State& st) const;
+
+        /**
+         * @brief Updates the movement vector of X that improves the solution (X_move)
+         * @return True if has moved, false otherwise
+         *
+         * Adds and substracts step from each element
+         * and reevaluate the cost function to check for better solutions
+         */
+        bool exploratoryMove ();
+
+        /**
+         * @brief Evaluates the change of the cost function when a coordinate of X moves
+         * @param i Index of the coordinate in X
+         * @param move Value added to the coordinate
+         * @param candidate The evaluated move (filled in this function)
+         *
+         * The inverse of A changes by a rank-2 update : the change of the cost is computed
+         * in O(m^2 + m*r) operations without modifying the state
+         */
+        void evaluateMove (unsigned int i, Scalar move, MoveCandidate& candidate) const;
+
+        /**
+         * @brief Applies an evaluated move to X and to the state
+         * @param i Index of the coordinate in X
+         * @param move Value added to the coordinate
+         * @param candidate The evaluated move
+         */
+        void acceptMove (unsigned int i, Scalar move, const MoveCandidate& candidate);
+
+        /**
+         * @brief Apply X_move to the latent variable vector X.
+         * @param new_X Latent variables vector to apply the move on
+         * @param new_state State of new_X to fill
+         * @return true if effectively moved, false otherwise
+         */
+        bool patternMove (Vector<Scalar>& new_X, State& new_state) const;
+
+        /**
+         * @brief Initializes the latent coordinates vector X by applying the PCA method
+         * (leading columns of V) and reducing its coordinates between [-1; 1]
+         */
+        void initX ();
+
+        /**
+         * @brief Chooses the inducing points among the latent variables by farthest point sampling
+         * and computes Kmm, Kmm_minus1 and logDetKmm
+         */
+        void initInducingPoints ();
+    };
+} // namespace ChefDevr
+
+#include "SparseOptimisationSolver.hpp"
+
+#endif // SPARSEOPTIMISATIONSOLVER_H
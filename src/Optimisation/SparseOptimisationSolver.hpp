@@ -0,0 +1,317 @@
+#include "SparseOptimisationSolver.h"
+
+/**
+ * @file SparseOptimisationSolver.hpp
+ */
+
+#include <algorithm>
+#include <limits>
+#include <Eigen/LU>
+#include <Eigen/Cholesky>
+#include "SymmetricEigenSolver.h"
+
+namespace ChefDevr
+{
+    template <typename Scalar>
+    SparseOptimisationSolver<Scalar>::SparseOptimisationSolver(
+        const long _num_BRDFCoefficients,
+        const Scalar _minStep,
+        const Matrix<Scalar>& _V,
+        const Scalar _traceZZt,
+        const unsigned int _latentDim,
+        const unsigned int _nbInducing,
+        const Scalar _mu,
+        const Scalar _l) :
+        minStep(_minStep),
+        step(step0),
+        nb_data(_V.rows()),
+        nb_inducing(std::min(long(_nbInducing), long(_V.rows()))),
+        num_BRDFCoefficients(_num_BRDFCoefficients),
+        V(_V),
+        traceZZt(_traceZZt),
+        latentDim(_latentDim),
+        mu(_mu),
+        l(_l),
+        X(_V.rows()*_latentDim),
+        X_move(_V.rows()*_latentDim),
+        Xu(nb_inducing*_latentDim){}
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::optimizeMapping ()
+    {
+        Vector<Scalar> new_X(latentDim*nb_data);
+        State new_state;
+
+        initX();
+        initInducingPoints();
+        computeState(X, state);
+
+        // Optimisation loop
+        do
+        {
+            if (exploratoryMove())
+            {
+                while (patternMove(new_X, new_state) && new_state.cost < state.cost)
+                {
+                    X.swap(new_X);
+                    std::swap(state, new_state);
+                }
+            }
+            step *= reduceStep;
+        }while(step >= minStep);
+
+        projection.noalias() = state.A_minus1 * state.Kmn;
+    }
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::cost (State& st) const
+    {
+        const Scalar D(num_BRDFCoefficients);
+        // log(det(Q + mu*I)) = (n-m)*log(mu) + log(det(A)) - log(det(Kmm))
+        const Scalar logDetK(Scalar(nb_data - nb_inducing) * log(mu) + st.logDetA - logDetKmm);
+        // tr(inverse(Q + mu*I) * ZZt) = (tr(ZZt) - tr(inverse(A) * Kmn * ZZt * Knm)) / mu
+        const Scalar trace((traceZZt - st.traceAC) / mu);
+        // Knn has ones on its diagonal
+        st.cost = Scalar(0.5) * (D * logDetK + trace) + D / (Scalar(2) * mu) * (Scalar(nb_data) - st.traceQ);
+    }
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::computeState (const Vector<Scalar>& X, State& st) const
+    {
+        st.Kmn.resize(nb_inducing, nb_data);
+        # pragma omp parallel for
+        for (long k = 0; k < nb_data; ++k)
+        {
+            // No noise term between distinct sets of points
+            computeCovVectorSoA<Scalar>(st.Kmn.col(k).data(), XuSoa, X.segment(k*latentDim, latentDim), Scalar(0), l);
+        }
+
+        // A = mu * Kmm + Kmn * Knm (lower triangle)
+        Matrix<Scalar> A(mu * Kmm);
+        A.template selfadjointView<Eigen::Lower>().rankUpdate(st.Kmn);
+        const Eigen::LLT<Matrix<Scalar>> llt(A);
+        if (llt.info() == Eigen::Success)
+        {
+            st.logDetA = Scalar(0);
+            for (long j = 0; j < nb_inducing; ++j)
+            {
+                st.logDetA += Scalar(2) * log(llt.matrixLLT()(j,j));
+            }
+            st.A_minus1.setIdentity(nb_inducing, nb_inducing);
+            llt.solveInPlace(st.A_minus1);
+        }
+        else
+        {
+            A.template triangularView<Eigen::StrictlyUpper>() = A.transpose();
+            const Eigen::PartialPivLU<Matrix<Scalar>> lu(A);
+            st.logDetA = log(lu.determinant());
+            st.A_minus1 = lu.inverse();
+        }
+
+        st.B.noalias() = st.Kmn * V;
+        st.C.noalias() = st.B * st.B.transpose();
+        st.traceAC = st.A_minus1.cwiseProduct(st.C).sum();
+        st.traceQ = st.Kmn.cwiseProduct(Kmm_minus1 * st.Kmn).sum();
+        cost(st);
+    }
+
+    template <typename Scalar>
+    bool SparseOptimisationSolver<Scalar>::exploratoryMove ()
+    {
+        const unsigned int nbcoefs(X.rows());
+        MoveCandidate candidate;
+        Scalar move;
+        bool moved(false), improves;
+
+        // Resynchronise the state after the rank-2 updates of the previous sweep
+        computeState(X, state);
+
+        for (unsigned int i = 0; i < nbcoefs; ++i)
+        {
+            improves = false;
+            if (X[i] + step < Scalar(1)) // latent variable constraint
+            {
+                move = step;
+                evaluateMove(i, move, candidate);
+                improves = candidate.deltaCost <= Scalar(0);
+            }
+            if (!improves && X[i] - step > Scalar(-1)) // latent variable constraint
+            {
+                move = -step;
+                evaluateMove(i, move, candidate);
+                improves = candidate.deltaCost <= Scalar(0);
+            }
+            if (improves)
+            {
+                acceptMove(i, move, candidate);
+                X_move[i] = move;
+                moved = true;
+            }
+            else
+            {
+                X_move[i] = Scalar(0);
+            }
+        }
+        return moved;
+    }
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::evaluateMove (
+        const unsigned int i,
+        const Scalar move,
+        MoveCandidate& candidate) const
+    {
+        const unsigned int lv_num(i/latentDim);
+        const Scalar D(num_BRDFCoefficients);
+        Vector<Scalar> coord(X.segment(lv_num*latentDim, latentDim));
+        coord[i%latentDim] += move;
+
+        candidate.k.resize(nb_inducing);
+        computeCovVectorSoA<Scalar>(candidate.k.data(), XuSoa, coord, Scalar(0), l);
+        const auto k_old(state.Kmn.col(lv_num));
+        candidate.delta = candidate.k - k_old;
+
+        // Column lv_num of Kmn changes : new_A = A + new_k*new_kt - k*kt = A + P*S*Pt
+        // with P = [k, delta] and S = [[0, 1], [1, 1]].
+        // Woodbury formula gives new_A_minus1 = A_minus1 - W*inverse(M)*Wt
+        // with W = A_minus1*P and M = inverse(S) + Pt*A_minus1*P
+        candidate.W.resize(nb_inducing, 2);
+        candidate.W.col(0).noalias() = state.A_minus1 * k_old;
+        candidate.W.col(1).noalias() = state.A_minus1 * candidate.delta;
+        Eigen::Matrix<Scalar, 2, 2> M;
+        M(0,0) = k_old.dot(candidate.W.col(0)) - Scalar(1);
+        M(0,1) = M(1,0) = Scalar(1) + Scalar(0.5) * (k_old.dot(candidate.W.col(1)) + candidate.delta.dot(candidate.W.col(0)));
+        M(1,1) = candidate.delta.dot(candidate.W.col(1));
+        const Scalar detM(M(0,0)*M(1,1) - M(0,1)*M(1,0));
+        // det(new_A) = det(A) * det(S) * det(M) with det(S) = -1
+        candidate.detFactor = -detM;
+        candidate.M_minus1 << M(1,1), -M(0,1), -M(1,0), M(0,0);
+        candidate.M_minus1 /= detM;
+
+        // B = Kmn*V and C = B*Bt : new_C = C + delta*bt + b*deltat + |v|^2 * delta*deltat
+        // with v the row lv_num of V and b = B*v
+        const Scalar vv(V.row(lv_num).squaredNorm());
+        candidate.b.noalias() = state.B * V.row(lv_num).transpose();
+        Matrix<Scalar> newC_W(state.C * candidate.W);
+        const Eigen::Matrix<Scalar, 1, 2> bt_W(candidate.b.transpose() * candidate.W);
+        const Eigen::Matrix<Scalar, 1, 2> deltat_W(candidate.delta.transpose() * candidate.W);
+        newC_W.noalias() += candidate.delta * (bt_W + vv * deltat_W);
+        newC_W.noalias() += candidate.b * deltat_W;
+        // tr(new_A_minus1*new_C) = tr(A_minus1*new_C) - tr(inverse(M)*Wt*new_C*W)
+        const Eigen::Matrix<Scalar, 2, 2> Wt_newC_W(candidate.W.transpose() * newC_W);
+        candidate.deltaTraceAC = Scalar(2) * candidate.W.col(1).dot(candidate.b)
+                                 + vv * candidate.W.col(1).dot(candidate.delta)
+                                 - candidate.M_minus1.cwiseProduct(Wt_newC_W.transpose()).sum();
+
+        candidate.deltaTraceQ = candidate.k.dot(Kmm_minus1 * candidate.k) - k_old.dot(Kmm_minus1 * k_old);
+
+        if (candidate.detFactor > Scalar(0))
+        {
+            candidate.deltaCost = Scalar(0.5) * (D * log(candidate.detFactor) - candidate.deltaTraceAC / mu)
+                                  - D / (Scalar(2) * mu) * candidate.deltaTraceQ;
+        }
+        else
+        {
+            // Numerically singular update : never accepted
+            candidate.deltaCost = std::numeric_limits<Scalar>::infinity();
+        }
+    }
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::acceptMove (
+        const unsigned int i,
+        const Scalar move,
+        const MoveCandidate& candidate)
+    {
+        const unsigned int lv_num(i/latentDim);
+        const Scalar vv(V.row(lv_num).squaredNorm());
+
+        X[i] += move;
+        state.A_minus1.noalias() -= candidate.W * candidate.M_minus1 * candidate.W.transpose();
+        state.logDetA += log(candidate.detFactor);
+        state.C.noalias() += candidate.delta * (candidate.b + vv * candidate.delta).transpose();
+        state.C.noalias() += candidate.b * candidate.delta.transpose();
+        state.B.noalias() += candidate.delta * V.row(lv_num);
+        state.Kmn.col(lv_num) = candidate.k;
+        state.traceAC += candidate.deltaTraceAC;
+        state.traceQ += candidate.deltaTraceQ;
+        state.cost += candidate.deltaCost;
+    }
+
+    template <typename Scalar>
+    bool SparseOptimisationSolver<Scalar>::patternMove (Vector<Scalar>& new_X, State& new_state) const
+    {
+        new_X = X + X_move;
+        if (new_X.minCoeff() > Scalar(-1) && new_X.maxCoeff() < Scalar(1))
+        {
+            computeState(new_X, new_state);
+            return true;
+        }
+        return false;
+    }
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::initX ()
+    {
+        // The columns of V are the principal components of Z scaled by the square root of their eigen values
+        for (long k = 0; k < nb_data; ++k)
+        {
+            for (unsigned int c = 0; c < latentDim; ++c)
+            {
+                X[k*latentDim + c] = V(k, c) / V.col(c).norm();
+            }
+        }
+
+        // normalize X
+        X = X / (std::numeric_limits<Scalar>::epsilon() + std::max(abs(X.maxCoeff()), abs(X.minCoeff())));
+    }
+
+    template <typename Scalar>
+    void SparseOptimisationSolver<Scalar>::initInducingPoints ()
+    {
+        // Farthest point sampling : each inducing point is the latent variable
+        // that is the farthest from the inducing points already chosen
+        Vector<Scalar> minSqDist(Vector<Scalar>::Constant(nb_data, std::numeric_limits<Scalar>::infinity()));
+        long chosen(0);
+        for (long j = 0; j < nb_inducing; ++j)
+        {
+            Xu.segment(j*latentDim, latentDim) = X.segment(chosen*latentDim, latentDim);
+            for (long k = 0; k < nb_data; ++k)
+            {
+                minSqDist[k] = std::min(minSqDist[k],
+                    (X.segment(k*latentDim, latentDim) - Xu.segment(j*latentDim, latentDim)).squaredNorm());
+            }
+            minSqDist.maxCoeff(&chosen);
+        }
+
+        XuSoa = toStructureOfArrays<Scalar>(Xu, latentDim);
+
+        // Kmm is regularised by mu like the covariance matrix of the latent variables
+        computeCovMatrix<Scalar>(Kmm, Xu, latentDim, mu, l);
+        const Eigen::LLT<Matrix<Scalar>> llt(Kmm);
+        logDetKmm = Scalar(0);
+        for (long j = 0; j < nb_inducing; ++j)
+        {
+            logDetKmm += Scalar(2) * log(llt.matrixLLT()(j,j));
+        }
+        Kmm_minus1.setIdentity(nb_inducing, nb_inducing);
+        llt.solveInPlace(Kmm_minus1);
+    }
+
+    template <typename Scalar>
+    Matrix<Scalar> SparseOptimisationSolver<Scalar>::lowRankFactor (const Matrix<Scalar>& ZZt, const unsigned int rank)
+    {
+        const long n(ZZt.rows());
+        const long r(std::min(long(rank), n));
+        using std::sqrt;
+        Vector<Scalar> eigenValues;
+        Matrix<Scalar> eigenVectors;
+        computeLeadingEigenPairs(ZZt, r, eigenValues, eigenVectors);
+        Matrix<Scalar> V(n, r);
+        for (long j = 0; j < r; ++j)
+        {
+            V.col(j) = eigenVectors.col(j) * sqrt(std::max(eigenValues[j], Scalar(0)));
+        }
+        return V;
+    }
+} // namespace ChefDevr
@@ -0,0 +1,42 @@
+#ifndef SYMMETRICEIGENSOLVER_H
+#define SYMMETRICEIGENSOLVER_H
+
+/**
+ * @file SymmetricEigenSolver.h
+ */
+
+#include "Parametrisation/types.h"
+
+
+namespace ChefDevr
+{
+    /**
+     * @brief Computes the leading eigen pairs of a symmetric positive semi-definite matrix
+     * @param A Symmetric positive semi-definite matrix (n x n)
+     * @param k Number of eigen pairs to compute
+     * @param[out] eigenValues The k largest eigen values in decreasing order
+     * @param[out] eigenVectors The corresponding normalised eigen vectors (n x k)
+     * @param tolerance Residual norm of the eigen pairs, relative to the largest eigen value, below which they are considered converged
+     * @param maxIterations Maximum number of iterations of the subspace iteration
+     * @return True if the eigen pairs have converged
+     *
+     * For small matrices, all the eigen pairs are computed with Eigen::SelfAdjointEigenSolver.
+     * Otherwise a subspace iteration with Rayleigh-Ritz projection is run on a block of
+     * k + oversampling vectors : each iteration costs O(n^2 * k) operations instead of the O(n^3)
+     * of a complete decomposition. If it has not converged after maxIterations, the current
+     * Ritz approximations are returned.
+     * The sign of each eigen vector is chosen so that its coefficient of largest magnitude is positive.
+     */
+    template <typename Scalar>
+    bool computeLeadingEigenPairs (
+        const Matrix<Scalar>& A,
+        unsigned int k,
+        Vector<Scalar>& eigenValues,
+        Matrix<Scalar>& eigenVectors,
+        Scalar tolerance = Scalar(1e-10),
+        unsigned int maxIterations = 300);
+} // namespace ChefDevr
+
+#include "SymmetricEigenSolver.hpp"
+
+#endif // SYMMETRICEIGENSOLVER_H
@@ -0,0 +1,85 @@
+#include "SymmetricEigenSolver.h"
+
+/**
+ * @file SymmetricEigenSolver.hpp
+ */
+
+#include <algorithm>
+#include <random>
+#include <Eigen/Eigenvalues>
+#include <Eigen/QR>
+
+namespace ChefDevr
+{
+    template <typename Scalar>
+    bool computeLeadingEigenPairs (
+        const Matrix<Scalar>& A,
+        const unsigned int k,
+        Vector<Scalar>& eigenValues,
+        Matrix<Scalar>& eigenVectors,
+        const Scalar tolerance,
+        const unsigned int maxIterations)
+    {
+        const long n(A.rows());
+        const long nbPairs(std::min(long(k), n));
+        // Oversampling speeds up the convergence of the k leading pairs
+        const long p(std::min(n, nbPairs + std::max(nbPairs, 10L)));
+        bool converged(false);
+
+        if (n <= 256 || 4*p >= n)
+        {
+            // Eigen values are sorted in increasing order
+            const Eigen::SelfAdjointEigenSolver<Matrix<Scalar>> solver(A);
+            eigenValues = solver.eigenvalues().tail(nbPairs).reverse();
+            eigenVectors = solver.eigenvectors().rightCols(nbPairs).rowwise().reverse();
+            converged = true;
+        }
+        else
+        {
+            // Deterministic random starting block
+            std::mt19937 generator(0);
+            std::normal_distribution<double> normal;
+            Matrix<Scalar> Q(n, p), Y(n, p), T(p, p), W(p, p);
+            for (long j = 0; j < p; ++j)
+            {
+                for (long i = 0; i < n; ++i)
+                {
+                    Q(i, j) = Scalar(normal(generator));
+                }
+            }
+            Q = Eigen::HouseholderQR<Matrix<Scalar>>(Q).householderQ() * Matrix<Scalar>::Identity(n, p);
+
+            for (unsigned int iteration(0); iteration < maxIterations && !converged; ++iteration)
+            {
+                Y.noalias() = A * Q;
+                // Rayleigh-Ritz projection on the current subspace
+                T.noalias() = Q.transpose() * Y;
+                const Eigen::SelfAdjointEigenSolver<Matrix<Scalar>> ritz(T);
+                W = ritz.eigenvectors().rowwise().reverse();
+                eigenValues = ritz.eigenvalues().reverse().head(nbPairs);
+                eigenVectors.noalias() = Q * W.leftCols(nbPairs);
+
+                // Residuals A*v - lambda*v of the leading pairs
+                const Matrix<Scalar> residual((Y * W.leftCols(nbPairs)) - eigenVectors * eigenValues.asDiagonal());
+                converged = residual.colwise().norm().maxCoeff() <= tolerance * abs(eigenValues[0]);
+
+                if (!converged)
+                {
+                    Q = Eigen::HouseholderQR<Matrix<Scalar>>(Y * W).householderQ() * Matrix<Scalar>::Identity(n, p);
+                }
+            }
+        }
+
+        // Sign convention : the coefficient of largest magnitude is positive
+        for (long j = 0; j < nbPairs; ++j)
+        {
+            long i;
+            eigenVectors.col(j).cwiseAbs().maxCoeff(&i);
+            if (eigenVectors(i, j) < Scalar(0))
+            {
+                eigenVectors.col(j) = -eigenVectors.col(j);
+            }
+        }
+        return converged;
+    }
+} // namespace ChefDevr
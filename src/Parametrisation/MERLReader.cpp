@@ -1,5 +1,6 @@
 #include "MERLReader.h"
 
+#include <algorithm>
 #include <experimental/filesystem>
 
 #include <Eigen/Geometry>
@@ -30,6 +31,20 @@ namespace ChefDevr {
         phi_diff = atan2(diff[1], diff[0]);
     }
 
+    unsigned int MERLReader::lookup_index(double theta_in, double phi_in, double theta_out, double phi_out) {
+        // Convert to halfangle / difference angle coordinates
+        double theta_half, phi_half, theta_diff, phi_diff;
+        std_coords_to_half_diff_coords(theta_in, phi_in, theta_out, phi_out, theta_half, phi_half, theta_diff,
+                                       phi_diff);
+
+        // Find index.
+        // Note that phi_half is ignored, since isotropic BRDFs are assumed
+        return phi_diff_index(phi_diff) +
+               theta_diff_index(theta_diff) * samplingResolution_phiD / 2 +
+               theta_half_index(theta_half) * samplingResolution_phiD / 2 *
+               samplingResolution_thetaD;
+    }
+
     Vector3d MERLReader::rotate_vector(const Vector3d &vector, const Vector3d &axis, double angle) {
         const double cos_angle = cos(angle);
         Vector3d out = vector * cos_angle;
@@ -106,6 +121,30 @@ namespace ChefDevr {
         std::fclose(file);
     }
 
+    void MERLReader::read_brdf_coefficients(const char *filePath, const unsigned int first, const unsigned int count,
+                                            double *coefficients) {
+        if (first + count > num_coefficientsBRDF) {
+            throw MERLReaderError{"The coefficients to read are out of the brdf"};
+        }
+        FILE *file = fopen(filePath, "rb");
+        if (!file) {
+            throw MERLReaderError{string{"The file "} + filePath + " could not have been opened"};
+        }
+
+        // The coefficients follow the 3 dimensions of the brdf
+        const long offset = long(3 * sizeof(unsigned int) + first * sizeof(double));
+        if (std::fseek(file, offset, SEEK_SET) != 0 ||
+            fread(coefficients, sizeof(double), count, file) < count) {
+            std::fclose(file);
+            throw MERLReaderError{"The coefficients of the brdf has not been successfully read"};
+        }
+        std::fclose(file);
+
+        for (unsigned int i = 0; i < count; ++i) {
+            coefficients[i] = std::max(coefficients[i], 0.0);
+        }
+    }
+
     unsigned int MERLReader::theta_diff_index(double theta_diff)
     {
         int result = int(theta_diff / (M_PI * 0.5) * samplingResolution_thetaD);
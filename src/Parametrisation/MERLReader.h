@@ -19,6 +19,18 @@ namespace ChefDevr {
                                                              * samplingResolution_thetaD
                                                              * samplingResolution_phiD / 2;
 
+        /**
+         * @brief Offset between the coefficients of two consecutive color channels (red, green then blue)
+         */
+        constexpr static unsigned int channelStride = num_coefficientsBRDF / 3;
+
+        /**
+         * @brief Scales applied to the coefficients of each color channel by lookup_brdf_val
+         */
+        constexpr static double red_scale = 1.0 / 1500.0;
+        constexpr static double green_scale = 1.15 / 1500.0;
+        constexpr static double blue_scale = 1.66 / 1500.0;
+
 
         MERLReader() = delete;
 
@@ -44,6 +56,18 @@ namespace ChefDevr {
         template<typename Scalar>
         static RowVector<Scalar> read_brdf(const char *filePath);
 
+        /**
+         * @brief Reads consecutive coefficients of a BRDF from a file
+         * @param filePath Path of brdf file
+         * @param first Index of the first coefficient to read
+         * @param count Number of coefficients to read
+         * @param coefficients The array of count values to fill (negative values are clamped to zero as in read_brdf)
+         *
+         * If the file is not found or is too short, returns an error
+         */
+        static void read_brdf_coefficients(const char *filePath, unsigned int first, unsigned int count,
+                                           double *coefficients);
+
         /**
          * @brief Extracts a color in a BRDF from a pair of incoming and outgoing angles
          * @param[in] brdf the BRDF from which the color is extracted
@@ -60,6 +84,16 @@ namespace ChefDevr {
                                     double theta_out, double phi_out, double &red_value, double &green_value,
                                     double &blue_value);
 
+        /**
+         * @brief Computes the index of the red coefficient of a pair of incoming and outgoing angles
+         * @param[in] theta_in incoming angle of theta
+         * @param[in] phi_in incoming angle of phi
+         * @param[in] theta_out outgoing angle of theta
+         * @param[in] phi_out outgoing angle of phi
+         * @return The index of the red coefficient, the green and blue ones follow with a step of channelStride
+         */
+        static unsigned int lookup_index(double theta_in, double phi_in, double theta_out, double phi_out);
+
     class MERLReaderError : public std::runtime_error {
     public:
         explicit MERLReaderError(const std::string& msg) :
@@ -67,14 +101,6 @@ namespace ChefDevr {
     };
 
     private:
-        /* ------------*/
-        /* Attributes */
-        /* ------------*/
-
-        constexpr static double red_scale = 1.0 / 1500.0;
-        constexpr static double green_scale = 1.15 / 1500.0;
-        constexpr static double blue_scale = 1.66 / 1500.0;
-
         /* ------------*/
         /* Functions */
         /* ------------*/
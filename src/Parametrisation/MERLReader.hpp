@@ -5,23 +5,11 @@ namespace ChefDevr {
     void MERLReader::lookup_brdf_val(const RowVector<Scalar>& brdf, double theta_in, double phi_in,
                                      double theta_out, double phi_out, double &red_value, double &green_value,
                                      double &blue_value) {
-        // Convert to halfangle / difference angle coordinates
-        double theta_half, phi_half, theta_diff, phi_diff;
-        std_coords_to_half_diff_coords(theta_in, phi_in, theta_out, phi_out, theta_half, phi_half, theta_diff,
-                                       phi_diff);
-
-        // Find index.
-        // Note that phi_half is ignored, since isotropic BRDFs are assumed
-        const unsigned int index = phi_diff_index(phi_diff) +
-                                   theta_diff_index(theta_diff) * samplingResolution_phiD / 2 +
-                                   theta_half_index(theta_half) * samplingResolution_phiD / 2 *
-                                   samplingResolution_thetaD;
-
-        const int stepBlue = samplingResolution_thetaH * samplingResolution_thetaD * samplingResolution_phiD;
+        const unsigned int index = lookup_index(theta_in, phi_in, theta_out, phi_out);
 
         red_value = (double) (brdf[index] * red_scale);
-        green_value = (double) (brdf[index + stepBlue / 2] * green_scale);
-        blue_value = (double) (brdf[index + stepBlue] * blue_scale);
+        green_value = (double) (brdf[index + channelStride] * green_scale);
+        blue_value = (double) (brdf[index + 2 * channelStride] * blue_scale);
 
         if (red_value < 0.0 || green_value < 0.0 || blue_value < 0.0) {
             throw MERLReaderError{"Below horizon."};
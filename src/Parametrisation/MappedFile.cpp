@@ -0,0 +1,70 @@
+#include "MappedFile.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace ChefDevr {
+
+    MappedFile::MappedFile(const std::string &path) : address(nullptr), length(0) {
+        const int descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw MappedFileError{"The file " + path + " could not have been opened : " + std::strerror(errno)};
+        }
+        struct stat status;
+        if (fstat(descriptor, &status) < 0) {
+            close(descriptor);
+            throw MappedFileError{"The size of the file " + path + " could not have been read"};
+        }
+        length = std::size_t(status.st_size);
+        map(descriptor, false, path);
+    }
+
+    MappedFile::MappedFile(const std::string &path, const std::size_t size) : address(nullptr), length(size) {
+        const int descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (descriptor < 0) {
+            throw MappedFileError{"The file " + path + " could not have been created : " + std::strerror(errno)};
+        }
+        if (ftruncate(descriptor, off_t(size)) < 0) {
+            close(descriptor);
+            throw MappedFileError{"The file " + path + " could not have been resized : " + std::strerror(errno)};
+        }
+        map(descriptor, true, path);
+    }
+
+    MappedFile::~MappedFile() {
+        if (address) {
+            munmap(address, length);
+        }
+    }
+
+    void MappedFile::map(const int descriptor, const bool writable, const std::string &path) {
+        if (length == 0) {
+            close(descriptor);
+            throw MappedFileError{"The file " + path + " is empty"};
+        }
+        void *mapping = mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+        // The mapping keeps its own reference to the file
+        close(descriptor);
+        if (mapping == MAP_FAILED) {
+            throw MappedFileError{"The file " + path + " could not have been mapped : " + std::strerror(errno)};
+        }
+        address = static_cast<char *>(mapping);
+    }
+
+    void MappedFile::flush() {
+        if (msync(address, length, MS_SYNC) < 0) {
+            throw MappedFileError{std::string{"The mapped file could not have been written : "} + std::strerror(errno)};
+        }
+    }
+
+    void MappedFile::adviseSequential() const {
+        madvise(address, length, MADV_SEQUENTIAL);
+    }
+
+}
@@ -0,0 +1,97 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+/**
+ * @file MappedFile.h
+ * @brief Files mapped in memory
+ */
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief File mapped in the address space of the process
+     *
+     * The pages are read from the disk when they are accessed and can be released by the system
+     * at any time : the resident memory stays bounded whatever the size of the file.
+     */
+    class MappedFile {
+    public:
+        /**
+         * @brief Maps an existing file for reading
+         * @param path Path of the file
+         */
+        explicit MappedFile(const std::string &path);
+
+        /**
+         * @brief Creates a file of the given size (or truncates an existing one) and maps it for writing
+         * @param path Path of the file
+         * @param size Size of the file in bytes
+         */
+        MappedFile(const std::string &path, std::size_t size);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /**
+         * @return The first byte of the file
+         */
+        inline const char *data() const { return address; }
+
+        /**
+         * @return The first byte of the file
+         * @pre The file is mapped for writing
+         */
+        inline char *data() { return address; }
+
+        /**
+         * @return The size of the file in bytes
+         */
+        inline std::size_t size() const { return length; }
+
+        /**
+         * @brief Writes the modified pages to the disk
+         */
+        void flush();
+
+        /**
+         * @brief Advises the system that the file will be read sequentially
+         */
+        void adviseSequential() const;
+
+        class MappedFileError : public std::runtime_error {
+        public:
+            explicit MappedFileError(const std::string &msg) :
+                    std::runtime_error(msg) {}
+        };
+
+    private:
+        /**
+         * @brief Maps the opened file
+         * @param descriptor Descriptor of the opened file
+         * @param writable True if the file is mapped for writing
+         * @param path Path of the file (for the error messages)
+         */
+        void map(int descriptor, bool writable, const std::string &path);
+
+        /**
+         * @brief First byte of the mapping
+         */
+        char *address;
+
+        /**
+         * @brief Size of the mapping in bytes
+         */
+        std::size_t length;
+    };
+
+}
+
+#endif // MAPPED_FILE_H_
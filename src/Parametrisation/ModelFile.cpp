@@ -0,0 +1,59 @@
+#include "ModelFile.h"
+
+#include <cstring>
+#include <fstream>
+
+
+namespace ChefDevr {
+
+    ModelHeader readModelHeader(const std::string &path) {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            throw ModelFileError{"Could not open the model file " + path};
+        }
+        const std::uint64_t fileSize(file.tellg());
+        ModelHeader header;
+        file.seekg(0);
+        if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+            throw ModelFileError{"The model file " + path + " is too short"};
+        }
+        checkModelHeader(header, fileSize);
+        return header;
+    }
+
+    void checkModelHeader(const ModelHeader &header, const std::uint64_t fileSize) {
+        if (std::memcmp(header.magic, "BRDFMDL", 8) != 0) {
+            throw ModelFileError{"The file is not a model file"};
+        }
+        if (header.version != modelFileVersion) {
+            throw ModelFileError{"The model file has the version " + std::to_string(header.version) +
+                                 ", expected " + std::to_string(modelFileVersion)};
+        }
+        const std::uint64_t nbBRDFs(header.nbBRDFs), nbCoefficients(header.nbCoefficients);
+        // Bounds the products below, whatever the header holds
+        if (nbBRDFs > fileSize || nbCoefficients > fileSize || header.latentDim > fileSize ||
+            header.scalarSize > 64 || header.storageSize > 64) {
+            throw ModelFileError{"The size of the model file does not match its header"};
+        }
+        // Each section must be aligned and end before the next one
+        const std::uint64_t sections[][2] = {
+                {header.hyperparametersOffset, 2 * header.scalarSize},
+                {header.latentOffset,          nbBRDFs * header.latentDim * header.scalarSize},
+                {header.inverseMappingOffset,  nbBRDFs * nbBRDFs * header.scalarSize},
+                {header.meanOffset,            nbCoefficients * header.scalarSize},
+                {header.filenamesOffset,       header.filenamesSize},
+                {header.mappingOffset,         nbBRDFs * nbCoefficients * header.storageSize}};
+        std::uint64_t end(sizeof(ModelHeader));
+        for (const auto &section : sections) {
+            if (section[0] % modelSectionAlignment != 0 || section[0] < end) {
+                throw ModelFileError{"The sections of the model file are not aligned"};
+            }
+            end = section[0] + section[1];
+        }
+        if (header.latentDim == 0 || nbBRDFs == 0 || nbCoefficients == 0 ||
+            end != header.fileSize || header.fileSize != fileSize) {
+            throw ModelFileError{"The size of the model file does not match its header"};
+        }
+    }
+
+}
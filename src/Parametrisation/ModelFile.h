@@ -0,0 +1,130 @@
+#ifndef MODEL_FILE__H
+#define MODEL_FILE__H
+
+/**
+ * @file ModelFile.h
+ * @brief Self-contained binary file of a trained parametrisation, meant to be mapped in memory
+ *
+ * The file starts with a ModelHeader, followed by sections aligned on modelSectionAlignment bytes :
+ * - the mu and l constants of the covariance function (2 Scalar) ;
+ * - the latent variables vector X (nbBRDFs x latentDim Scalar) ;
+ * - the inverse mapping matrix K_minus1 (nbBRDFs x nbBRDFs Scalar, column major) ;
+ * - the mean BRDF (nbCoefficients Scalar) ;
+ * - the names of the BRDF files, in the order of the latent variables, each one followed by '\n' ;
+ * - the reconstruction matrix K_minus1 * Zcentered (nbBRDFs x nbCoefficients Storage, row major).
+ *
+ * The values are in the byte order of the machine that wrote the file.
+ */
+
+#include "Parametrisation.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace ChefDevr
+{
+    /**
+     * @brief Version of the model files written by writeModelFile
+     */
+    constexpr std::uint32_t modelFileVersion = 1;
+
+    /**
+     * @brief Alignment of the sections of a model file in bytes (a cache line, enough for any vector instruction set)
+     */
+    constexpr std::uint64_t modelSectionAlignment = 64;
+
+    /**
+     * @brief Header of a model file
+     */
+    struct ModelHeader
+    {
+        /** @brief Identifies a model file ("BRDFMDL") */
+        char magic[8];
+        /** @brief Version of the format (modelFileVersion) */
+        std::uint32_t version;
+        /** @brief Dimension of the latent space */
+        std::uint32_t latentDim;
+        /** @brief Number of BRDFs of the parametrisation */
+        std::uint64_t nbBRDFs;
+        /** @brief Number of coefficients of a BRDF */
+        std::uint64_t nbCoefficients;
+        /** @brief Size in bytes and number of mantissa digits of the computation type */
+        std::uint32_t scalarSize;
+        std::uint32_t scalarDigits;
+        /** @brief Size in bytes and number of mantissa digits of the type of the reconstruction matrix */
+        std::uint32_t storageSize;
+        std::uint32_t storageDigits;
+        /** @brief Offsets of the sections in bytes */
+        std::uint64_t hyperparametersOffset;
+        std::uint64_t latentOffset;
+        std::uint64_t inverseMappingOffset;
+        std::uint64_t meanOffset;
+        std::uint64_t filenamesOffset;
+        /** @brief Size of the names of the BRDF files in bytes */
+        std::uint64_t filenamesSize;
+        std::uint64_t mappingOffset;
+        /** @brief Size of the whole file in bytes */
+        std::uint64_t fileSize;
+    };
+
+    /**
+     * @brief Writes a trained parametrisation in a model file
+     * @tparam Storage The type of the stored reconstruction matrix (see BRDFReconstructorWithZ)
+     * @param path Path of the file
+     * @param Zcentered Centered BRDFs data matrix (BRDFs stored in row major)
+     * @param K_minus1 Inverse mapping matrix
+     * @param X Latent variables vector
+     * @param meanBRDF The mean BRDF (mean of the rows of Z before it was centered)
+     * @param latentDim Dimension of the latent space
+     * @param brdfsFilenames Names of the BRDF files, in the order of the latent variables
+     * @param mu Value of the mu constant that helps interpolation source data
+     * @param l Constant defined in the research paper
+     *
+     * The reconstruction matrix is computed block of coefficients by block of coefficients directly in the file.
+     * The file is written next to its path and renamed once complete : a process mapping the path
+     * never sees a partial model. Throws a ModelFileError if the arguments are not consistent.
+     */
+    template <typename Scalar, typename Storage = Scalar>
+    void writeModelFile (
+        const std::string& path,
+        const Matrix<Scalar>& Zcentered,
+        const Matrix<Scalar>& K_minus1,
+        const Vector<Scalar>& X,
+        const RowVector<Scalar>& meanBRDF,
+        unsigned int latentDim,
+        const std::vector<std::string>& brdfsFilenames,
+        Scalar mu = MU_DEFAULT,
+        Scalar l = L_DEFAULT);
+
+    /**
+     * @brief Reads the header of a model file, to choose the types of its reconstructor
+     * @param path Path of the file
+     * @return The header
+     *
+     * Throws a ModelFileError if the file is not a model file of the current version
+     */
+    ModelHeader readModelHeader (const std::string& path);
+
+    /**
+     * @brief Checks that a header is the one of a model file of the current version,
+     * whose sections are aligned and within the file
+     * @param header The header of the file
+     * @param fileSize Size of the file in bytes
+     *
+     * Throws a ModelFileError otherwise
+     */
+    void checkModelHeader (const ModelHeader& header, std::uint64_t fileSize);
+
+    class ModelFileError : public std::runtime_error {
+    public:
+        explicit ModelFileError(const std::string& msg) :
+                std::runtime_error(msg){}
+    };
+} // ChefDevr
+
+#include "ModelFile.hpp"
+
+#endif // MODEL_FILE__H
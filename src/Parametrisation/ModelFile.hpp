@@ -0,0 +1,99 @@
+#include "MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+
+namespace ChefDevr
+{
+    /**
+     * @param offset An offset in bytes
+     * @return The smallest offset aligned on modelSectionAlignment bytes not below the given one
+     */
+    inline std::uint64_t alignModelSection (const std::uint64_t offset)
+    {
+        return (offset + modelSectionAlignment - 1) / modelSectionAlignment * modelSectionAlignment;
+    }
+
+    template <typename Scalar, typename Storage>
+    void writeModelFile (
+        const std::string& path,
+        const Matrix<Scalar>& Zcentered,
+        const Matrix<Scalar>& K_minus1,
+        const Vector<Scalar>& X,
+        const RowVector<Scalar>& meanBRDF,
+        const unsigned int latentDim,
+        const std::vector<std::string>& brdfsFilenames,
+        const Scalar mu,
+        const Scalar l)
+    {
+        const std::uint64_t nbBRDFs(Zcentered.rows()), nbCoefficients(Zcentered.cols());
+        if (latentDim == 0 || std::uint64_t(K_minus1.rows()) != nbBRDFs || std::uint64_t(K_minus1.cols()) != nbBRDFs ||
+            std::uint64_t(X.rows()) != nbBRDFs * latentDim || std::uint64_t(meanBRDF.cols()) != nbCoefficients ||
+            brdfsFilenames.size() != nbBRDFs)
+        {
+            throw ModelFileError{"The parametrisation written in " + path + " is not consistent"};
+        }
+        std::string filenames;
+        for (const auto& filename : brdfsFilenames)
+        {
+            if (filename.find('\n') != std::string::npos)
+            {
+                throw ModelFileError{"The BRDF file name \"" + filename + "\" holds a line break"};
+            }
+            filenames += filename + '\n';
+        }
+
+        ModelHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, "BRDFMDL", 8);
+        header.version = modelFileVersion;
+        header.latentDim = latentDim;
+        header.nbBRDFs = nbBRDFs;
+        header.nbCoefficients = nbCoefficients;
+        header.scalarSize = sizeof(Scalar);
+        header.scalarDigits = std::numeric_limits<Scalar>::digits;
+        header.storageSize = sizeof(Storage);
+        header.storageDigits = std::numeric_limits<Storage>::digits;
+        header.hyperparametersOffset = alignModelSection(sizeof(ModelHeader));
+        header.latentOffset = alignModelSection(header.hyperparametersOffset + 2 * sizeof(Scalar));
+        header.inverseMappingOffset = alignModelSection(header.latentOffset + nbBRDFs * latentDim * sizeof(Scalar));
+        header.meanOffset = alignModelSection(header.inverseMappingOffset + nbBRDFs * nbBRDFs * sizeof(Scalar));
+        header.filenamesOffset = alignModelSection(header.meanOffset + nbCoefficients * sizeof(Scalar));
+        header.filenamesSize = filenames.size();
+        header.mappingOffset = alignModelSection(header.filenamesOffset + filenames.size());
+        header.fileSize = header.mappingOffset + nbBRDFs * nbCoefficients * sizeof(Storage);
+
+        const std::string partialPath(path + ".partial");
+        {
+            MappedFile file(partialPath, header.fileSize);
+            char* data(file.data());
+            std::memcpy(data, &header, sizeof(header));
+            const Scalar hyperparameters[2] = {mu, l};
+            std::memcpy(data + header.hyperparametersOffset, hyperparameters, sizeof(hyperparameters));
+            std::memcpy(data + header.latentOffset, X.data(), X.size() * sizeof(Scalar));
+            std::memcpy(data + header.inverseMappingOffset, K_minus1.data(), K_minus1.size() * sizeof(Scalar));
+            std::memcpy(data + header.meanOffset, meanBRDF.data(), meanBRDF.size() * sizeof(Scalar));
+            std::memcpy(data + header.filenamesOffset, filenames.data(), filenames.size());
+
+            // Only one block of nbBRDFs x mappingBlockSize scalars is held besides the file
+            const long mappingBlockSize(1 << 16);
+            Eigen::Map<Eigen::Matrix<Storage, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> mapping(
+                reinterpret_cast<Storage*>(data + header.mappingOffset), nbBRDFs, nbCoefficients);
+            Matrix<Scalar> block;
+            for (long first = 0; first < long(nbCoefficients); first += mappingBlockSize)
+            {
+                const long size(std::min(mappingBlockSize, long(nbCoefficients) - first));
+                block.noalias() = K_minus1 * Zcentered.middleCols(first, size);
+                mapping.middleCols(first, size) = block.template cast<Storage>();
+            }
+            file.flush();
+        }
+        if (std::rename(partialPath.c_str(), path.c_str()) != 0)
+        {
+            std::remove(partialPath.c_str());
+            throw ModelFileError{"The model file " + path + " could not have been written"};
+        }
+    }
+} // ChefDevr
@@ -7,7 +7,10 @@
  * that are common to the Optimisation module and BRDF Explorer module
  */ 
 
+#include <functional>
 #include <iostream>
+#include <string>
+#include <vector>
 #include "types.h"
 #include "mathwrap.h"
 
@@ -16,15 +19,38 @@
 
 namespace ChefDevr
 {
+    /**
+     * @brief Copies latent variables into a structure of arrays
+     * @tparam Dim Dimension of the latent space when known at compile time (must then be equal to dim)
+     * @param X Latent variables vector (coordinates of a latent variable are contiguous)
+     * @param dim Dimension of latent space
+     * @return The nb_data x dim matrix whose columns are the coordinates of the latent variables
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    LatentMatrix<Scalar, Dim> toStructureOfArrays (const Vector<Scalar>& X, unsigned int dim);
+    
     /**
      * @brief Class that allows BRDF reconstruction from latent space coordinates
      * @tparam Scalar The type of the values used to reconstruct a BRDF.
      * The precision of this type is crucial to reconstruct an accurate BRDF from the latent space.
+     * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
      */
-    template <typename Scalar>
+    template <typename Scalar, int Dim = Eigen::Dynamic>
     class BRDFReconstructor
     {
     public:
+        /**
+         * @brief Function receiving a block of reconstructed BRDFs :
+         * index of the first coefficient of the block, then the nbPoints x blockSize matrix of the block
+         * (one row per latent space point)
+         */
+        using BlockCallback = std::function<void (long, const Matrix<Scalar>&)>;
+
+        /**
+         * @brief Default number of coefficients of a block of reconstructed BRDFs
+         */
+        static constexpr long defaultBlockSize = 4096;
+
         /**
          * @brief Constructor of the class
          * @param _K_minus1 Inverse mapping matrix
@@ -46,8 +72,11 @@ namespace ChefDevr
                 latentDim(_latentDim),
                 nb_data(_K_minus1.rows()),
                 mu(_mu),
-                l(_l)
-        {}
+                l(_l),
+                Xsoa(toStructureOfArrays<Scalar, Dim>(_X, _latentDim))
+        {
+            eigen_assert(Dim == Eigen::Dynamic || _latentDim == static_cast<unsigned int>(Dim));
+        }
 
         virtual ~BRDFReconstructor() = default;
 
@@ -58,6 +87,62 @@ namespace ChefDevr
          * @return The BRDF data as a row vector
          */
         virtual void reconstruct (RowVector<Scalar>& brdf, const Vector<Scalar>& coord) const = 0;
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points
+         * @param brdfs The nbPoints x nbCoefficients matrix to fill (one BRDF per row)
+         * @param coords Coordinates of the latent space points (one point per column)
+         */
+        void reconstructBatch (Matrix<Scalar>& brdfs, const Matrix<Scalar>& coords) const;
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points block of coefficients by block of coefficients
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         *
+         * The default implementation reconstructs the points one by one into a nbPoints x nbCoefficients
+         * matrix, then delivers it by blocks.
+         * Reconstructors that hold a nb_data x nbCoefficients matrix (BRDFReconstructorWithZ, BRDFReconstructorLowRank,
+         * BRDFReconstructorSparse, BRDFReconstructorMapped, and BRDFReconstructorSmallStorage with a basis file)
+         * compute each block with a single matrix product, so that this matrix is read once for all the points
+         * instead of once per point. Only one block of nbPoints x blockSize scalars is then allocated at a time.
+         * The default implementation and BRDFReconstructorSmallStorage without a basis file allocate the whole
+         * nbPoints x nbCoefficients result : the callers bound it by the number of points per call.
+         */
+        virtual void reconstructBatchBlocks (
+            const Matrix<Scalar>& coords,
+            const BlockCallback& callback,
+            long blockSize = defaultBlockSize) const;
+
+        /**
+         * @brief Reconstructs some coefficients of the BRDF of a latent space point
+         * @param values The vector to fill, one value per index
+         * @param coord Coordinates of the latent space point
+         * @param indices Indices of the coefficients to reconstruct
+         *
+         * The default implementation reconstructs the whole BRDF.
+         * Reconstructors that hold a nb_data x nbCoefficients matrix only read the columns of the given indices.
+         */
+        virtual void reconstructCoefficients (
+            Vector<Scalar>& values,
+            const Vector<Scalar>& coord,
+            const std::vector<unsigned int>& indices) const;
+
+        /**
+         * @brief Evaluates the BRDF of a latent space point for several pairs of directions
+         * without reconstructing the whole BRDF
+         * @param colors The nbDirections x 3 matrix to fill with the red, green and blue values
+         * (scaled as in MERLReader::lookup_brdf_val)
+         * @param coord Coordinates of the latent space point
+         * @param directions The nbDirections x 4 matrix of the pairs of directions,
+         * one (theta_in, phi_in, theta_out, phi_out) per row
+         *
+         * Only the 3 coefficients of each pair are reconstructed (see reconstructCoefficients) :
+         * with a nb_data x nbCoefficients matrix, a pair costs O(nb_data) operations.
+         * Values below zero are clamped to zero, as the reconstructed BRDFs are before their albedo is computed.
+         */
+        void lookupBRDFValues (Matrix<double>& colors, const Vector<Scalar>& coord, const Matrix<double>& directions) const;
         
         /**
          * @brief Computes the error between a reference brdf and this brdf reconstructed from its latent coordinates
@@ -66,6 +151,17 @@ namespace ChefDevr
          */
         virtual Scalar reconstructionError (unsigned int brdfindex) const = 0;
 
+        /**
+         * @brief Computes the errors between all the reference brdfs and their reconstructions at once
+         * @param errors The nbBRDFs x 4 matrix to fill, one row per brdf in the order in which they were read :
+         * the mean square error of the whole brdf, then of its red, green and blue coefficients
+         *
+         * The channels are the three consecutive thirds of the coefficients (see MERLReader::channelStride).
+         * The reconstructions are computed by blocks of coefficients with matrix products and each reference
+         * brdf is read once, instead of one full reconstruction per call to reconstructionError.
+         */
+        virtual void reconstructionErrors (Matrix<Scalar>& errors) const = 0;
+
         /**
          * @return The dimension of the latent Space
          */
@@ -76,8 +172,78 @@ namespace ChefDevr
          */
         inline long getBRDFCoeffNb() const { return meanBRDF.cols(); }
 
+        /**
+         * @return The number of BRDFs of the parametrisation
+         */
+        inline long getNbBRDFs() const { return nb_data; }
+
     protected:
 
+        /**
+         * @brief Computes the covariance between the latent variables and several latent space points
+         * @param cov The nb_data x nbPoints matrix to fill (one covariance vector per column)
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param mu The constant that helps interpolating data while keeping good solution
+         */
+        void computeCovColumns (Matrix<Scalar>& cov, const Matrix<Scalar>& coords, Scalar mu) const;
+
+        /**
+         * @brief Reconstructs BRDFs from their covariance vectors block of coefficients by block of coefficients
+         * @param cov The covariance matrix (see computeCovColumns), one column per point
+         * @param mapping The matrix mapping the columns of cov to centered BRDFs (one row per row of cov)
+         * (converted to Scalar block by block when it is stored in another type, may be a map of a file)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         */
+        template <typename Mapping>
+        void multiplyByBlocks (
+            const Matrix<Scalar>& cov,
+            const Eigen::MatrixBase<Mapping>& mapping,
+            const BlockCallback& callback,
+            long blockSize) const;
+
+        /**
+         * @brief Number of coefficients of the blocks compared with the reference brdfs
+         * (large enough to open each brdf file only a few times)
+         */
+        static constexpr long errorBlockSize = 1 << 16;
+
+        /**
+         * @brief Computes the reconstruction errors of brdfs held in memory
+         * @param errors The nbBRDFs x 4 matrix to fill (see reconstructionErrors)
+         * @param coords Coordinates of the latent variables of the brdfs (one point per column)
+         * @param Zcentered Centered BRDFs data matrix (BRDFs stored in row major)
+         */
+        void centeredErrors (Matrix<Scalar>& errors, const Matrix<Scalar>& coords, const Matrix<Scalar>& Zcentered) const;
+
+        /**
+         * @brief Adds the squared errors of a block of coefficients to the sums of each channel
+         * @param sums The nbBRDFs x 3 sums of the squared errors of the red, green and blue coefficients
+         * @param first Index of the first coefficient of the block
+         * @param residual The nbBRDFs x blockSize differences between the reconstructions and the references
+         */
+        void addSquaredErrors (Matrix<Scalar>& sums, long first, const Matrix<Scalar>& residual) const;
+
+        /**
+         * @brief Divides the sums of the squared errors by the number of coefficients
+         * @param errors The nbBRDFs x 4 matrix to fill (see reconstructionErrors)
+         * @param sums The sums of the squared errors of each channel (see addSquaredErrors)
+         */
+        void meanSquareErrors (Matrix<Scalar>& errors, const Matrix<Scalar>& sums) const;
+
+        /**
+         * @brief Reads the same block of coefficients from several brdf files, in parallel
+         * @param Z The nbFiles x size matrix to fill (one brdf per row)
+         * @param filePaths The brdf files
+         * @param first Index of the first coefficient of the block
+         * @param size Number of coefficients of the block
+         */
+        static void readCoefficientBlocks (
+            Matrix<Scalar>& Z,
+            const std::vector<std::string>& filePaths,
+            long first,
+            long size);
+
         /** 
          * @brief Latent variables vector
          */
@@ -110,21 +276,27 @@ namespace ChefDevr
          */
         const Scalar l;
         
+        /**
+         * @brief Latent variables stored as a structure of arrays
+         */
+        const LatentMatrix<Scalar, Dim> Xsoa;
+        
     };
     
     /**
      * @brief Covariance function given in the research paper :
      * A Versatile Parametrization for Measured Materials Manifold
+     * @tparam Dim Dimension of the latent space, fixed size vectors let the compiler unroll the norm
      * @param x1 First latent variable
      * @param x2 Second latent variable
      * @param mu The constant that helps interpolating data while keeping good solution
      * @param l Constant defined in the research paper
      * @return Covariance value
      */
-    template <typename Scalar>
+    template <typename Scalar, int Dim = Eigen::Dynamic>
     inline Scalar covariance (
-        const Vector<Scalar>& x1,
-        const Vector<Scalar>& x2,
+        const LatentVector<Scalar, Dim>& x1,
+        const LatentVector<Scalar, Dim>& x2,
         const Scalar mu = MU_DEFAULT,
         const Scalar l  = L_DEFAULT)
     {
@@ -145,22 +317,71 @@ namespace ChefDevr
     
     /**
      * @brief Computes the covariance column vector for the coordRef coordinates variable
+     * @tparam Dim Dimension of the latent space when known at compile time (must then be equal to dim)
      * @param cov_vector The covariance column vector to fill
      * @param X_reshaped Latent variables matrix in the form such that each column is a latent variable with a number of rows equal to dim.
      * @param coordRef Coordinates to compare with every latent variable 
      * @param dim Dimension of latent space
      * @param nb_data Number of data 
+     * @param mu The constant that helps interpolating data while keeping good solution
+     * @param l Constant defined in the research paper
      * @return Covariance column vector
      * 
-     * Covariance is computed with the "covariance" function
+     * Copies X into a structure of arrays : callers that compute several covariance vectors
+     * should copy X once and call computeCovVectorSoA
      */
-    template <typename Scalar>
+    template <typename Scalar, int Dim = Eigen::Dynamic>
     void computeCovVector (
         Scalar* cov_vector,
         const Vector<Scalar>& X,
         const Vector<Scalar>& coordRef,
         unsigned int dim,
-        unsigned int nb_data);
+        unsigned int nb_data,
+        Scalar mu = MU_DEFAULT,
+        Scalar l = L_DEFAULT);
+    
+    /**
+     * @brief Computes the covariance between coordRef and the latent variables from index begin
+     * @tparam Dim Dimension of the latent space when known at compile time
+     * @param cov_vector The covariance column vector to fill (from index begin to the number of latent variables)
+     * @param Xsoa Latent variables stored as a structure of arrays (see toStructureOfArrays)
+     * @param coordRef Coordinates to compare with every latent variable
+     * @param mu The constant that helps interpolating data while keeping good solution
+     * @param l Constant defined in the research paper
+     * @param begin Index of the first latent variable
+     *
+     * The latent variables are processed by blocks : the squared distances of a block are accumulated
+     * coordinate by coordinate over contiguous arrays, then the exponential is applied to the whole block
+     * (vectorised by Eigen for float and double) and the mu term is added without branching.
+     * Blocks are distributed among threads only when there are enough latent variables.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    void computeCovVectorSoA (
+        Scalar* cov_vector,
+        const LatentMatrix<Scalar, Dim>& Xsoa,
+        const Vector<Scalar>& coordRef,
+        Scalar mu = MU_DEFAULT,
+        Scalar l = L_DEFAULT,
+        long begin = 0);
+    
+    /**
+     * @brief Computes the covariance matrix of latent variables
+     * @tparam Dim Dimension of the latent space when known at compile time (must then be equal to dim)
+     * @param K The nb_data x nb_data covariance matrix to fill
+     * @param X Latent variables vector
+     * @param dim Dimension of latent space
+     * @param mu The constant that helps interpolating data while keeping good solution
+     * @param l Constant defined in the research paper
+     *
+     * Only the lower triangle is computed, then copied to the upper triangle
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    void computeCovMatrix (
+        Matrix<Scalar>& K,
+        const Vector<Scalar>& X,
+        unsigned int dim,
+        Scalar mu = MU_DEFAULT,
+        Scalar l = L_DEFAULT);
         
 } // ChefDevr
 
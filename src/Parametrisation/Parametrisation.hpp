@@ -4,6 +4,13 @@
 /**
  * @file Parametrisation.hpp
  */
+
+#include "MERLReader.h"
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+
 namespace ChefDevr
 {
     
@@ -14,19 +21,293 @@ void centerMat(Matrix<Scalar>& Z, RowVector<Scalar>& meanBRDF)
     Z.rowwise() -= meanBRDF;
 }
 
-template <typename Scalar>
+template <typename Scalar, int Dim>
+LatentMatrix<Scalar, Dim> toStructureOfArrays (const Vector<Scalar>& X, const unsigned int dim)
+{
+    eigen_assert(Dim == Eigen::Dynamic || dim == static_cast<unsigned int>(Dim));
+    return Eigen::Map<const Eigen::Matrix<Scalar, Dim, Eigen::Dynamic>>(X.data(), dim, X.rows()/dim).transpose();
+}
+
+template <typename Scalar, int Dim>
 void computeCovVector (
     Scalar* cov_vector,
     const Vector<Scalar>& X,
     const Vector<Scalar>& coordRef,
     const unsigned int dim,
-    const unsigned int nb_data)
+    const unsigned int nb_data,
+    const Scalar mu,
+    const Scalar l)
+{
+    const Vector<Scalar> latentVariables(X.head(nb_data*dim));
+    computeCovVectorSoA<Scalar, Dim>(cov_vector, toStructureOfArrays<Scalar, Dim>(latentVariables, dim), coordRef, mu, l);
+}
+
+template <typename Scalar, int Dim>
+void computeCovVectorSoA (
+    Scalar* cov_vector,
+    const LatentMatrix<Scalar, Dim>& Xsoa,
+    const Vector<Scalar>& coordRef,
+    const Scalar mu,
+    const Scalar l,
+    const long begin)
+{
+    // Number of latent variables per block : the squared distances of a block stay on the stack
+    constexpr long blockSize = 256;
+    // Number of latent variables below which threads cost more than they save
+    constexpr long parallelThreshold = 4096;
+    using BlockArray = Eigen::Array<Scalar, Eigen::Dynamic, 1, Eigen::ColMajor, blockSize, 1>;
+    
+    const long nb_data(Xsoa.rows());
+    const long nbBlocks((nb_data - begin + blockSize - 1) / blockSize);
+    const Scalar scale(Scalar(-1) / (Scalar(2)*l*l));
+    const Scalar epsilon(std::numeric_limits<Scalar>::epsilon());
+    const LatentVector<Scalar, Dim> ref(coordRef);
+    
+    # pragma omp parallel for if(nb_data - begin >= parallelThreshold)
+    for (long block = 0; block < nbBlocks; ++block)
+    {
+        const long start(begin + block*blockSize);
+        const long size(std::min(blockSize, nb_data - start));
+        
+        BlockArray sqnorm((Xsoa.col(0).segment(start, size).array() - ref[0]).square());
+        for (long c = 1; c < Xsoa.cols(); ++c)
+        {
+            sqnorm += (Xsoa.col(c).segment(start, size).array() - ref[c]).square();
+        }
+        
+        Eigen::Map<Eigen::Array<Scalar, Eigen::Dynamic, 1>> cov(cov_vector + start, size);
+        cov = (scale * sqnorm).exp();
+        // dirac(x1-x2) == 0 <=> norm(x1-x2) == 0
+        cov = (sqnorm < epsilon).select(cov + mu, cov);
+    }
+}
+
+template <typename Scalar, int Dim>
+constexpr long BRDFReconstructor<Scalar, Dim>::defaultBlockSize;
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::reconstructBatch (Matrix<Scalar>& brdfs, const Matrix<Scalar>& coords) const
+{
+    brdfs.resize(coords.cols(), meanBRDF.cols());
+    reconstructBatchBlocks(coords, [&brdfs](const long first, const Matrix<Scalar>& block)
+    {
+        brdfs.middleCols(first, block.cols()) = block;
+    });
+}
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::reconstructBatchBlocks (
+    const Matrix<Scalar>& coords,
+    const BlockCallback& callback,
+    const long blockSize) const
+{
+    const long nbCoefficients(meanBRDF.cols());
+    Matrix<Scalar> brdfs(coords.cols(), nbCoefficients);
+    RowVector<Scalar> brdf(nbCoefficients);
+    for (long p = 0; p < coords.cols(); ++p)
+    {
+        reconstruct(brdf, coords.col(p));
+        brdfs.row(p) = brdf;
+    }
+    for (long first = 0; first < nbCoefficients; first += blockSize)
+    {
+        callback(first, brdfs.middleCols(first, std::min(blockSize, nbCoefficients - first)));
+    }
+}
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::reconstructCoefficients (
+    Vector<Scalar>& values,
+    const Vector<Scalar>& coord,
+    const std::vector<unsigned int>& indices) const
+{
+    RowVector<Scalar> brdf(meanBRDF.cols());
+    reconstruct(brdf, coord);
+    values.resize(indices.size());
+    for (unsigned int k = 0; k < indices.size(); ++k)
+    {
+        values[k] = brdf[indices[k]];
+    }
+}
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::lookupBRDFValues (
+    Matrix<double>& colors,
+    const Vector<Scalar>& coord,
+    const Matrix<double>& directions) const
+{
+    eigen_assert(directions.cols() == 4);
+    const long nbDirections(directions.rows());
+    const unsigned int stride(MERLReader::channelStride);
+    const double scales[3] = {MERLReader::red_scale, MERLReader::green_scale, MERLReader::blue_scale};
+    
+    // Red, green and blue coefficients of each pair of directions
+    std::vector<unsigned int> indices(3*nbDirections);
+    for (long d = 0; d < nbDirections; ++d)
+    {
+        const unsigned int index(MERLReader::lookup_index(directions(d, 0), directions(d, 1), directions(d, 2), directions(d, 3)));
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            indices[3*d + c] = index + c*stride;
+        }
+    }
+    
+    Vector<Scalar> values;
+    reconstructCoefficients(values, coord, indices);
+    colors.resize(nbDirections, 3);
+    for (long d = 0; d < nbDirections; ++d)
+    {
+        for (unsigned int c = 0; c < 3; ++c)
+        {
+            colors(d, c) = std::max(double(values[3*d + c]) * scales[c], 0.);
+        }
+    }
+}
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::computeCovColumns (
+    Matrix<Scalar>& cov,
+    const Matrix<Scalar>& coords,
+    const Scalar mu) const
+{
+    cov.resize(nb_data, coords.cols());
+    // Each covariance vector only uses threads for large latent variable sets : spread the points instead
+    # pragma omp parallel for if(coords.cols() > 1)
+    for (long p = 0; p < coords.cols(); ++p)
+    {
+        computeCovVectorSoA<Scalar, Dim>(cov.col(p).data(), Xsoa, coords.col(p), mu, l);
+    }
+}
+
+template <typename Scalar, int Dim>
+template <typename Mapping>
+void BRDFReconstructor<Scalar, Dim>::multiplyByBlocks (
+    const Matrix<Scalar>& cov,
+    const Eigen::MatrixBase<Mapping>& mapping,
+    const BlockCallback& callback,
+    const long blockSize) const
+{
+    const long nbCoefficients(mapping.cols());
+    Matrix<Scalar> block;
+    for (long first = 0; first < nbCoefficients; first += blockSize)
+    {
+        const long size(std::min(blockSize, nbCoefficients - first));
+        // One matrix product per block : the block of the mapping is read once for all the points
+        block.noalias() = cov.transpose() * mapping.middleCols(first, size).template cast<Scalar>();
+        block.rowwise() += meanBRDF.segment(first, size);
+        callback(first, block);
+    }
+}
+
+template <typename Scalar, int Dim>
+constexpr long BRDFReconstructor<Scalar, Dim>::errorBlockSize;
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::centeredErrors (
+    Matrix<Scalar>& errors,
+    const Matrix<Scalar>& coords,
+    const Matrix<Scalar>& Zcentered) const
+{
+    Matrix<Scalar> sums(Matrix<Scalar>::Zero(coords.cols(), 3));
+    Matrix<Scalar> residual;
+    reconstructBatchBlocks(coords, [&](const long first, const Matrix<Scalar>& block)
+    {
+        residual = block - Zcentered.middleCols(first, block.cols());
+        residual.rowwise() -= meanBRDF.segment(first, block.cols());
+        addSquaredErrors(sums, first, residual);
+    }, errorBlockSize);
+    meanSquareErrors(errors, sums);
+}
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::addSquaredErrors (
+    Matrix<Scalar>& sums,
+    const long first,
+    const Matrix<Scalar>& residual) const
 {
-    # pragma omp parallel for 
-    for (unsigned int i = 0; i < nb_data; ++i){
-        cov_vector[i] = covariance<Scalar>(coordRef, X.segment(i*dim,dim));
+    const long nbCoefficients(meanBRDF.cols());
+    const long last(first + residual.cols());
+    for (long c = 0; c < 3; ++c)
+    {
+        // A block may overlap two channels
+        const long begin(std::max(first, c*nbCoefficients/3));
+        const long end(std::min(last, (c+1)*nbCoefficients/3));
+        if (begin < end)
+        {
+            sums.col(c) += residual.middleCols(begin - first, end - begin).rowwise().squaredNorm();
+        }
     }
 }
 
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::meanSquareErrors (Matrix<Scalar>& errors, const Matrix<Scalar>& sums) const
+{
+    const long nbCoefficients(meanBRDF.cols());
+    errors.resize(sums.rows(), 4);
+    errors.col(0) = sums.rowwise().sum() / Scalar(nbCoefficients);
+    for (long c = 0; c < 3; ++c)
+    {
+        const long size((c+1)*nbCoefficients/3 - c*nbCoefficients/3);
+        errors.col(c+1) = size > 0 ? Vector<Scalar>(sums.col(c) / Scalar(size)) : Vector<Scalar>::Zero(sums.rows());
+    }
+}
+
+template <typename Scalar, int Dim>
+void BRDFReconstructor<Scalar, Dim>::readCoefficientBlocks (
+    Matrix<Scalar>& Z,
+    const std::vector<std::string>& filePaths,
+    const long first,
+    const long size)
+{
+    const long nbFiles(filePaths.size());
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> coefficients(nbFiles, size);
+    // Exceptions cannot leave a parallel region : the first one is thrown after it
+    std::exception_ptr readError;
+    # pragma omp parallel for schedule(dynamic)
+    for (long i = 0; i < nbFiles; ++i)
+    {
+        try
+        {
+            MERLReader::read_brdf_coefficients(filePaths[i].c_str(), first, size, coefficients.row(i).data());
+        }
+        catch (...)
+        {
+            # pragma omp critical
+            if (!readError)
+            {
+                readError = std::current_exception();
+            }
+        }
+    }
+    if (readError)
+    {
+        std::rethrow_exception(readError);
+    }
+    Z = coefficients.template cast<Scalar>();
+}
+
+template <typename Scalar, int Dim>
+void computeCovMatrix (
+    Matrix<Scalar>& K,
+    const Vector<Scalar>& X,
+    const unsigned int dim,
+    const Scalar mu,
+    const Scalar l)
+{
+    // Number of latent variables below which the matrix is computed by a single thread
+    constexpr long parallelThreshold = 128;
+    
+    const LatentMatrix<Scalar, Dim> Xsoa(toStructureOfArrays<Scalar, Dim>(X, dim));
+    const long nb_data(Xsoa.rows());
+    K.resize(nb_data, nb_data);
+    
+    // Columns get shorter : small chunks balance the lower triangle between threads
+    # pragma omp parallel for schedule(dynamic, 16) if(nb_data >= parallelThreshold)
+    for (long i = 0; i < nb_data; ++i)
+    {
+        computeCovVectorSoA<Scalar, Dim>(K.col(i).data(), Xsoa, Xsoa.row(i).transpose(), mu, l, i);
+    }
+    K.template triangularView<Eigen::StrictlyUpper>() = K.transpose();
+}
 
 } // namespace ChevDevr
@@ -0,0 +1,148 @@
+#ifndef PARAMETRISATION_LOW_RANK__H
+#define PARAMETRISATION_LOW_RANK__H
+
+#include "Parametrisation.h"
+
+
+/**
+ * @file ParametrisationLowRank.h
+ * @brief Does the BRDF space parametrisation from a truncated factorisation of K_minus1 * Zcentered
+ */
+namespace ChefDevr {
+
+    /**
+     * @brief Reconstructs BRDFs from a rank r factorisation A * B of K_minus1 * Zcentered
+     *
+     * A (nb_data x r) holds the leading left singular vectors of K_minus1 * Zcentered
+     * and B = transpose(A) * K_minus1 * Zcentered (r x D). The reconstruction is (kt * A) * B + meanBRDF :
+     * B is r rows instead of nb_data and is the only matrix read per reconstructed coefficient.
+     *
+     * The singular vectors are the eigen vectors of the nb_data x nb_data matrix
+     * K_minus1 * ZZt * K_minus1, so the D columns of Zcentered are read once, to compute B.
+     * Singular values below sqrt(epsilon) times the largest one are not resolved by this matrix.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class BRDFReconstructorLowRank : public BRDFReconstructor<Scalar, Dim>
+    {
+    public:
+        /**
+         * @brief Constructor of the class
+         * @param _Zcentered Centered BRDFs data matrix (BRDFs stored in row major),
+         * @param _ZZt Zcentered * (Zcentered transposed)
+         * @param _K_minus1 Inverse mapping matrix
+         * @param _X Latent variables vector
+         * @param _meanBRDF The mean BRDF (mean of the rows of Z before it was centered)
+         * @param _latentDim Dimension of the latent space
+         * @param tolerance Relative error (Frobenius norm) of the factorisation of K_minus1 * Zcentered
+         * from which the rank is chosen : the smallest rank whose error is below it is kept
+         * @param _mu Value of the mu constant that helps interpolation source data
+         * @param _l Constant defined in the research paper
+         */
+        BRDFReconstructorLowRank (
+                const Matrix<Scalar>& _Zcentered,
+                const Matrix<Scalar>& _ZZt,
+                const Matrix<Scalar>& _K_minus1,
+                const Vector<Scalar>& _X,
+                const RowVector<Scalar>& _meanBRDF,
+                unsigned int _latentDim,
+                Scalar tolerance,
+                Scalar _mu = MU_DEFAULT,
+                Scalar _l = L_DEFAULT);
+
+        ~BRDFReconstructorLowRank() = default;
+
+        /**
+         * @brief Reconstructs a BRDF from its latent space coordinates
+         * @param brdf The brdf data vector to fill
+         * @param coord Coordinates of the latent space point to recontruct as a BRDF
+         * @return The BRDF data as a row vector
+         */
+        void reconstruct (RowVector<Scalar>& brdf, const Vector<Scalar>& coord) const override;
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points block of coefficients by block of coefficients
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         *
+         * The covariance vectors are projected on A once, then each block is one matrix product with a block of B.
+         */
+        void reconstructBatchBlocks (
+            const Matrix<Scalar>& coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback& callback,
+            long blockSize = BRDFReconstructor<Scalar, Dim>::defaultBlockSize) const override;
+
+        /**
+         * @brief Computes the error between a reference brdf and this brdf reconstructed from its latent coordinates
+         * @param brdfindex : The index of the brdf in the list of brdfs read to construct Z
+         * @return the mean square error between a reference brdf and its reconstruction
+         */
+        Scalar reconstructionError (unsigned int brdfindex) const override;
+
+        /**
+         * @brief Computes the errors between all the reference brdfs and their reconstructions at once
+         * @param errors The nb_data x 4 matrix to fill (see BRDFReconstructor::reconstructionErrors)
+         *
+         * Each block of coefficients is one matrix product between the projected covariances of the latent variables and B.
+         */
+        void reconstructionErrors (Matrix<Scalar>& errors) const override;
+
+        /**
+         * @brief Reconstructs some coefficients of the BRDF of a latent space point
+         * @param values The vector to fill, one value per index
+         * @param coord Coordinates of the latent space point
+         * @param indices Indices of the coefficients to reconstruct
+         *
+         * Only the columns of B of the given indices are read
+         */
+        void reconstructCoefficients (
+            Vector<Scalar>& values,
+            const Vector<Scalar>& coord,
+            const std::vector<unsigned int>& indices) const override;
+
+        /**
+         * @return The rank of the factorisation
+         */
+        inline long getRank() const { return A.cols(); }
+
+        /**
+         * @return The relative error (Frobenius norm) of the factorisation of K_minus1 * Zcentered
+         */
+        inline Scalar getRelativeError() const { return relativeError; }
+
+    private:
+
+        /**
+         * @brief Centered BRDFs data matrix (BRDFs stored in row major)
+         */
+        const Matrix<Scalar>& Zcentered;
+
+        /**
+         * @brief Leading left singular vectors of K_minus1 * Zcentered (nb_data x r)
+         */
+        Matrix<Scalar> A;
+
+        /**
+         * @brief Projection of K_minus1 * Zcentered on A (r x D)
+         */
+        Matrix<Scalar> B;
+
+        /**
+         * @brief Relative error of the factorisation
+         */
+        Scalar relativeError;
+
+        /**
+         * @brief Reconstructs a BRDF for latent space coordinates without adding the mean
+         * @param brdf The brdf data vector to fill
+         * @param coord Coordinates of the latent space point to recontruct as a BRDF
+         */
+        void reconstructWithoutMean (RowVector<Scalar>& brdf, const Vector<Scalar>& coord) const;
+
+    };
+
+} // ChefDevr
+
+#include "ParametrisationLowRank.hpp"
+
+#endif // PARAMETRISATION_LOW_RANK__H
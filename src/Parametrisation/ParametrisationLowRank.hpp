@@ -0,0 +1,110 @@
+#include <Eigen/Eigenvalues>
+
+
+namespace ChefDevr {
+
+    template<typename Scalar, int Dim>
+    BRDFReconstructorLowRank<Scalar, Dim>::BRDFReconstructorLowRank(
+            const Matrix<Scalar>& _Zcentered,
+            const Matrix<Scalar>& _ZZt,
+            const Matrix<Scalar>& _K_minus1,
+            const Vector<Scalar>& _X,
+            const RowVector<Scalar>& _meanBRDF,
+            const unsigned int _latentDim,
+            const Scalar tolerance,
+            const Scalar _mu,
+            const Scalar _l):
+
+            BRDFReconstructor<Scalar, Dim>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
+            Zcentered(_Zcentered),
+            relativeError(0)
+    {
+        using std::sqrt;
+        const long nb_data(_K_minus1.rows());
+
+        // K_minus1 * Zcentered * transpose(K_minus1 * Zcentered), eigen values in increasing order
+        const Matrix<Scalar> gram(_K_minus1 * _ZZt * _K_minus1);
+        const Eigen::SelfAdjointEigenSolver<Matrix<Scalar>> solver(gram);
+        const Vector<Scalar> energies(solver.eigenvalues().cwiseMax(Scalar(0)));
+        const Scalar total(energies.sum());
+
+        // Smallest rank whose discarded energy is below the tolerance
+        long rank(nb_data);
+        Scalar discarded(0);
+        while (rank > 1 && discarded + energies[nb_data - rank] <= tolerance * tolerance * total) {
+            discarded += energies[nb_data - rank];
+            --rank;
+        }
+        relativeError = total > Scalar(0) ? Scalar(sqrt(discarded / total)) : Scalar(0);
+
+        A = solver.eigenvectors().rightCols(rank).rowwise().reverse();
+        const Matrix<Scalar> AtKm1(A.transpose() * _K_minus1);
+        B.noalias() = AtKm1 * _Zcentered;
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorLowRank<Scalar, Dim>::reconstruct(RowVector<Scalar> &brdf,
+                                                           const Vector <Scalar> &coord) const {
+        reconstructWithoutMean(brdf, coord);
+        brdf += BRDFReconstructor<Scalar, Dim>::meanBRDF;
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorLowRank<Scalar, Dim>::reconstructWithoutMean(RowVector<Scalar> &brdf,
+                                                                      const Vector <Scalar> &coord) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        const RowVector<Scalar> weights(cov_vector * A);
+        brdf.noalias() = weights * B;
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorLowRank<Scalar, Dim>::reconstructBatchBlocks(
+            const Matrix<Scalar> &coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback &callback,
+            const long blockSize) const {
+        Matrix<Scalar> cov;
+        BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, coords, BRDFReconstructor<Scalar, Dim>::mu);
+        const Matrix<Scalar> weights(A.transpose() * cov);
+        BRDFReconstructor<Scalar, Dim>::multiplyByBlocks(weights, B, callback, blockSize);
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorLowRank<Scalar, Dim>::reconstructCoefficients(
+            Vector<Scalar> &values,
+            const Vector<Scalar> &coord,
+            const std::vector<unsigned int> &indices) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        const RowVector<Scalar> weights(cov_vector * A);
+        values.resize(indices.size());
+        for (unsigned int k = 0; k < indices.size(); ++k) {
+            values[k] = weights.dot(B.col(indices[k])) + BRDFReconstructor<Scalar, Dim>::meanBRDF[indices[k]];
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    Scalar BRDFReconstructorLowRank<Scalar, Dim>::reconstructionError(unsigned int brdfindex) const {
+        if (brdfindex >= BRDFReconstructor<Scalar, Dim>::nb_data) {
+            std::cerr << "Given index for BRDF reconstruction is out of bounds !" << std::endl;
+            return Scalar(-1);
+        }
+
+        const unsigned int latentDim(BRDFReconstructor<Scalar, Dim>::latentDim);
+        RowVector<Scalar> reconstructed(Zcentered.cols());
+        const Vector <Scalar> coord(BRDFReconstructor<Scalar, Dim>::X.segment(brdfindex * latentDim, latentDim));
+
+        reconstructWithoutMean(reconstructed, coord);
+        const RowVector<Scalar> diff(reconstructed - Zcentered.row(brdfindex));
+
+        return diff.dot(diff) / Zcentered.cols();
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorLowRank<Scalar, Dim>::reconstructionErrors(Matrix<Scalar> &errors) const {
+        BRDFReconstructor<Scalar, Dim>::centeredErrors(errors, BRDFReconstructor<Scalar, Dim>::Xsoa.transpose(), Zcentered);
+    }
+
+}
@@ -0,0 +1,186 @@
+#ifndef PARAMETRISATION_MAPPED__H
+#define PARAMETRISATION_MAPPED__H
+
+#include "Parametrisation.h"
+#include "ModelFile.h"
+#include "MappedFile.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/**
+ * @file ParametrisationMapped.h
+ * @brief Reconstructs BRDFs from a model file mapped in memory
+ */
+namespace ChefDevr {
+
+    /**
+     * @brief Data of a model file owned by its reconstructor
+     * @tparam Storage The type of the stored reconstruction matrix
+     *
+     * BRDFReconstructor only refers to the latent variables and the mean BRDF :
+     * this base is constructed first so that they outlive the reconstructor.
+     */
+    template <typename Scalar, typename Storage>
+    class MappedModel
+    {
+    protected:
+        /**
+         * @brief Maps a model file and copies its small sections
+         * @param path Path of the model file
+         * @param dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+         *
+         * Throws a ModelFileError if the file is not a model of these types and dimension
+         */
+        MappedModel (const std::string& path, int dim);
+
+        /**
+         * @brief The mapped file
+         */
+        std::unique_ptr<MappedFile> file;
+
+        /**
+         * @brief Header of the file
+         */
+        ModelHeader header;
+
+        /**
+         * @brief Latent variables vector
+         */
+        Vector<Scalar> modelX;
+
+        /**
+         * @brief Inverse mapping matrix
+         */
+        Matrix<Scalar> modelK_minus1;
+
+        /**
+         * @brief The mean BRDF
+         */
+        RowVector<Scalar> modelMeanBRDF;
+
+        /**
+         * @brief Constants of the covariance function
+         */
+        Scalar modelMu, modelL;
+
+        /**
+         * @brief Names of the BRDF files, in the order of the latent variables
+         */
+        std::vector<std::string> modelBRDFFilenames;
+    };
+
+    /**
+     * @brief Reconstructs BRDFs from a model file written by writeModelFile
+     * @tparam Storage The type of the reconstruction matrix stored in the file
+     *
+     * The reconstruction matrix is mapped read-only and never copied : the reconstructor is ready once
+     * the latent variables, the inverse mapping and the mean BRDF are read, and the pages of the matrix
+     * are shared by all the processes mapping the same file. It does not depend on any object of the
+     * process that trained the parametrisation.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic, typename Storage = Scalar>
+    class BRDFReconstructorMapped : private MappedModel<Scalar, Storage>, public BRDFReconstructor<Scalar, Dim>
+    {
+    public:
+        /**
+         * @brief Constructor of the class
+         * @param path Path of the model file
+         * @param brdfsDir Folder of the BRDF files of the model, only needed by the reconstruction errors
+         *
+         * Throws a ModelFileError if the file is not a model of these types and dimension
+         */
+        explicit BRDFReconstructorMapped (const std::string& path, const std::string& brdfsDir = "");
+
+        ~BRDFReconstructorMapped() = default;
+
+        /**
+         * @brief Reconstructs a BRDF from its latent space coordinates
+         * @param brdf The brdf data vector to fill
+         * @param coord Coordinates of the latent space point to recontruct as a BRDF
+         */
+        void reconstruct (RowVector<Scalar>& brdf, const Vector<Scalar>& coord) const override;
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points block of coefficients by block of coefficients
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         *
+         * Each block is one matrix product between the covariance vectors and a block of the mapped matrix.
+         */
+        void reconstructBatchBlocks (
+            const Matrix<Scalar>& coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback& callback,
+            long blockSize = BRDFReconstructor<Scalar, Dim>::defaultBlockSize) const override;
+
+        /**
+         * @brief Reconstructs some coefficients of the BRDF of a latent space point
+         * @param values The vector to fill, one value per index
+         * @param coord Coordinates of the latent space point
+         * @param indices Indices of the coefficients to reconstruct
+         *
+         * Only the columns of the mapped matrix of the given indices are read
+         */
+        void reconstructCoefficients (
+            Vector<Scalar>& values,
+            const Vector<Scalar>& coord,
+            const std::vector<unsigned int>& indices) const override;
+
+        /**
+         * @brief Computes the error between a reference brdf and this brdf reconstructed from its latent coordinates
+         * @param brdfindex : The index of the brdf in the list of brdfs of the model
+         * @return the mean square error between a reference brdf and its reconstruction
+         *
+         * The reference is read from the folder of the BRDF files : throws a ModelFileError without it
+         */
+        Scalar reconstructionError (unsigned int brdfindex) const override;
+
+        /**
+         * @brief Computes the errors between all the reference brdfs and their reconstructions at once
+         * @param errors The nb_data x 4 matrix to fill (see BRDFReconstructor::reconstructionErrors)
+         *
+         * The brdf files are read once, block of coefficients by block of coefficients :
+         * throws a ModelFileError without the folder of the BRDF files
+         */
+        void reconstructionErrors (Matrix<Scalar>& errors) const override;
+
+        /**
+         * @return The names of the BRDF files, in the order of the latent variables
+         */
+        inline const std::vector<std::string>& getBRDFFilenames() const { return MappedModel<Scalar, Storage>::modelBRDFFilenames; }
+
+        /**
+         * @return The latent variables vector
+         */
+        inline const Vector<Scalar>& getLatentVariables() const { return MappedModel<Scalar, Storage>::modelX; }
+
+    private:
+        /**
+         * @brief Row major map of the nb_data x nbCoefficients reconstruction matrix
+         */
+        using MappingMap = Eigen::Map<const Eigen::Matrix<Storage, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+
+        /**
+         * @return The map of the reconstruction matrix in the file
+         */
+        MappingMap mappingMatrix () const;
+
+        /**
+         * @brief Checks that the BRDF files are known
+         */
+        void checkBRDFFiles () const;
+
+        /**
+         * @brief Paths of the BRDF files (empty without their folder)
+         */
+        std::vector<std::string> brdf_filePaths;
+    };
+
+} // ChefDevr
+
+#include "ParametrisationMapped.hpp"
+
+#endif // PARAMETRISATION_MAPPED__H
@@ -0,0 +1,167 @@
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include "MERLReader.h"
+
+
+namespace ChefDevr {
+
+    template<typename Scalar, typename Storage>
+    MappedModel<Scalar, Storage>::MappedModel(const std::string &path, const int dim) {
+        try {
+            file.reset(new MappedFile(path));
+        } catch (const MappedFile::MappedFileError &error) {
+            throw ModelFileError{error.what()};
+        }
+        if (file->size() < sizeof(ModelHeader)) {
+            throw ModelFileError{"The model file " + path + " is too short"};
+        }
+        // The header is checked against the mapped size, not the one of an earlier read
+        std::memcpy(&header, file->data(), sizeof(ModelHeader));
+        checkModelHeader(header, file->size());
+        if (header.scalarSize != sizeof(Scalar) || header.scalarDigits != unsigned(std::numeric_limits<Scalar>::digits) ||
+            header.storageSize != sizeof(Storage) || header.storageDigits != unsigned(std::numeric_limits<Storage>::digits)) {
+            throw ModelFileError{"The model file " + path + " does not store the expected scalar types"};
+        }
+        if (dim != Eigen::Dynamic && header.latentDim != unsigned(dim)) {
+            throw ModelFileError{"The latent space of the model file " + path + " has the dimension " +
+                                 std::to_string(header.latentDim)};
+        }
+
+        const char *data(file->data());
+        const long nbBRDFs(header.nbBRDFs), nbCoefficients(header.nbCoefficients);
+        Scalar hyperparameters[2];
+        std::memcpy(hyperparameters, data + header.hyperparametersOffset, sizeof(hyperparameters));
+        modelMu = hyperparameters[0];
+        modelL = hyperparameters[1];
+        modelX = Eigen::Map<const Vector<Scalar>>(reinterpret_cast<const Scalar *>(data + header.latentOffset),
+                                                  nbBRDFs * header.latentDim);
+        modelK_minus1 = Eigen::Map<const Matrix<Scalar>>(reinterpret_cast<const Scalar *>(data + header.inverseMappingOffset),
+                                                         nbBRDFs, nbBRDFs);
+        modelMeanBRDF = Eigen::Map<const RowVector<Scalar>>(reinterpret_cast<const Scalar *>(data + header.meanOffset),
+                                                            nbCoefficients);
+
+        const std::string filenames(data + header.filenamesOffset, header.filenamesSize);
+        std::size_t begin(0), end;
+        while ((end = filenames.find('\n', begin)) != std::string::npos) {
+            modelBRDFFilenames.push_back(filenames.substr(begin, end - begin));
+            begin = end + 1;
+        }
+        if (modelBRDFFilenames.size() != header.nbBRDFs) {
+            throw ModelFileError{"The model file " + path + " does not list one BRDF file per latent variable"};
+        }
+        file->adviseSequential();
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    BRDFReconstructorMapped<Scalar, Dim, Storage>::BRDFReconstructorMapped(const std::string &path,
+                                                                           const std::string &brdfsDir) :
+            MappedModel<Scalar, Storage>(path, Dim),
+            BRDFReconstructor<Scalar, Dim>(MappedModel<Scalar, Storage>::modelK_minus1,
+                                           MappedModel<Scalar, Storage>::modelX,
+                                           MappedModel<Scalar, Storage>::modelMeanBRDF,
+                                           MappedModel<Scalar, Storage>::header.latentDim,
+                                           MappedModel<Scalar, Storage>::modelMu,
+                                           MappedModel<Scalar, Storage>::modelL) {
+        if (!brdfsDir.empty()) {
+            for (const auto &filename : MappedModel<Scalar, Storage>::modelBRDFFilenames) {
+                brdf_filePaths.push_back(brdfsDir + "/" + filename);
+            }
+        }
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    typename BRDFReconstructorMapped<Scalar, Dim, Storage>::MappingMap
+    BRDFReconstructorMapped<Scalar, Dim, Storage>::mappingMatrix() const {
+        const ModelHeader &header(MappedModel<Scalar, Storage>::header);
+        return MappingMap(reinterpret_cast<const Storage *>(MappedModel<Scalar, Storage>::file->data() + header.mappingOffset),
+                          header.nbBRDFs, header.nbCoefficients);
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorMapped<Scalar, Dim, Storage>::reconstruct(RowVector<Scalar> &brdf,
+                                                                    const Vector<Scalar> &coord) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        const MappingMap mapping(mappingMatrix());
+        if (std::is_same<Storage, Scalar>::value) {
+            // The rows of the matrix are streamed once
+            brdf.noalias() = cov_vector * mapping.template cast<Scalar>();
+        } else {
+            // Converting the whole matrix would allocate it in Scalar : convert one block at a time
+            const long blockSize(BRDFReconstructor<Scalar, Dim>::defaultBlockSize);
+            const long nbCoefficients(mapping.cols());
+            brdf.resize(nbCoefficients);
+            for (long first = 0; first < nbCoefficients; first += blockSize) {
+                const long size(std::min(blockSize, nbCoefficients - first));
+                brdf.segment(first, size).noalias() = cov_vector * mapping.middleCols(first, size).template cast<Scalar>();
+            }
+        }
+        brdf += BRDFReconstructor<Scalar, Dim>::meanBRDF;
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorMapped<Scalar, Dim, Storage>::reconstructBatchBlocks(
+            const Matrix<Scalar> &coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback &callback,
+            const long blockSize) const {
+        Matrix<Scalar> cov;
+        BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, coords, BRDFReconstructor<Scalar, Dim>::mu);
+        BRDFReconstructor<Scalar, Dim>::multiplyByBlocks(cov, mappingMatrix(), callback, blockSize);
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorMapped<Scalar, Dim, Storage>::reconstructCoefficients(
+            Vector<Scalar> &values,
+            const Vector<Scalar> &coord,
+            const std::vector<unsigned int> &indices) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        const MappingMap mapping(mappingMatrix());
+        values.resize(indices.size());
+        for (unsigned int k = 0; k < indices.size(); ++k) {
+            values[k] = cov_vector.dot(mapping.col(indices[k]).template cast<Scalar>())
+                        + BRDFReconstructor<Scalar, Dim>::meanBRDF[indices[k]];
+        }
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorMapped<Scalar, Dim, Storage>::checkBRDFFiles() const {
+        if (brdf_filePaths.empty()) {
+            throw ModelFileError{"The reconstruction errors need the folder of the BRDF files of the model"};
+        }
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    Scalar BRDFReconstructorMapped<Scalar, Dim, Storage>::reconstructionError(unsigned int brdfindex) const {
+        const unsigned int latentDim(BRDFReconstructor<Scalar, Dim>::latentDim);
+        if (brdfindex >= BRDFReconstructor<Scalar, Dim>::nb_data) {
+            std::cerr << "Given index for BRDF reconstruction is out of bounds !" << std::endl;
+            return Scalar(-1);
+        }
+        checkBRDFFiles();
+
+        RowVector<Scalar> reconstructed;
+        reconstruct(reconstructed, BRDFReconstructor<Scalar, Dim>::X.segment(brdfindex * latentDim, latentDim));
+        const RowVector<Scalar> diff(reconstructed - MERLReader::read_brdf<Scalar>(brdf_filePaths[brdfindex].c_str()));
+        return diff.dot(diff) / BRDFReconstructor<Scalar, Dim>::meanBRDF.cols();
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorMapped<Scalar, Dim, Storage>::reconstructionErrors(Matrix<Scalar> &errors) const {
+        checkBRDFFiles();
+        Matrix<Scalar> sums(Matrix<Scalar>::Zero(BRDFReconstructor<Scalar, Dim>::nb_data, 3));
+        Matrix<Scalar> residual;
+        reconstructBatchBlocks(BRDFReconstructor<Scalar, Dim>::Xsoa.transpose(),
+                [&](const long first, const Matrix<Scalar> &block) {
+                    // Each file is read once, one block at a time
+                    BRDFReconstructor<Scalar, Dim>::readCoefficientBlocks(residual, brdf_filePaths, first, block.cols());
+                    residual = block - residual;
+                    BRDFReconstructor<Scalar, Dim>::addSquaredErrors(sums, first, residual);
+                }, BRDFReconstructor<Scalar, Dim>::errorBlockSize);
+        BRDFReconstructor<Scalar, Dim>::meanSquareErrors(errors, sums);
+    }
+
+}
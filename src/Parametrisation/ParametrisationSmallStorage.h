@@ -2,6 +2,12 @@
 #define PARAMETRISATION_WITH_SMALL_STORAGE__H
 
 #include "Parametrisation.h"
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 
 /**
@@ -10,8 +16,8 @@
  */
 namespace ChefDevr {
 
-    template <typename Scalar>
-    class BRDFReconstructorSmallStorage : public BRDFReconstructor<Scalar>
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class BRDFReconstructorSmallStorage : public BRDFReconstructor<Scalar, Dim>
     {
     public:
         /**
@@ -33,13 +39,93 @@ namespace ChefDevr {
                 const Scalar _mu = MU_DEFAULT,
                 const Scalar _l = L_DEFAULT):
                 
-                BRDFReconstructor<Scalar>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
+                BRDFReconstructor<Scalar, Dim>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
                 _K_minus1{_K_minus1},
                 brdf_filePaths{brdf_filePaths}
         {}
 
+        /**
+         * @brief Constructor of the class that precomputes K_minus1 * Zcentered in a basis file
+         * @param _K_minus1 Inverse mapping matrix
+         * @param _X Latent variables vector
+         * @param _meanBRDF The mean BRDF (mean of the rows of Z before it was centered)
+         * @param _latentDim Dimension of the latent space
+         * @param brdf_filePaths The list of BRDF files
+         * @param basisPath Path of the basis file to write
+         * @param _mu Value of the mu constant that helps interpolation source data
+         * @param _l Constant defined in the research paper
+         *
+         * The BRDF files are read once, block of coefficients by block of coefficients, to write the basis.
+         * The basis file is then mapped in memory : a reconstruction streams it instead of reading every BRDF file,
+         * and the resident memory stays bounded. The file takes (nb_data + 1) x nbCoefficients scalars on the disk :
+         * the mean BRDF is stored before the basis, so that the basis can be mapped again (see mapBasis).
+         */
+        BRDFReconstructorSmallStorage (
+                const Matrix<Scalar>& _K_minus1,
+                const Vector<Scalar>& _X,
+                const RowVector<Scalar>& _meanBRDF,
+                const unsigned int _latentDim,
+                const std::vector<std::string> &brdf_filePaths,
+                const std::string &basisPath,
+                const Scalar _mu = MU_DEFAULT,
+                const Scalar _l = L_DEFAULT):
+
+                BRDFReconstructor<Scalar, Dim>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
+                _K_minus1{_K_minus1},
+                brdf_filePaths{brdf_filePaths}
+        {
+            writeBasis(basisPath);
+            basis.reset(new MappedFile(basisPath));
+            checkBasis();
+        }
+
+        /**
+         * @brief Constructor of the class that maps an existing basis file
+         * @param _K_minus1 Inverse mapping matrix
+         * @param _X Latent variables vector
+         * @param _meanBRDF The mean BRDF stored in the basis file (see mapBasis)
+         * @param _latentDim Dimension of the latent space
+         * @param brdf_filePaths The list of BRDF files (only read for the reconstruction errors)
+         * @param mappedBasis The basis file returned by mapBasis
+         * @param _mu Value of the mu constant that helps interpolation source data
+         * @param _l Constant defined in the research paper
+         *
+         * Neither the BRDF files nor the basis are read : the basis is streamed by the reconstructions
+         */
+        BRDFReconstructorSmallStorage (
+                const Matrix<Scalar>& _K_minus1,
+                const Vector<Scalar>& _X,
+                const RowVector<Scalar>& _meanBRDF,
+                const unsigned int _latentDim,
+                const std::vector<std::string> &brdf_filePaths,
+                std::unique_ptr<MappedFile> mappedBasis,
+                const Scalar _mu = MU_DEFAULT,
+                const Scalar _l = L_DEFAULT):
+
+                BRDFReconstructor<Scalar, Dim>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
+                basis{std::move(mappedBasis)},
+                _K_minus1{_K_minus1},
+                brdf_filePaths{brdf_filePaths}
+        {
+            checkBasis();
+        }
+
         ~BRDFReconstructorSmallStorage() = default;
 
+        /**
+         * @brief Maps a basis file written for an inverse mapping and reads its mean BRDF
+         * @param basisPath Path of the basis file
+         * @param K_minus1 Inverse mapping matrix
+         * @param[out] meanBRDF The mean BRDF stored in the basis file
+         * @return The mapped basis file, nullptr if it does not exist or was written for another inverse mapping
+         *
+         * The basis is identified by its dimensions and a fingerprint of the inverse mapping
+         */
+        static std::unique_ptr<MappedFile> mapBasis (
+            const std::string& basisPath,
+            const Matrix<Scalar>& K_minus1,
+            RowVector<Scalar>& meanBRDF);
+
 
         /**
          * @brief Reconstructs a BRDF from its latent space coordinates
@@ -56,8 +142,129 @@ namespace ChefDevr {
          */
         Scalar reconstructionError (unsigned int brdfindex) const override;
 
+        /**
+         * @brief Computes the errors between all the reference brdfs and their reconstructions at once
+         * @param errors The nb_data x 4 matrix to fill (see BRDFReconstructor::reconstructionErrors)
+         *
+         * The brdf files are streamed once, block of coefficients by block of coefficients :
+         * the reconstructions at the latent variables are K * K_minus1 times the blocks,
+         * so neither the basis file nor a full reconstruction is needed.
+         */
+        void reconstructionErrors (Matrix<Scalar>& errors) const override;
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points block of coefficients by block of coefficients
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         *
+         * With a basis file, each block is one matrix product with a block of the mapped basis.
+         * Otherwise each BRDF file is read once for all the points (instead of once per point)
+         * and the nbPoints x nbCoefficients result is then delivered by blocks.
+         */
+        void reconstructBatchBlocks (
+            const Matrix<Scalar>& coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback& callback,
+            long blockSize = BRDFReconstructor<Scalar, Dim>::defaultBlockSize) const override;
+
+        /**
+         * @brief Reconstructs some coefficients of the BRDF of a latent space point
+         * @param values The vector to fill, one value per index
+         * @param coord Coordinates of the latent space point
+         * @param indices Indices of the coefficients to reconstruct
+         *
+         * With a basis file only the columns of the given indices are read, otherwise the whole BRDF is reconstructed
+         */
+        void reconstructCoefficients (
+            Vector<Scalar>& values,
+            const Vector<Scalar>& coord,
+            const std::vector<unsigned int>& indices) const override;
+
     private:
 
+        /**
+         * @brief Row major map of the nb_data x nbCoefficients basis
+         */
+        using BasisMap = Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>;
+
+        /**
+         * @brief Header of the basis file, followed by the mean BRDF and the rows of K_minus1 * Zcentered
+         */
+        struct BasisHeader
+        {
+            /** @brief Identifies a basis file */
+            char magic[8];
+            /** @brief Number of rows (BRDFs) */
+            std::uint64_t rows;
+            /** @brief Number of columns (coefficients of a BRDF) */
+            std::uint64_t cols;
+            /** @brief Size of a scalar in bytes */
+            std::uint64_t scalarSize;
+            /** @brief Fingerprint of the inverse mapping (see fingerprint) */
+            std::uint64_t mapping;
+        };
+
+        /**
+         * @brief Number of coefficients read from each BRDF file at once when writing the basis
+         */
+        static constexpr unsigned int basisBlockSize = 1 << 16;
+
+        /**
+         * @param K_minus1 Inverse mapping matrix
+         * @return A FNV-1a hash of the coefficients of the inverse mapping rounded to double
+         */
+        static std::uint64_t fingerprint (const Matrix<Scalar>& K_minus1);
+
+        /**
+         * @brief Checks the header and the size of a basis file
+         * @param file The mapped basis file
+         * @param rows Number of BRDFs of the parametrisation
+         * @param cols Number of coefficients of a BRDF
+         * @param mapping Fingerprint of the inverse mapping
+         * @return True if the basis file was written for this parametrisation
+         */
+        static bool matchesBasis (const MappedFile& file, std::uint64_t rows, std::uint64_t cols, std::uint64_t mapping);
+
+        /**
+         * @brief Number of coefficients of the blocks distributed among threads when the BRDF files are accumulated
+         */
+        static constexpr unsigned int accumulationBlockSize = 1 << 14;
+
+        /**
+         * @brief Reconstructs BRDFs from the BRDF files, reading each file once for all of them
+         * @param brdfs The nbPoints x nbCoefficients matrix to fill (one BRDF per row)
+         * @param weights The nb_data x nbPoints weights of the BRDF files (K_minus1 times the covariance vectors)
+         *
+         * The contribution of a file to all the BRDFs is accumulated in parallel over blocks of coefficients,
+         * while the next file is read.
+         */
+        void accumulateBRDFFiles (Matrix<Scalar>& brdfs, const Matrix<Scalar>& weights) const;
+
+        /**
+         * @brief Writes the mean BRDF and K_minus1 * Zcentered in a basis file, reading the BRDF files once
+         * @param basisPath Path of the basis file to write
+         *
+         * The files are read in parallel, one block of coefficients at a time
+         */
+        void writeBasis (const std::string& basisPath) const;
+
+        /**
+         * @brief Checks the header of the mapped basis file
+         * @throw MappedFile::MappedFileError if it was not written for this parametrisation
+         */
+        void checkBasis () const;
+
+        /**
+         * @return The map of the basis file
+         * @pre The basis file is mapped
+         */
+        BasisMap basisMatrix () const;
+
+        /**
+         * @brief Mapped basis file (nullptr if the BRDF files are read for each reconstruction)
+         */
+        std::unique_ptr<MappedFile> basis;
+
         /**
          * @brief Inverse of K : Inverse mapping matrix
         */
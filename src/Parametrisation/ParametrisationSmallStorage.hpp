@@ -1,41 +1,119 @@
 #include <experimental/filesystem>
+#include <cstring>
+#include <exception>
 #include "MERLReader.h"
 
 
 namespace ChefDevr
 {
 
-    template<typename Scalar>
-    void BRDFReconstructorSmallStorage<Scalar>::reconstruct(RowVector<Scalar> &brdf_reconstructed,
-                                                            const Vector <Scalar> &coord) const {
+    template<typename Scalar, int Dim>
+    constexpr unsigned int BRDFReconstructorSmallStorage<Scalar, Dim>::basisBlockSize;
+
+    template<typename Scalar, int Dim>
+    constexpr unsigned int BRDFReconstructorSmallStorage<Scalar, Dim>::accumulationBlockSize;
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::reconstruct(RowVector<Scalar> &brdf_reconstructed,
+                                                                 const Vector <Scalar> &coord) const {
         using namespace std::experimental::filesystem;
 
-        RowVector <Scalar> cov_vector(BRDFReconstructor<Scalar>::nb_data);
-        computeCovVector<Scalar>(cov_vector.data(), BRDFReconstructor<Scalar>::X, coord, BRDFReconstructor<Scalar>::latentDim, BRDFReconstructor<Scalar>::nb_data);
+        RowVector <Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord, BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+
+        if (basis) {
+            // The rows of the basis are streamed once
+            brdf_reconstructed.noalias() = cov_vector * basisMatrix();
+            brdf_reconstructed += BRDFReconstructor<Scalar, Dim>::meanBRDF;
+            return;
+        }
         
-        const RowVector <Scalar> cov_Kminus1 = cov_vector * _K_minus1;
+        const Matrix<Scalar> cov_Kminus1(_K_minus1 * cov_vector.transpose());
+        Matrix<Scalar> brdfs;
+        accumulateBRDFFiles(brdfs, cov_Kminus1);
+        brdf_reconstructed = brdfs.row(0);
+    }
+    
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::reconstructBatchBlocks(
+            const Matrix<Scalar> &coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback &callback,
+            const long blockSize) const {
+        const RowVector<Scalar>& meanBRDF(BRDFReconstructor<Scalar, Dim>::meanBRDF);
+        const long num_BRDFCoefficients(meanBRDF.cols());
 
-        const auto num_brdfs = _K_minus1.rows();
-        brdf_reconstructed = BRDFReconstructor<Scalar>::meanBRDF;
+        Matrix<Scalar> cov;
+        BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, coords, BRDFReconstructor<Scalar, Dim>::mu);
+        if (basis) {
+            BRDFReconstructor<Scalar, Dim>::multiplyByBlocks(cov, basisMatrix(), callback, blockSize);
+            return;
+        }
+        // Weight of each BRDF file for each point (one row per BRDF file)
+        const Matrix<Scalar> weights(_K_minus1 * cov);
+        Matrix<Scalar> brdfs;
+        accumulateBRDFFiles(brdfs, weights);
 
-        for (unsigned int i = 0; i < num_brdfs; ++i) {
-            const RowVector <Scalar> brdf = MERLReader::read_brdf<Scalar>(brdf_filePaths[i].c_str());
-            brdf_reconstructed += cov_Kminus1(i) * (brdf - BRDFReconstructor<Scalar>::meanBRDF);
+        for (long first = 0; first < num_BRDFCoefficients; first += blockSize) {
+            callback(first, brdfs.middleCols(first, std::min(blockSize, num_BRDFCoefficients - first)));
         }
     }
-    
-    template<typename Scalar>
-    Scalar BRDFReconstructorSmallStorage<Scalar>::reconstructionError(const unsigned int brdfindex) const {
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::accumulateBRDFFiles(Matrix<Scalar> &brdfs,
+                                                                         const Matrix<Scalar> &weights) const {
+        const RowVector<Scalar>& meanBRDF(BRDFReconstructor<Scalar, Dim>::meanBRDF);
+        const long num_brdfs(weights.rows());
+        const long num_BRDFCoefficients(meanBRDF.cols());
+        const long nbBlocks((num_BRDFCoefficients + accumulationBlockSize - 1) / accumulationBlockSize);
+
+        brdfs.resize(weights.cols(), num_BRDFCoefficients);
+        brdfs.rowwise() = meanBRDF;
+        RowVector<Scalar> current(MERLReader::read_brdf<Scalar>(brdf_filePaths[0].c_str())), next;
+        // Exceptions cannot leave a parallel region : the one of the reading thread is thrown after it
+        std::exception_ptr readError;
+
+        for (long i = 0; i < num_brdfs; ++i) {
+            # pragma omp parallel
+            {
+                // One thread reads the next file while the others accumulate the current one
+                # pragma omp single nowait
+                {
+                    if (i + 1 < num_brdfs) {
+                        try {
+                            next = MERLReader::read_brdf<Scalar>(brdf_filePaths[i + 1].c_str());
+                        } catch (...) {
+                            readError = std::current_exception();
+                        }
+                    }
+                }
+
+                # pragma omp for schedule(dynamic)
+                for (long block = 0; block < nbBlocks; ++block) {
+                    const long first(block * accumulationBlockSize);
+                    const long size(std::min(long(accumulationBlockSize), num_BRDFCoefficients - first));
+                    brdfs.middleCols(first, size).noalias() += weights.row(i).transpose() *
+                            (current.segment(first, size) - meanBRDF.segment(first, size));
+                }
+            }
+            if (readError) {
+                std::rethrow_exception(readError);
+            }
+            current.swap(next);
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    Scalar BRDFReconstructorSmallStorage<Scalar, Dim>::reconstructionError(const unsigned int brdfindex) const {
         using namespace std::experimental::filesystem;
 
-        if (brdfindex < 0 || brdfindex >= BRDFReconstructor<Scalar>::nb_data) {
+        if (brdfindex < 0 || brdfindex >= BRDFReconstructor<Scalar, Dim>::nb_data) {
             std::cerr << "Given index for BRDF reconstruction is out of bounds !" << std::endl;
             return Scalar(-1);
         }
 
-        const long num_BRDFCoefficients =  BRDFReconstructor<Scalar>::meanBRDF.cols();
+        const long num_BRDFCoefficients =  BRDFReconstructor<Scalar, Dim>::meanBRDF.cols();
         RowVector <Scalar> reconstructed(num_BRDFCoefficients);
-        const Vector <Scalar> coord = BRDFReconstructor<Scalar>::X.segment(brdfindex * BRDFReconstructor<Scalar>::latentDim, BRDFReconstructor<Scalar>::latentDim);
+        const Vector <Scalar> coord = BRDFReconstructor<Scalar, Dim>::X.segment(brdfindex * BRDFReconstructor<Scalar, Dim>::latentDim, BRDFReconstructor<Scalar, Dim>::latentDim);
         
         reconstruct(reconstructed, coord);
         const RowVector <Scalar> brdf_groundTruth = MERLReader::read_brdf<Scalar>(brdf_filePaths[brdfindex].c_str());
@@ -45,4 +123,145 @@ namespace ChefDevr
         return diff.dot(diff) / num_BRDFCoefficients;
     }
 
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::reconstructCoefficients(
+            Vector<Scalar> &values,
+            const Vector<Scalar> &coord,
+            const std::vector<unsigned int> &indices) const {
+        if (!basis) {
+            BRDFReconstructor<Scalar, Dim>::reconstructCoefficients(values, coord, indices);
+            return;
+        }
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        const BasisMap basisRows(basisMatrix());
+        values.resize(indices.size());
+        for (unsigned int k = 0; k < indices.size(); ++k) {
+            values[k] = cov_vector.dot(basisRows.col(indices[k])) + BRDFReconstructor<Scalar, Dim>::meanBRDF[indices[k]];
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::writeBasis(const std::string &basisPath) const {
+        const RowVector<Scalar>& meanBRDF(BRDFReconstructor<Scalar, Dim>::meanBRDF);
+        const long num_brdfs(_K_minus1.rows());
+        const long num_BRDFCoefficients(meanBRDF.cols());
+
+        MappedFile file(basisPath, sizeof(BasisHeader) + (num_brdfs + 1) * num_BRDFCoefficients * sizeof(Scalar));
+        BasisHeader header;
+        std::memcpy(header.magic, "BRDFBS2", 8);
+        header.rows = num_brdfs;
+        header.cols = num_BRDFCoefficients;
+        header.scalarSize = sizeof(Scalar);
+        header.mapping = fingerprint(_K_minus1);
+        std::memcpy(file.data(), &header, sizeof(BasisHeader));
+        Scalar *values(reinterpret_cast<Scalar *>(file.data() + sizeof(BasisHeader)));
+        Eigen::Map<RowVector<Scalar>>(values, num_BRDFCoefficients) = meanBRDF;
+        Eigen::Map<Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>> basisRows(
+                values + num_BRDFCoefficients, num_brdfs, num_BRDFCoefficients);
+
+        // Each file is read once, one block of coefficients at a time : only nb_data x basisBlockSize values are held
+        Matrix<Scalar> Zblock;
+        for (long first = 0; first < num_BRDFCoefficients; first += basisBlockSize) {
+            const long size(std::min(long(basisBlockSize), num_BRDFCoefficients - first));
+            BRDFReconstructor<Scalar, Dim>::readCoefficientBlocks(Zblock, brdf_filePaths, first, size);
+            Zblock.rowwise() -= meanBRDF.segment(first, size);
+            basisRows.middleCols(first, size).noalias() = _K_minus1 * Zblock;
+        }
+        file.flush();
+    }
+
+    template<typename Scalar, int Dim>
+    std::uint64_t BRDFReconstructorSmallStorage<Scalar, Dim>::fingerprint(const Matrix<Scalar> &K_minus1) {
+        // The padding bytes of extended precision scalars are not hashed
+        std::uint64_t hash(14695981039346656037ull);
+        for (long j = 0; j < K_minus1.cols(); ++j) {
+            for (long i = 0; i < K_minus1.rows(); ++i) {
+                const double value(double(K_minus1(i, j)));
+                unsigned char bytes[sizeof(double)];
+                std::memcpy(bytes, &value, sizeof(double));
+                for (unsigned char byte : bytes) {
+                    hash = (hash ^ byte) * 1099511628211ull;
+                }
+            }
+        }
+        return hash;
+    }
+
+    template<typename Scalar, int Dim>
+    bool BRDFReconstructorSmallStorage<Scalar, Dim>::matchesBasis(const MappedFile &file, const std::uint64_t rows,
+                                                                   const std::uint64_t cols, const std::uint64_t mapping) {
+        BasisHeader header;
+        if (file.size() < sizeof(BasisHeader)) {
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(BasisHeader));
+        return std::memcmp(header.magic, "BRDFBS2", 8) == 0 && header.scalarSize == sizeof(Scalar) &&
+               header.rows == rows && header.cols == cols && header.mapping == mapping &&
+               file.size() == sizeof(BasisHeader) + (rows + 1) * cols * sizeof(Scalar);
+    }
+
+    template<typename Scalar, int Dim>
+    std::unique_ptr<MappedFile> BRDFReconstructorSmallStorage<Scalar, Dim>::mapBasis(
+            const std::string &basisPath,
+            const Matrix<Scalar> &K_minus1,
+            RowVector<Scalar> &meanBRDF) {
+        std::unique_ptr<MappedFile> file;
+        try {
+            file.reset(new MappedFile(basisPath));
+        } catch (const MappedFile::MappedFileError &) {
+            return nullptr;
+        }
+        if (!matchesBasis(*file, K_minus1.rows(), MERLReader::num_coefficientsBRDF, fingerprint(K_minus1))) {
+            return nullptr;
+        }
+        meanBRDF = Eigen::Map<const RowVector<Scalar>>(reinterpret_cast<const Scalar *>(file->data() + sizeof(BasisHeader)),
+                                                       MERLReader::num_coefficientsBRDF);
+        return file;
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::checkBasis() const {
+        if (!matchesBasis(*basis, BRDFReconstructor<Scalar, Dim>::nb_data, BRDFReconstructor<Scalar, Dim>::meanBRDF.cols(),
+                          fingerprint(_K_minus1))) {
+            throw MappedFile::MappedFileError{"The basis file does not match the parametrisation"};
+        }
+        basis->adviseSequential();
+    }
+
+    template<typename Scalar, int Dim>
+    typename BRDFReconstructorSmallStorage<Scalar, Dim>::BasisMap BRDFReconstructorSmallStorage<Scalar, Dim>::basisMatrix() const {
+        const long num_BRDFCoefficients(BRDFReconstructor<Scalar, Dim>::meanBRDF.cols());
+        // The mean BRDF is stored before the basis
+        return BasisMap(reinterpret_cast<const Scalar *>(basis->data() + sizeof(BasisHeader)) + num_BRDFCoefficients,
+                        BRDFReconstructor<Scalar, Dim>::nb_data, num_BRDFCoefficients);
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSmallStorage<Scalar, Dim>::reconstructionErrors(Matrix<Scalar> &errors) const {
+        const RowVector<Scalar>& meanBRDF(BRDFReconstructor<Scalar, Dim>::meanBRDF);
+        const long num_brdfs(BRDFReconstructor<Scalar, Dim>::nb_data);
+        const long num_BRDFCoefficients(meanBRDF.cols());
+        const long blockSize(BRDFReconstructor<Scalar, Dim>::errorBlockSize);
+
+        // Reconstruction of the centered brdfs at their latent variables : K * K_minus1 * Zcentered
+        Matrix<Scalar> cov;
+        BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, BRDFReconstructor<Scalar, Dim>::Xsoa.transpose(),
+                                                          BRDFReconstructor<Scalar, Dim>::mu);
+        const Matrix<Scalar> weights(cov.transpose() * _K_minus1);
+
+        Matrix<Scalar> sums(Matrix<Scalar>::Zero(num_brdfs, 3));
+        Matrix<Scalar> Zblock, residual;
+        for (long first = 0; first < num_BRDFCoefficients; first += blockSize) {
+            const long size(std::min(blockSize, num_BRDFCoefficients - first));
+            BRDFReconstructor<Scalar, Dim>::readCoefficientBlocks(Zblock, brdf_filePaths, first, size);
+            Zblock.rowwise() -= meanBRDF.segment(first, size);
+            residual.noalias() = weights * Zblock;
+            residual -= Zblock;
+            BRDFReconstructor<Scalar, Dim>::addSquaredErrors(sums, first, residual);
+        }
+        BRDFReconstructor<Scalar, Dim>::meanSquareErrors(errors, sums);
+    }
+
 }
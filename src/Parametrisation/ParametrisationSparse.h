@@ -0,0 +1,159 @@
+#ifndef PARAMETRISATION_SPARSE__H
+#define PARAMETRISATION_SPARSE__H
+
+#include "Parametrisation.h"
+
+#include <string>
+#include <vector>
+
+
+/**
+ * @file ParametrisationSparse.h
+ * @brief Does the BRDF space parametrisation from a sparse (inducing points) mapping
+ */
+namespace ChefDevr {
+
+    /**
+     * @brief Reconstructs BRDFs from the mapping computed by SparseOptimisationSolver
+     *
+     * The covariance vector of a latent point is computed against the m inducing points only,
+     * and the reconstruction is kt * P + meanBRDF where P = inverse(A) * Kmn * Zcentered (m x D)
+     * is computed once at construction.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class BRDFReconstructorSparse : public BRDFReconstructor<Scalar, Dim>
+    {
+    public:
+        /**
+         * @brief Constructor of the class
+         * @param _Zcentered Centered BRDFs data matrix (BRDFs stored in row major),
+         * @param _inverseMapping Sparse inverse mapping matrix (m x n)
+         * @param _inducingPoints Inducing points vector
+         * @param _latentVariables Latent variables vector
+         * @param _meanBRDF The mean BRDF (mean of the rows of Z before it was centered)
+         * @param _latentDim Dimension of the latent space
+         * @param _mu Value of the mu constant that helps interpolation source data
+         * @param _l Constant defined in the research paper
+         */
+        BRDFReconstructorSparse (
+                const Matrix<Scalar>& _Zcentered,
+                const Matrix<Scalar>& _inverseMapping,
+                const Vector<Scalar>& _inducingPoints,
+                const Vector<Scalar>& _latentVariables,
+                const RowVector<Scalar>& _meanBRDF,
+                const unsigned int _latentDim,
+                const Scalar _mu = MU_DEFAULT,
+                const Scalar _l = L_DEFAULT):
+
+                BRDFReconstructor<Scalar, Dim>(_inverseMapping, _inducingPoints, _meanBRDF, _latentDim, _mu, _l),
+                latentVariables(_latentVariables),
+                Zcentered(&_Zcentered),
+                brdf_filePaths(nullptr),
+                P(_inverseMapping*_Zcentered)
+        {}
+
+        /**
+         * @brief Constructor of the class that reads the BRDF files one by one
+         * @param _brdf_filePaths The list of BRDF filePaths in the order in which they were read
+         * @param _inverseMapping Sparse inverse mapping matrix (m x n)
+         * @param _inducingPoints Inducing points vector
+         * @param _latentVariables Latent variables vector
+         * @param _meanBRDF The mean BRDF (mean of the rows of Z before it was centered)
+         * @param _latentDim Dimension of the latent space
+         * @param _mu Value of the mu constant that helps interpolation source data
+         * @param _l Constant defined in the research paper
+         *
+         * Only the m x D matrix P is kept in memory
+         */
+        BRDFReconstructorSparse (
+                const std::vector<std::string>& _brdf_filePaths,
+                const Matrix<Scalar>& _inverseMapping,
+                const Vector<Scalar>& _inducingPoints,
+                const Vector<Scalar>& _latentVariables,
+                const RowVector<Scalar>& _meanBRDF,
+                const unsigned int _latentDim,
+                const Scalar _mu = MU_DEFAULT,
+                const Scalar _l = L_DEFAULT);
+
+        ~BRDFReconstructorSparse() = default;
+
+
+        /**
+         * @brief Reconstructs a BRDF from its latent space coordinates
+         * @param brdf The brdf data vector to fill
+         * @param coord Coordinates of the latent space point to recontruct as a BRDF
+         * @return The BRDF data as a row vector
+         */
+        void reconstruct (RowVector<Scalar>& brdf, const Vector<Scalar>& coord) const override;
+
+        /**
+         * @brief Computes the error between a reference brdf and this brdf reconstructed from its latent coordinates
+         * @param brdfindex : The index of the brdf in the list of brdfs read to construct Z
+         * @return the mean square error between a reference brdf and its reconstruction
+         */
+        Scalar reconstructionError (unsigned int brdfindex) const override;
+
+        /**
+         * @brief Computes the errors between all the reference brdfs and their reconstructions at once
+         * @param errors The nbBRDFs x 4 matrix to fill (see BRDFReconstructor::reconstructionErrors)
+         *
+         * Each block of coefficients is one matrix product with a block of P;
+         * without Zcentered, the same block is read from every brdf file.
+         */
+        void reconstructionErrors (Matrix<Scalar>& errors) const override;
+
+        /**
+         * @brief Reconstructs some coefficients of the BRDF of a latent space point
+         * @param values The vector to fill, one value per index
+         * @param coord Coordinates of the latent space point
+         * @param indices Indices of the coefficients to reconstruct
+         *
+         * Only the columns of P of the given indices are read
+         */
+        void reconstructCoefficients (
+            Vector<Scalar>& values,
+            const Vector<Scalar>& coord,
+            const std::vector<unsigned int>& indices) const override;
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points block of coefficients by block of coefficients
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         *
+         * Each block is one matrix product between the covariance vectors and a block of P.
+         */
+        void reconstructBatchBlocks (
+            const Matrix<Scalar>& coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback& callback,
+            long blockSize = BRDFReconstructor<Scalar, Dim>::defaultBlockSize) const override;
+
+    private:
+
+        /**
+         * @brief Latent variables vector of the BRDFs (the base class holds the inducing points)
+         */
+        const Vector<Scalar>& latentVariables;
+
+        /**
+         * @brief Centered BRDFs data matrix (nullptr if the BRDFs are read from files)
+         */
+        const Matrix<Scalar>* Zcentered;
+
+        /**
+         * @brief the list of BRDF filePaths (nullptr if the BRDFs are given in Zcentered)
+         */
+        const std::vector<std::string>* brdf_filePaths;
+
+        /**
+         * @brief Sparse inverse mapping matrix times Z centered
+         */
+        Matrix<Scalar> P;
+
+    };
+
+} // ChefDevr
+
+#include "ParametrisationSparse.hpp"
+
+#endif // PARAMETRISATION_SPARSE__H
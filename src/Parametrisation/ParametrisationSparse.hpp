@@ -0,0 +1,110 @@
+#include "MERLReader.h"
+
+
+namespace ChefDevr {
+
+    template<typename Scalar, int Dim>
+    BRDFReconstructorSparse<Scalar, Dim>::BRDFReconstructorSparse(
+            const std::vector<std::string>& _brdf_filePaths,
+            const Matrix<Scalar>& _inverseMapping,
+            const Vector<Scalar>& _inducingPoints,
+            const Vector<Scalar>& _latentVariables,
+            const RowVector<Scalar>& _meanBRDF,
+            const unsigned int _latentDim,
+            const Scalar _mu,
+            const Scalar _l):
+
+            BRDFReconstructor<Scalar, Dim>(_inverseMapping, _inducingPoints, _meanBRDF, _latentDim, _mu, _l),
+            latentVariables(_latentVariables),
+            Zcentered(nullptr),
+            brdf_filePaths(&_brdf_filePaths),
+            P(Matrix<Scalar>::Zero(_inverseMapping.rows(), _meanBRDF.cols()))
+    {
+        for (unsigned int i = 0; i < _inverseMapping.cols(); ++i) {
+            const RowVector <Scalar> brdf = MERLReader::read_brdf<Scalar>(_brdf_filePaths[i].c_str());
+            P.noalias() += _inverseMapping.col(i) * (brdf - _meanBRDF);
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSparse<Scalar, Dim>::reconstruct(RowVector<Scalar> &brdf,
+                                                           const Vector <Scalar> &coord) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        // Inducing points and reconstructed points are distinct : no mu term
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         Scalar(0), BRDFReconstructor<Scalar, Dim>::l);
+        brdf.noalias() = cov_vector * P + BRDFReconstructor<Scalar, Dim>::meanBRDF;
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSparse<Scalar, Dim>::reconstructBatchBlocks(
+            const Matrix<Scalar> &coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback &callback,
+            const long blockSize) const {
+        Matrix<Scalar> cov;
+        // Inducing points and reconstructed points are distinct : no mu term
+        BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, coords, Scalar(0));
+        BRDFReconstructor<Scalar, Dim>::multiplyByBlocks(cov, P, callback, blockSize);
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSparse<Scalar, Dim>::reconstructCoefficients(
+            Vector<Scalar> &values,
+            const Vector<Scalar> &coord,
+            const std::vector<unsigned int> &indices) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        // Inducing points and reconstructed points are distinct : no mu term
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         Scalar(0), BRDFReconstructor<Scalar, Dim>::l);
+        values.resize(indices.size());
+        for (unsigned int k = 0; k < indices.size(); ++k) {
+            values[k] = cov_vector.dot(P.col(indices[k])) + BRDFReconstructor<Scalar, Dim>::meanBRDF[indices[k]];
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    Scalar BRDFReconstructorSparse<Scalar, Dim>::reconstructionError(unsigned int brdfindex) const {
+        const unsigned int latentDim(BRDFReconstructor<Scalar, Dim>::latentDim);
+        if (brdfindex >= latentVariables.rows() / latentDim) {
+            std::cerr << "Given index for BRDF reconstruction is out of bounds !" << std::endl;
+            return Scalar(-1);
+        }
+
+        const long num_BRDFCoefficients = BRDFReconstructor<Scalar, Dim>::meanBRDF.cols();
+        RowVector<Scalar> reconstructed(num_BRDFCoefficients);
+        const Vector <Scalar> coord = latentVariables.segment(brdfindex * latentDim, latentDim);
+
+        reconstruct(reconstructed, coord);
+        RowVector<Scalar> diff;
+        if (Zcentered) {
+            diff = reconstructed - BRDFReconstructor<Scalar, Dim>::meanBRDF - Zcentered->row(brdfindex);
+        } else {
+            diff = reconstructed - MERLReader::read_brdf<Scalar>((*brdf_filePaths)[brdfindex].c_str());
+        }
+
+        return diff.dot(diff) / num_BRDFCoefficients;
+    }
+
+    template<typename Scalar, int Dim>
+    void BRDFReconstructorSparse<Scalar, Dim>::reconstructionErrors(Matrix<Scalar> &errors) const {
+        const unsigned int latentDim(BRDFReconstructor<Scalar, Dim>::latentDim);
+        const Matrix<Scalar> coords(Eigen::Map<const Matrix<Scalar>>(latentVariables.data(), latentDim,
+                                                                     latentVariables.rows() / latentDim));
+        if (Zcentered) {
+            BRDFReconstructor<Scalar, Dim>::centeredErrors(errors, coords, *Zcentered);
+            return;
+        }
+
+        Matrix<Scalar> sums(Matrix<Scalar>::Zero(coords.cols(), 3));
+        Matrix<Scalar> residual;
+        reconstructBatchBlocks(coords,
+                [&](const long first, const Matrix<Scalar> &block) {
+                    // Each file is read once, one block at a time
+                    BRDFReconstructor<Scalar, Dim>::readCoefficientBlocks(residual, *brdf_filePaths, first, block.cols());
+                    residual = block - residual;
+                    BRDFReconstructor<Scalar, Dim>::addSquaredErrors(sums, first, residual);
+                }, BRDFReconstructor<Scalar, Dim>::errorBlockSize);
+        BRDFReconstructor<Scalar, Dim>::meanSquareErrors(errors, sums);
+    }
+
+}
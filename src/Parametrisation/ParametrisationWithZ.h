@@ -3,6 +3,8 @@
 
 #include "Parametrisation.h"
 
+#include <type_traits>
+
 
 /**
  * @file ParametrisationWithZ.h
@@ -10,8 +12,16 @@
  */
 namespace ChefDevr {
 
-    template <typename Scalar>
-    class BRDFReconstructorWithZ : public BRDFReconstructor<Scalar>
+    /**
+     * @brief Reconstructs BRDFs from the centered BRDFs data matrix
+     * @tparam Storage The type of the values of the stored K_minus1 * Zcentered matrix.
+     * A type smaller than Scalar (float or double) divides the resident memory and the bandwidth
+     * of the reconstruction : the covariance weights stay in Scalar and the stored values are
+     * converted to Scalar block by block, so the products are still accumulated in Scalar.
+     * Only the rounding of the stored values is lost, see getStorageDeviation.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic, typename Storage = Scalar>
+    class BRDFReconstructorWithZ : public BRDFReconstructor<Scalar, Dim>
     {
     public:
         /**
@@ -33,10 +43,12 @@ namespace ChefDevr {
                 const Scalar _mu = MU_DEFAULT,
                 const Scalar _l = L_DEFAULT):
                 
-                BRDFReconstructor<Scalar>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
+                BRDFReconstructor<Scalar, Dim>(_K_minus1, _X, _meanBRDF, _latentDim, _mu, _l),
                 Zcentered(_Zcentered),
-                Km1Zc(_K_minus1*_Zcentered)
-        {}
+                Km1Zc(_K_minus1.rows(), _Zcentered.cols()),
+                storageDeviation(storeMapping(_K_minus1))
+        {
+        }
 
         ~BRDFReconstructorWithZ() = default;
 
@@ -56,6 +68,46 @@ namespace ChefDevr {
          */
         Scalar reconstructionError (unsigned int brdfindex) const override;
 
+        /**
+         * @brief Computes the errors between all the reference brdfs and their reconstructions at once
+         * @param errors The nb_data x 4 matrix to fill (see BRDFReconstructor::reconstructionErrors)
+         *
+         * Each block of coefficients is one matrix product between the covariances of the latent variables and Km1Zc.
+         */
+        void reconstructionErrors (Matrix<Scalar>& errors) const override;
+
+        /**
+         * @brief Reconstructs some coefficients of the BRDF of a latent space point
+         * @param values The vector to fill, one value per index
+         * @param coord Coordinates of the latent space point
+         * @param indices Indices of the coefficients to reconstruct
+         *
+         * Only the columns of Km1Zc of the given indices are read
+         */
+        void reconstructCoefficients (
+            Vector<Scalar>& values,
+            const Vector<Scalar>& coord,
+            const std::vector<unsigned int>& indices) const override;
+
+        /**
+         * @return The largest absolute difference between the coefficients reconstructed at the latent variables
+         * with the stored K_minus1 * Zcentered and with its full precision value (0 when Storage is Scalar)
+         */
+        inline Scalar getStorageDeviation() const { return storageDeviation; }
+
+        /**
+         * @brief Reconstructs the BRDFs of several latent space points block of coefficients by block of coefficients
+         * @param coords Coordinates of the latent space points (one point per column)
+         * @param callback Function called for each block, in the order of the coefficients
+         * @param blockSize Number of coefficients of a block
+         *
+         * Each block is one matrix product between the covariance vectors and a block of Km1Zc.
+         */
+        void reconstructBatchBlocks (
+            const Matrix<Scalar>& coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback& callback,
+            long blockSize = BRDFReconstructor<Scalar, Dim>::defaultBlockSize) const override;
+
     private:
 
         /**
@@ -66,7 +118,31 @@ namespace ChefDevr {
         /**
          * @brief K_minus1 times Z centered
          */
-        const Matrix<Scalar> Km1Zc;
+        Matrix<Storage> Km1Zc;
+
+        /**
+         * @brief Largest deviation of the reconstruction due to the storage type (see getStorageDeviation)
+         */
+        Scalar storageDeviation;
+
+        /**
+         * @brief Multiplies a covariance vector by the stored K_minus1 * Zcentered
+         * @param brdf The brdf data vector to fill
+         * @param cov_vector The covariance vector
+         *
+         * The stored values are converted to Scalar block by block of coefficients
+         */
+        void mapCovariance (RowVector<Scalar>& brdf, const RowVector<Scalar>& cov_vector) const;
+
+        /**
+         * @brief Fills Km1Zc block by block of coefficients and, when Storage is not Scalar, compares
+         * the reconstructions at the latent variables with the stored and the full precision blocks
+         * @param K_minus1 Inverse mapping matrix
+         * @return The largest absolute difference between the reconstructed coefficients (0 when Storage is Scalar)
+         *
+         * Only one block of K_minus1 * Zcentered is held in Scalar at a time
+         */
+        Scalar storeMapping (const Matrix<Scalar>& K_minus1);
 
         /**
          * @brief Reconstructs a BRDF for latent space coordinates without adding the mean
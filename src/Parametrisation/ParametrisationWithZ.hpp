@@ -2,38 +2,106 @@
 
 namespace ChefDevr {
 
-    template<typename Scalar>
-    void BRDFReconstructorWithZ<Scalar>::reconstruct(RowVector<Scalar> &brdf,
-                                                     const Vector <Scalar> &coord) const {
-        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar>::nb_data);
-        computeCovVector<Scalar>(cov_vector.data(), BRDFReconstructor<Scalar>::X, coord,
-                                 BRDFReconstructor<Scalar>::latentDim, BRDFReconstructor<Scalar>::nb_data);
-        brdf.noalias() = cov_vector * Km1Zc + BRDFReconstructor<Scalar>::meanBRDF;
-    }
-
-    template<typename Scalar>
-    void BRDFReconstructorWithZ<Scalar>::reconstructWithoutMean(RowVector <Scalar> &brdf,
-                                                                const Vector <Scalar> &coord) const {
-        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar>::nb_data);
-        computeCovVector<Scalar>(cov_vector.data(), BRDFReconstructor<Scalar>::X, coord,
-                                 BRDFReconstructor<Scalar>::latentDim, BRDFReconstructor<Scalar>::nb_data);
-        brdf.noalias() = cov_vector * Km1Zc;
-    }
-
-    template<typename Scalar>
-    Scalar BRDFReconstructorWithZ<Scalar>::reconstructionError(unsigned int brdfindex) const {
-        if (brdfindex < 0 || brdfindex >= BRDFReconstructor<Scalar>::nb_data) {
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorWithZ<Scalar, Dim, Storage>::reconstruct(RowVector<Scalar> &brdf,
+                                                                   const Vector <Scalar> &coord) const {
+        reconstructWithoutMean(brdf, coord);
+        brdf += BRDFReconstructor<Scalar, Dim>::meanBRDF;
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorWithZ<Scalar, Dim, Storage>::reconstructBatchBlocks(
+            const Matrix<Scalar> &coords,
+            const typename BRDFReconstructor<Scalar, Dim>::BlockCallback &callback,
+            const long blockSize) const {
+        Matrix<Scalar> cov;
+        BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, coords, BRDFReconstructor<Scalar, Dim>::mu);
+        BRDFReconstructor<Scalar, Dim>::multiplyByBlocks(cov, Km1Zc, callback, blockSize);
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorWithZ<Scalar, Dim, Storage>::reconstructWithoutMean(RowVector <Scalar> &brdf,
+                                                                              const Vector <Scalar> &coord) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        mapCovariance(brdf, cov_vector);
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorWithZ<Scalar, Dim, Storage>::reconstructCoefficients(
+            Vector<Scalar> &values,
+            const Vector<Scalar> &coord,
+            const std::vector<unsigned int> &indices) const {
+        RowVector<Scalar> cov_vector(BRDFReconstructor<Scalar, Dim>::nb_data);
+        computeCovVectorSoA<Scalar, Dim>(cov_vector.data(), BRDFReconstructor<Scalar, Dim>::Xsoa, coord,
+                                         BRDFReconstructor<Scalar, Dim>::mu, BRDFReconstructor<Scalar, Dim>::l);
+        values.resize(indices.size());
+        for (unsigned int k = 0; k < indices.size(); ++k) {
+            values[k] = cov_vector.dot(Km1Zc.col(indices[k]).template cast<Scalar>())
+                        + BRDFReconstructor<Scalar, Dim>::meanBRDF[indices[k]];
+        }
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorWithZ<Scalar, Dim, Storage>::mapCovariance(RowVector <Scalar> &brdf,
+                                                                     const RowVector <Scalar> &cov_vector) const {
+        if (std::is_same<Storage, Scalar>::value) {
+            brdf.noalias() = cov_vector * Km1Zc.template cast<Scalar>();
+            return;
+        }
+        // Converting the whole matrix would allocate it in Scalar : convert one block at a time
+        const long blockSize(BRDFReconstructor<Scalar, Dim>::defaultBlockSize);
+        const long nbCoefficients(Km1Zc.cols());
+        brdf.resize(nbCoefficients);
+        for (long first = 0; first < nbCoefficients; first += blockSize) {
+            const long size(std::min(blockSize, nbCoefficients - first));
+            brdf.segment(first, size).noalias() = cov_vector * Km1Zc.middleCols(first, size).template cast<Scalar>();
+        }
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    Scalar BRDFReconstructorWithZ<Scalar, Dim, Storage>::storeMapping(const Matrix<Scalar> &K_minus1) {
+        const bool reduced(!std::is_same<Storage, Scalar>::value);
+        const long blockSize(BRDFReconstructor<Scalar, Dim>::defaultBlockSize);
+        const long nbCoefficients(Km1Zc.cols());
+        Matrix<Scalar> cov, block;
+        if (reduced) {
+            BRDFReconstructor<Scalar, Dim>::computeCovColumns(cov, BRDFReconstructor<Scalar, Dim>::Xsoa.transpose(),
+                                                              BRDFReconstructor<Scalar, Dim>::mu);
+        }
+        Scalar deviation(0);
+        for (long first = 0; first < nbCoefficients; first += blockSize) {
+            const long size(std::min(blockSize, nbCoefficients - first));
+            block.noalias() = K_minus1 * Zcentered.middleCols(first, size);
+            Km1Zc.middleCols(first, size) = block.template cast<Storage>();
+            if (reduced) {
+                block -= Km1Zc.middleCols(first, size).template cast<Scalar>();
+                deviation = std::max(deviation, Scalar((cov.transpose() * block).cwiseAbs().maxCoeff()));
+            }
+        }
+        return deviation;
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    Scalar BRDFReconstructorWithZ<Scalar, Dim, Storage>::reconstructionError(unsigned int brdfindex) const {
+        if (brdfindex < 0 || brdfindex >= BRDFReconstructor<Scalar, Dim>::nb_data) {
             std::cerr << "Given index for BRDF reconstruction is out of bounds !" << std::endl;
             return Scalar(-1);
         }
 
         RowVector<Scalar> reconstructed(Zcentered.cols());
-        const Vector <Scalar> coord = BRDFReconstructor<Scalar>::X.segment(brdfindex * BRDFReconstructor<Scalar>::latentDim,BRDFReconstructor<Scalar>::latentDim);
+        const Vector <Scalar> coord = BRDFReconstructor<Scalar, Dim>::X.segment(brdfindex * BRDFReconstructor<Scalar, Dim>::latentDim,BRDFReconstructor<Scalar, Dim>::latentDim);
         
         reconstructWithoutMean(reconstructed, coord);
         const RowVector<Scalar> diff = reconstructed - Zcentered.row(brdfindex);
 
-        return diff.dot(diff) / BRDFReconstructor<Scalar>::meanBRDF.cols();
+        return diff.dot(diff) / BRDFReconstructor<Scalar, Dim>::meanBRDF.cols();
+    }
+
+    template<typename Scalar, int Dim, typename Storage>
+    void BRDFReconstructorWithZ<Scalar, Dim, Storage>::reconstructionErrors(Matrix<Scalar> &errors) const {
+        BRDFReconstructor<Scalar, Dim>::centeredErrors(errors, BRDFReconstructor<Scalar, Dim>::Xsoa.transpose(), Zcentered);
     }
 
 }
@@ -0,0 +1,276 @@
+#ifndef RECONSTRUCTION_CACHE__H
+#define RECONSTRUCTION_CACHE__H
+
+/**
+ * @file ReconstructionCache.h
+ * @brief Cache of the BRDFs reconstructed from nearby latent space points
+ */
+
+#include "Parametrisation.h"
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief Caching layer around a BRDFReconstructor for tools that query the same
+     * or nearby latent space points over and over
+     * @tparam Scalar The type of the values used to reconstruct a BRDF
+     * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+     *
+     * Two levels share a memory cap :
+     * - a least recently used cache of BRDFs reconstructed at quantised latent coordinates :
+     * the coordinates are rounded to a multiple of the quantum, so that nearby queries share an entry ;
+     * - an optional coarse grid of BRDFs reconstructed at regularly spaced latent coordinates,
+     * multilinearly interpolated for approximate queries. The interpolation error of each cell is measured
+     * at its center when the grid is built : the cells above the error bound are answered by the cache instead.
+     *
+     * The queries can be made from several threads.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class ReconstructionCache
+    {
+    public:
+        /**
+         * @brief Constructor of the class
+         * @param _reconstructor The reconstructor of the BRDFs, must outlive the cache
+         * @param _memoryCap Maximum number of bytes taken by the cached BRDFs and the grid
+         * @param _quantum Step of the quantisation of the latent coordinates (must be positive)
+         */
+        ReconstructionCache (
+            const BRDFReconstructor<Scalar, Dim>& _reconstructor,
+            std::size_t _memoryCap,
+            Scalar _quantum);
+
+        ReconstructionCache (const ReconstructionCache&) = delete;
+
+        ReconstructionCache& operator= (const ReconstructionCache&) = delete;
+
+        /**
+         * @brief Reconstructs the BRDF of the quantised latent coordinates, from the cache if possible
+         * @param brdf The brdf data vector to fill
+         * @param coord Coordinates of the latent space point (rounded to a multiple of the quantum)
+         */
+        void reconstruct (RowVector<Scalar>& brdf, const Vector<Scalar>& coord);
+
+        /**
+         * @brief Reconstructs an approximate BRDF of a latent space point
+         * @param brdf The brdf data vector to fill
+         * @param coord Coordinates of the latent space point
+         * @return True if the BRDF is interpolated in the grid, false if it comes from reconstruct
+         *
+         * Points out of the grid, or in a cell whose error is above the error bound, are given to reconstruct.
+         */
+        bool reconstructApproximate (RowVector<Scalar>& brdf, const Vector<Scalar>& coord);
+
+        /**
+         * @brief Reconstructs the BRDFs of the nodes of a regular grid of the latent space
+         * @param lower Lowest coordinates of the grid
+         * @param upper Highest coordinates of the grid
+         * @param resolution Number of nodes along each axis (at least 2)
+         * @param errorBound Mean square error above which a cell is not interpolated
+         *
+         * The grid takes resolution^latentDim BRDFs out of the memory cap, the least recently used entries
+         * of the cache are evicted to make room. The nodes and the cell centers are reconstructed by batches.
+         * Replaces the previous grid : no query must be made meanwhile.
+         */
+        void buildGrid (
+            const Vector<Scalar>& lower,
+            const Vector<Scalar>& upper,
+            unsigned int resolution,
+            Scalar errorBound);
+
+        /**
+         * @brief Removes the cached BRDFs (the grid is kept)
+         */
+        void clear ();
+
+        /**
+         * @return The maximum number of cached BRDFs that fit in the memory cap besides the grid
+         */
+        inline std::size_t getCapacity() const { return capacity; }
+
+        /**
+         * @return The number of cached BRDFs
+         */
+        std::size_t getSize() const;
+
+        /**
+         * @return The number of queries answered by the cache
+         */
+        inline unsigned long getHits() const { return hits; }
+
+        /**
+         * @return The number of queries that reconstructed a BRDF
+         */
+        inline unsigned long getMisses() const { return misses; }
+
+        /**
+         * @return The number of approximate queries answered by the grid
+         */
+        inline unsigned long getInterpolations() const { return interpolations; }
+
+        /**
+         * @return The mean square interpolation error measured at the center of each cell of the grid
+         */
+        inline const std::vector<Scalar>& getCellErrors() const { return cellErrors; }
+
+        class ReconstructionCacheError : public std::runtime_error {
+        public:
+            explicit ReconstructionCacheError(const std::string& msg) :
+                    std::runtime_error(msg) {}
+        };
+
+    private:
+        /**
+         * @brief Quantised latent coordinates : multiples of the quantum
+         */
+        using Key = std::vector<long>;
+
+        struct KeyHash
+        {
+            std::size_t operator() (const Key& key) const;
+        };
+
+        /**
+         * @brief Cached BRDF
+         */
+        struct Entry
+        {
+            /** @brief Quantised coordinates the BRDF is reconstructed at */
+            Key key;
+            /** @brief Reconstructed BRDF */
+            RowVector<Scalar> brdf;
+        };
+
+        /**
+         * @brief Rounds latent coordinates to multiples of the quantum
+         * @param coord Coordinates of the latent space point
+         * @return The quantised coordinates
+         */
+        Key quantise (const Vector<Scalar>& coord) const;
+
+        /**
+         * @brief Evicts the least recently used entries until the cache holds at most the capacity
+         * @pre The mutex is locked
+         */
+        void evict ();
+
+        /**
+         * @brief Finds the grid nodes around a latent space point and their interpolation weights
+         * @param coord Coordinates of the latent space point
+         * @param nodes The 2^latentDim indices of the nodes to fill
+         * @param weights The 2^latentDim weights of the nodes to fill
+         * @return The index of the cell of the point, -1 if the point is out of the grid
+         */
+        long locate (const Vector<Scalar>& coord, std::vector<long>& nodes, std::vector<Scalar>& weights) const;
+
+        /**
+         * @brief Measures the interpolation error at the center of each cell of the grid
+         */
+        void measureCellErrors ();
+
+        /**
+         * @brief Number of cell centers reconstructed by batch when the grid is built
+         */
+        static constexpr long centerBatchSize = 8;
+
+        /**
+         * @brief Reconstructor of the BRDFs
+         */
+        const BRDFReconstructor<Scalar, Dim>& reconstructor;
+
+        /**
+         * @brief Maximum number of bytes taken by the cached BRDFs and the grid
+         */
+        const std::size_t memoryCap;
+
+        /**
+         * @brief Step of the quantisation of the latent coordinates
+         */
+        const Scalar quantum;
+
+        /**
+         * @brief Number of bytes of a BRDF
+         */
+        const std::size_t brdfBytes;
+
+        /**
+         * @brief Maximum number of cached BRDFs
+         */
+        std::size_t capacity;
+
+        /**
+         * @brief Cached BRDFs, the most recently used first
+         */
+        std::list<Entry> entries;
+
+        /**
+         * @brief Position of the cached BRDFs in the list by quantised coordinates
+         */
+        std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> index;
+
+        /**
+         * @brief Protects the list and the index
+         */
+        mutable std::mutex mutex;
+
+        /**
+         * @brief Lowest coordinates of the grid
+         */
+        Vector<Scalar> gridLower;
+
+        /**
+         * @brief Distance between two nodes along each axis
+         */
+        Vector<Scalar> gridStep;
+
+        /**
+         * @brief Number of nodes along each axis (0 if there is no grid)
+         */
+        unsigned int gridResolution;
+
+        /**
+         * @brief BRDFs of the nodes (one per row, the first axis varies fastest)
+         */
+        Matrix<Scalar> gridNodes;
+
+        /**
+         * @brief Interpolation error of each cell (the first axis varies fastest)
+         */
+        std::vector<Scalar> cellErrors;
+
+        /**
+         * @brief Mean square error above which a cell is not interpolated
+         */
+        Scalar gridErrorBound;
+
+        /**
+         * @brief Number of queries answered by the cache
+         */
+        std::atomic<unsigned long> hits;
+
+        /**
+         * @brief Number of queries that reconstructed a BRDF
+         */
+        std::atomic<unsigned long> misses;
+
+        /**
+         * @brief Number of approximate queries answered by the grid
+         */
+        std::atomic<unsigned long> interpolations;
+    };
+
+} // ChefDevr
+
+#include "ReconstructionCache.hpp"
+
+#endif // RECONSTRUCTION_CACHE__H
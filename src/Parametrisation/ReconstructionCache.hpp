@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+
+namespace ChefDevr {
+
+    template<typename Scalar, int Dim>
+    constexpr long ReconstructionCache<Scalar, Dim>::centerBatchSize;
+
+    template<typename Scalar, int Dim>
+    ReconstructionCache<Scalar, Dim>::ReconstructionCache(
+            const BRDFReconstructor<Scalar, Dim>& _reconstructor,
+            const std::size_t _memoryCap,
+            const Scalar _quantum):
+
+            reconstructor(_reconstructor),
+            memoryCap(_memoryCap),
+            quantum(_quantum),
+            brdfBytes(_reconstructor.getBRDFCoeffNb() * sizeof(Scalar)),
+            capacity(_memoryCap / brdfBytes),
+            gridResolution(0),
+            gridErrorBound(0),
+            hits(0),
+            misses(0),
+            interpolations(0)
+    {
+        if (!(_quantum > Scalar(0))) {
+            throw ReconstructionCacheError{"The quantum of the latent coordinates must be positive"};
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    std::size_t ReconstructionCache<Scalar, Dim>::KeyHash::operator()(const Key &key) const {
+        std::size_t seed(key.size());
+        for (const long k : key) {
+            seed ^= std::hash<long>()(k) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        return seed;
+    }
+
+    template<typename Scalar, int Dim>
+    typename ReconstructionCache<Scalar, Dim>::Key ReconstructionCache<Scalar, Dim>::quantise(const Vector<Scalar> &coord) const {
+        Key key(coord.rows());
+        for (long c = 0; c < coord.rows(); ++c) {
+            key[c] = std::lround(double(coord[c] / quantum));
+        }
+        return key;
+    }
+
+    template<typename Scalar, int Dim>
+    void ReconstructionCache<Scalar, Dim>::reconstruct(RowVector<Scalar> &brdf, const Vector<Scalar> &coord) {
+        const Key key(quantise(coord));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto found(index.find(key));
+            if (found != index.end()) {
+                entries.splice(entries.begin(), entries, found->second);
+                brdf = found->second->brdf;
+                ++hits;
+                return;
+            }
+        }
+        ++misses;
+
+        // Reconstructed at the quantised coordinates : the entry does not depend on the first query
+        Vector<Scalar> center(key.size());
+        for (unsigned int c = 0; c < key.size(); ++c) {
+            center[c] = Scalar(key[c]) * quantum;
+        }
+        reconstructor.reconstruct(brdf, center);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        // Another thread may have reconstructed the same entry meanwhile
+        if (capacity == 0 || index.count(key)) {
+            return;
+        }
+        entries.push_front(Entry{key, brdf});
+        index[key] = entries.begin();
+        evict();
+    }
+
+    template<typename Scalar, int Dim>
+    bool ReconstructionCache<Scalar, Dim>::reconstructApproximate(RowVector<Scalar> &brdf, const Vector<Scalar> &coord) {
+        std::vector<long> nodes;
+        std::vector<Scalar> weights;
+        const long cell(gridResolution > 0 ? locate(coord, nodes, weights) : -1);
+        if (cell < 0 || cellErrors[cell] > gridErrorBound) {
+            reconstruct(brdf, coord);
+            return false;
+        }
+        brdf = weights[0] * gridNodes.row(nodes[0]);
+        for (unsigned int k = 1; k < nodes.size(); ++k) {
+            brdf += weights[k] * gridNodes.row(nodes[k]);
+        }
+        ++interpolations;
+        return true;
+    }
+
+    template<typename Scalar, int Dim>
+    void ReconstructionCache<Scalar, Dim>::buildGrid(
+            const Vector<Scalar> &lower,
+            const Vector<Scalar> &upper,
+            const unsigned int resolution,
+            const Scalar errorBound) {
+        const unsigned int latentDim(reconstructor.getLatentDim());
+        if (lower.rows() != long(latentDim) || upper.rows() != long(latentDim) || resolution < 2 ||
+            !((upper - lower).minCoeff() > Scalar(0))) {
+            throw ReconstructionCacheError{"The grid must have at least 2 nodes along each axis of the latent space"};
+        }
+        long nbNodes(1);
+        for (unsigned int c = 0; c < latentDim; ++c) {
+            nbNodes *= resolution;
+        }
+        if (std::size_t(nbNodes) * brdfBytes > memoryCap) {
+            throw ReconstructionCacheError{"The grid does not fit in the memory cap of the cache"};
+        }
+
+        gridResolution = resolution;
+        gridLower = lower;
+        gridStep = (upper - lower) / Scalar(resolution - 1);
+        gridErrorBound = errorBound;
+
+        // The first axis varies fastest
+        Matrix<Scalar> coords(latentDim, nbNodes);
+        for (long node = 0; node < nbNodes; ++node) {
+            long rest(node);
+            for (unsigned int c = 0; c < latentDim; ++c) {
+                coords(c, node) = gridLower[c] + Scalar(rest % resolution) * gridStep[c];
+                rest /= resolution;
+            }
+        }
+        {
+            // The grid takes its memory from the cache
+            std::lock_guard<std::mutex> lock(mutex);
+            capacity = (memoryCap - nbNodes * brdfBytes) / brdfBytes;
+            evict();
+        }
+        reconstructor.reconstructBatch(gridNodes, coords);
+        measureCellErrors();
+    }
+
+    template<typename Scalar, int Dim>
+    void ReconstructionCache<Scalar, Dim>::measureCellErrors() {
+        const unsigned int latentDim(reconstructor.getLatentDim());
+        long nbCells(1);
+        for (unsigned int c = 0; c < latentDim; ++c) {
+            nbCells *= gridResolution - 1;
+        }
+
+        Matrix<Scalar> centers(latentDim, nbCells);
+        for (long cell = 0; cell < nbCells; ++cell) {
+            long rest(cell);
+            for (unsigned int c = 0; c < latentDim; ++c) {
+                centers(c, cell) = gridLower[c] + (Scalar(rest % (gridResolution - 1)) + Scalar(0.5)) * gridStep[c];
+                rest /= gridResolution - 1;
+            }
+        }
+
+        cellErrors.assign(nbCells, Scalar(0));
+        std::vector<std::vector<long>> nodes(centerBatchSize);
+        std::vector<std::vector<Scalar>> weights(centerBatchSize);
+        for (long first = 0; first < nbCells; first += centerBatchSize) {
+            const long size(std::min(centerBatchSize, nbCells - first));
+            for (long p = 0; p < size; ++p) {
+                locate(centers.col(first + p), nodes[p], weights[p]);
+            }
+            reconstructor.reconstructBatchBlocks(centers.middleCols(first, size),
+                    [&](const long firstCoefficient, const Matrix<Scalar> &block) {
+                        RowVector<Scalar> interpolated;
+                        for (long p = 0; p < size; ++p) {
+                            interpolated = weights[p][0] * gridNodes.row(nodes[p][0]).segment(firstCoefficient, block.cols());
+                            for (unsigned int k = 1; k < nodes[p].size(); ++k) {
+                                interpolated += weights[p][k] * gridNodes.row(nodes[p][k]).segment(firstCoefficient, block.cols());
+                            }
+                            cellErrors[first + p] += (block.row(p) - interpolated).squaredNorm();
+                        }
+                    });
+        }
+        for (Scalar &error : cellErrors) {
+            error /= Scalar(reconstructor.getBRDFCoeffNb());
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    long ReconstructionCache<Scalar, Dim>::locate(
+            const Vector<Scalar> &coord,
+            std::vector<long> &nodes,
+            std::vector<Scalar> &weights) const {
+        const unsigned int latentDim(reconstructor.getLatentDim());
+        std::vector<long> lowerNode(latentDim);
+        std::vector<Scalar> fractions(latentDim);
+        long cell(0), base(0), cellStride(1), nodeStride(1);
+        for (unsigned int c = 0; c < latentDim; ++c) {
+            const Scalar t((coord[c] - gridLower[c]) / gridStep[c]);
+            if (t < Scalar(0) || t > Scalar(gridResolution - 1)) {
+                return -1;
+            }
+            // The highest nodes belong to the last cell
+            lowerNode[c] = std::min(long(std::floor(double(t))), long(gridResolution) - 2);
+            fractions[c] = t - Scalar(lowerNode[c]);
+            cell += lowerNode[c] * cellStride;
+            base += lowerNode[c] * nodeStride;
+            cellStride *= gridResolution - 1;
+            nodeStride *= gridResolution;
+        }
+
+        // One corner per subset of the axes along which the upper node is taken
+        const long nbCorners(1L << latentDim);
+        nodes.resize(nbCorners);
+        weights.resize(nbCorners);
+        for (long corner = 0; corner < nbCorners; ++corner) {
+            long node(base), stride(1);
+            Scalar weight(1);
+            for (unsigned int c = 0; c < latentDim; ++c) {
+                if (corner & (1L << c)) {
+                    node += stride;
+                    weight *= fractions[c];
+                } else {
+                    weight *= Scalar(1) - fractions[c];
+                }
+                stride *= gridResolution;
+            }
+            nodes[corner] = node;
+            weights[corner] = weight;
+        }
+        return cell;
+    }
+
+    template<typename Scalar, int Dim>
+    void ReconstructionCache<Scalar, Dim>::evict() {
+        while (entries.size() > capacity) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    template<typename Scalar, int Dim>
+    void ReconstructionCache<Scalar, Dim>::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        index.clear();
+        entries.clear();
+    }
+
+    template<typename Scalar, int Dim>
+    std::size_t ReconstructionCache<Scalar, Dim>::getSize() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+}
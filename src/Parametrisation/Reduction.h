@@ -0,0 +1,45 @@
+#ifndef REDUCTION__H
+#define REDUCTION__H
+
+/**
+ * @file Reduction.h
+ * @brief Parallel sums whose result does not depend on the number of threads
+ */
+
+#include <vector>
+
+namespace ChefDevr
+{
+    /**
+     * @brief Sums values pairwise in a fixed tree order
+     * @tparam T Type of the values (must provide operator+=)
+     * @param values The values to sum (overwritten by partial sums)
+     * @param zero Neutral element returned for an empty vector
+     * @return The sum of the values
+     */
+    template <typename T>
+    T pairwiseSum (std::vector<T>& values, const T& zero);
+    
+    /**
+     * @brief Computes the sum of nbTerms terms in parallel, in an order that does not depend on the number of threads
+     * @tparam T Type of the terms (must provide operator+=)
+     * @tparam Term Type of the function that computes a term
+     * @param nbTerms Number of terms
+     * @param term Function that returns the term of index i (called concurrently)
+     * @param zero Neutral element of the sum
+     * @param blockSize Number of consecutive terms summed sequentially by one thread
+     * @return The sum of the terms
+     *
+     * The terms are summed sequentially by blocks of blockSize consecutive terms,
+     * the blocks being distributed among the threads.
+     * The partial sums of the blocks are then added with pairwiseSum.
+     * The result is therefore the same for any number of threads.
+     */
+    template <typename T, typename Term>
+    T deterministicSum (long nbTerms, const Term& term, const T& zero, long blockSize = 64);
+    
+} // namespace ChefDevr
+
+#include "Reduction.hpp"
+
+#endif // REDUCTION__H
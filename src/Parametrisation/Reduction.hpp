@@ -0,0 +1,49 @@
+#include "Reduction.h"
+
+/**
+ * @file Reduction.hpp
+ */
+
+#include <algorithm>
+
+namespace ChefDevr
+{
+    template <typename T>
+    T pairwiseSum (std::vector<T>& values, const T& zero)
+    {
+        const std::size_t n(values.size());
+        if (n == 0)
+        {
+            return zero;
+        }
+        for (std::size_t stride(1); stride < n; stride *= 2)
+        {
+            for (std::size_t i(0); i + stride < n; i += 2*stride)
+            {
+                values[i] += values[i + stride];
+            }
+        }
+        return values[0];
+    }
+    
+    template <typename T, typename Term>
+    T deterministicSum (const long nbTerms, const Term& term, const T& zero, const long blockSize)
+    {
+        const long size(std::max(blockSize, 1L));
+        const long nbBlocks((nbTerms + size - 1) / size);
+        std::vector<T> partials(std::max(nbBlocks, 0L), zero);
+        
+        # pragma omp parallel for schedule(dynamic) if(nbBlocks > 1)
+        for (long block = 0; block < nbBlocks; ++block)
+        {
+            const long end(std::min((block + 1) * size, nbTerms));
+            T sum(zero);
+            for (long i = block * size; i < end; ++i)
+            {
+                sum += term(i);
+            }
+            partials[block] = sum;
+        }
+        return pairwiseSum(partials, zero);
+    }
+} // namespace ChefDevr
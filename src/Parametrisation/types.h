@@ -33,6 +33,21 @@ namespace ChefDevr
     /** @tparam Scalar Type used for the scalar numbers stored */
     template<typename Scalar>
     using RowVector = Eigen::Matrix<Scalar, 1, Eigen::Dynamic>;
+    
+    /**
+     * @tparam Scalar Type used for the scalar numbers stored
+     * @tparam Dim Dimension of the latent space, Eigen::Dynamic if only known at run time
+     */
+    template<typename Scalar, int Dim = Eigen::Dynamic>
+    using LatentVector = Eigen::Matrix<Scalar, Dim, 1>;
+    
+    /**
+     * @brief Latent variables stored as a structure of arrays : one column (contiguous array) per coordinate
+     * @tparam Scalar Type used for the scalar numbers stored
+     * @tparam Dim Dimension of the latent space, Eigen::Dynamic if only known at run time
+     */
+    template<typename Scalar, int Dim = Eigen::Dynamic>
+    using LatentMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Dim>;
 } // namespace ChefDevr
 
 #endif //TYPES__H
@@ -0,0 +1,118 @@
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+/**
+ * @file Protocol.h
+ * @brief Binary protocol of the reconstruction service
+ *
+ * A client sends requests on a stream socket, each one a RequestHeader followed by its payload,
+ * and receives for each a ResponseHeader followed by its payload, in the order of the requests.
+ * The values are in the byte order of the machine (the socket is local) and the coordinates
+ * and results are doubles :
+ *
+ * <table>
+ * <tr><th>Request <th>Request payload <th>Response payload
+ * <tr><td>Info <td>none <td>ModelInfo
+ * <tr><td>Reconstruct <td>latentDim coordinates <td>nbCoefficients values of the BRDF
+ * <tr><td>PointQuery <td>latentDim coordinates, then (theta_in, phi_in, theta_out, phi_out) per pair of directions
+ *     <td>(red, green, blue) per pair of directions (see BRDFReconstructor::lookupBRDFValues)
+ * <tr><td>Albedo <td>number of sampled phi angles (uint32), then latentDim coordinates <td>red, green, blue
+ * <tr><td>Errors <td>none <td>(whole BRDF, red, green, blue) mean square errors per BRDF
+ *     (see BRDFReconstructor::reconstructionErrors)
+ * <tr><td>Shutdown <td>none <td>none
+ * </table>
+ *
+ * A response whose status is not Ok holds an error message.
+ */
+
+#include <cstdint>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief Identifies the messages of the protocol ("BRDF")
+     */
+    constexpr std::uint32_t protocolMagic = 0x46445242;
+
+    /**
+     * @brief Maximum size of a request payload in bytes
+     */
+    constexpr std::uint32_t maxRequestPayload = 1 << 24;
+
+    /**
+     * @brief Kinds of requests
+     */
+    enum class RequestType : std::uint8_t
+    {
+        Info = 0,
+        Reconstruct = 1,
+        PointQuery = 2,
+        Albedo = 3,
+        Errors = 4,
+        Shutdown = 5
+    };
+
+    /**
+     * @brief Outcome of a request
+     */
+    enum class ResponseStatus : std::uint8_t
+    {
+        Ok = 0,
+        /** @brief The request is malformed or not supported by the model */
+        BadRequest = 1,
+        /** @brief The request failed on the server */
+        Failure = 2
+    };
+
+    /**
+     * @brief Header of a request
+     */
+    struct RequestHeader
+    {
+        /** @brief protocolMagic */
+        std::uint32_t magic;
+        /** @brief RequestType */
+        std::uint8_t type;
+        std::uint8_t reserved[3];
+        /** @brief Identifier of the request, copied in the response */
+        std::uint32_t id;
+        /** @brief Size of the payload in bytes */
+        std::uint32_t payloadSize;
+    };
+
+    /**
+     * @brief Header of a response
+     */
+    struct ResponseHeader
+    {
+        /** @brief protocolMagic */
+        std::uint32_t magic;
+        /** @brief RequestType of the request */
+        std::uint8_t type;
+        /** @brief ResponseStatus */
+        std::uint8_t status;
+        std::uint8_t reserved[2];
+        /** @brief Identifier of the request */
+        std::uint32_t id;
+        std::uint32_t reserved2;
+        /** @brief Size of the payload in bytes */
+        std::uint64_t payloadSize;
+    };
+
+    /**
+     * @brief Payload of the response to an Info request
+     */
+    struct ModelInfo
+    {
+        /** @brief Dimension of the latent space */
+        std::uint32_t latentDim;
+        /** @brief Number of BRDFs of the parametrisation */
+        std::uint32_t nbBRDFs;
+        /** @brief Number of coefficients of a BRDF */
+        std::uint64_t nbCoefficients;
+    };
+
+}
+
+#endif // PROTOCOL_H_
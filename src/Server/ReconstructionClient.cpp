@@ -0,0 +1,106 @@
+#include "ReconstructionClient.h"
+
+#include <cstring>
+
+
+namespace ChefDevr {
+
+    ReconstructionClient::ReconstructionClient(const std::string &socketPath) :
+            socket(UnixSocket::connect(socketPath)),
+            nextId(0) {}
+
+    void ReconstructionClient::request(
+            const RequestType type,
+            const void *payload,
+            const std::size_t size,
+            std::vector<char> &response) {
+        RequestHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = protocolMagic;
+        header.type = std::uint8_t(type);
+        header.id = nextId++;
+        header.payloadSize = std::uint32_t(size);
+        socket.writeAll(&header, sizeof(header));
+        if (size > 0) {
+            socket.writeAll(payload, size);
+        }
+
+        ResponseHeader answer;
+        if (!socket.readAll(&answer, sizeof(answer))) {
+            throw ClientError{"The service closed the connection"};
+        }
+        if (answer.magic != protocolMagic || answer.id != header.id) {
+            throw ClientError{"The response does not match the request"};
+        }
+        response.resize(answer.payloadSize);
+        if (answer.payloadSize > 0 && !socket.readAll(response.data(), response.size())) {
+            throw ClientError{"The service closed the connection"};
+        }
+        if (ResponseStatus(answer.status) != ResponseStatus::Ok) {
+            throw ClientError{std::string(response.begin(), response.end())};
+        }
+    }
+
+    ModelInfo ReconstructionClient::info() {
+        std::vector<char> response;
+        request(RequestType::Info, nullptr, 0, response);
+        if (response.size() != sizeof(ModelInfo)) {
+            throw ClientError{"Malformed model description"};
+        }
+        ModelInfo info;
+        std::memcpy(&info, response.data(), sizeof(info));
+        return info;
+    }
+
+    void ReconstructionClient::reconstruct(std::vector<double> &brdf, const std::vector<double> &coord) {
+        std::vector<char> response;
+        request(RequestType::Reconstruct, coord.data(), coord.size() * sizeof(double), response);
+        brdf.resize(response.size() / sizeof(double));
+        std::memcpy(brdf.data(), response.data(), brdf.size() * sizeof(double));
+    }
+
+    void ReconstructionClient::lookup(
+            std::vector<double> &colors,
+            const std::vector<double> &coord,
+            const std::vector<double> &directions) {
+        std::vector<double> payload(coord);
+        payload.insert(payload.end(), directions.begin(), directions.end());
+        std::vector<char> response;
+        request(RequestType::PointQuery, payload.data(), payload.size() * sizeof(double), response);
+        colors.resize(response.size() / sizeof(double));
+        std::memcpy(colors.data(), response.data(), colors.size() * sizeof(double));
+    }
+
+    void ReconstructionClient::albedo(
+            double &r, double &g, double &b,
+            const std::vector<double> &coord,
+            const unsigned int sampling) {
+        const std::uint32_t nbAngles(sampling);
+        std::vector<char> payload(sizeof(nbAngles) + coord.size() * sizeof(double));
+        std::memcpy(payload.data(), &nbAngles, sizeof(nbAngles));
+        std::memcpy(payload.data() + sizeof(nbAngles), coord.data(), coord.size() * sizeof(double));
+        std::vector<char> response;
+        request(RequestType::Albedo, payload.data(), payload.size(), response);
+        if (response.size() != 3 * sizeof(double)) {
+            throw ClientError{"Malformed albedo"};
+        }
+        double rgb[3];
+        std::memcpy(rgb, response.data(), sizeof(rgb));
+        r = rgb[0];
+        g = rgb[1];
+        b = rgb[2];
+    }
+
+    void ReconstructionClient::reconstructionErrors(std::vector<double> &errors) {
+        std::vector<char> response;
+        request(RequestType::Errors, nullptr, 0, response);
+        errors.resize(response.size() / sizeof(double));
+        std::memcpy(errors.data(), response.data(), errors.size() * sizeof(double));
+    }
+
+    void ReconstructionClient::shutdown() {
+        std::vector<char> response;
+        request(RequestType::Shutdown, nullptr, 0, response);
+    }
+
+}
@@ -0,0 +1,101 @@
+#ifndef RECONSTRUCTION_CLIENT_H_
+#define RECONSTRUCTION_CLIENT_H_
+
+/**
+ * @file ReconstructionClient.h
+ * @brief Client of the reconstruction service
+ */
+
+#include "Protocol.h"
+#include "UnixSocket.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief Connection to a reconstruction service (see ReconstructionServer), one request at a time
+     */
+    class ReconstructionClient {
+    public:
+        /**
+         * @brief Connects to the service
+         * @param socketPath Path of the socket file of the service
+         */
+        explicit ReconstructionClient(const std::string &socketPath);
+
+        /**
+         * @return The description of the model of the service
+         */
+        ModelInfo info();
+
+        /**
+         * @brief Reconstructs a BRDF
+         * @param brdf The nbCoefficients values to fill
+         * @param coord Coordinates of the latent space point
+         */
+        void reconstruct(std::vector<double> &brdf, const std::vector<double> &coord);
+
+        /**
+         * @brief Evaluates the BRDF of a latent space point for pairs of directions
+         * @param colors The red, green and blue values to fill, 3 per pair of directions
+         * @param coord Coordinates of the latent space point
+         * @param directions (theta_in, phi_in, theta_out, phi_out) per pair of directions
+         */
+        void lookup(std::vector<double> &colors, const std::vector<double> &coord, const std::vector<double> &directions);
+
+        /**
+         * @brief Computes the albedo of the BRDF of a latent space point
+         * @param r The red albedo to fill
+         * @param g The green albedo to fill
+         * @param b The blue albedo to fill
+         * @param coord Coordinates of the latent space point
+         * @param sampling Number of sampled phi angles
+         */
+        void albedo(double &r, double &g, double &b, const std::vector<double> &coord, unsigned int sampling);
+
+        /**
+         * @brief Gets the reconstruction errors of the BRDFs of the model
+         * @param errors The (whole BRDF, red, green, blue) mean square errors to fill, 4 per BRDF
+         */
+        void reconstructionErrors(std::vector<double> &errors);
+
+        /**
+         * @brief Asks the service to stop
+         */
+        void shutdown();
+
+        class ClientError : public std::runtime_error {
+        public:
+            explicit ClientError(const std::string &msg) :
+                    std::runtime_error(msg) {}
+        };
+
+    private:
+        /**
+         * @brief Sends a request and receives its response
+         * @param type The kind of request
+         * @param payload The payload of the request
+         * @param size Size of the payload in bytes
+         * @param response The payload of the response to fill
+         * @throw ClientError if the service did not answer Ok
+         */
+        void request(RequestType type, const void *payload, std::size_t size, std::vector<char> &response);
+
+        /**
+         * @brief The connection
+         */
+        UnixSocket socket;
+
+        /**
+         * @brief Identifier of the next request
+         */
+        std::uint32_t nextId;
+    };
+
+}
+
+#endif // RECONSTRUCTION_CLIENT_H_
@@ -0,0 +1,218 @@
+#ifndef RECONSTRUCTION_SERVER__H
+#define RECONSTRUCTION_SERVER__H
+
+/**
+ * @file ReconstructionServer.h
+ * @brief Serves the reconstructions of a parametrisation over a Unix domain socket
+ */
+
+#include "Parametrisation/Parametrisation.h"
+#include "Protocol.h"
+#include "UnixSocket.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief Long running service answering the requests of the protocol (see Protocol.h) with a reconstructor
+     * @tparam Scalar The type of the values used to reconstruct a BRDF
+     * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+     *
+     * Each connection is served by its own thread. The requests that need whole BRDFs (Reconstruct and Albedo)
+     * are queued and reconstructed together by a single batching thread : the concurrent requests share
+     * each pass over the reconstruction matrix (see BRDFReconstructor::reconstructBatchBlocks).
+     * Point queries only read a few coefficients and are answered by the thread of the connection.
+     * The reconstruction errors are computed at the first request and kept.
+     */
+    template <typename Scalar, int Dim = Eigen::Dynamic>
+    class ReconstructionServer
+    {
+    public:
+        /**
+         * @brief Constructor of the class
+         * @param _reconstructor The reconstructor of the BRDFs, must outlive the server
+         * @param _maxBatchSize Maximum number of BRDFs reconstructed together
+         * @param _batchDelay Time the batching thread waits for other requests before reconstructing
+         * a batch that is not full
+         */
+        ReconstructionServer (
+            const BRDFReconstructor<Scalar, Dim>& _reconstructor,
+            unsigned int _maxBatchSize = 8,
+            std::chrono::microseconds _batchDelay = std::chrono::microseconds(500));
+
+        /**
+         * @brief Serves the requests until a stop is requested
+         * @param socketPath Path of the socket file (removed when the server stops)
+         *
+         * The requests already received are answered before returning
+         */
+        void run (const std::string& socketPath);
+
+        /**
+         * @brief Requests the server to stop, can be called from any thread
+         */
+        inline void requestStop() { stopRequested = true; }
+
+        /**
+         * @return The number of batches reconstructed
+         */
+        inline unsigned long getBatches() const { return batches; }
+
+        /**
+         * @return The number of requests answered by the batches
+         */
+        inline unsigned long getBatchedRequests() const { return batchedRequests; }
+
+    private:
+        /**
+         * @brief Request waiting for the batching thread
+         */
+        struct Job
+        {
+            /** @brief Coordinates of the latent space point */
+            Vector<Scalar> coord;
+            /** @brief True for an albedo, false for the whole BRDF */
+            bool albedo;
+            /** @brief Number of sampled phi angles of the albedo */
+            unsigned int sampling;
+            /** @brief The reconstructed BRDF, or the red, green and blue albedo */
+            std::vector<double> values;
+            /** @brief Fulfilled when the values are computed */
+            std::promise<void> done;
+        };
+
+        /**
+         * @brief Serves the requests of a connection until it is closed or a stop is requested
+         * @param client The socket of the connection
+         */
+        void serveClient (UnixSocket client);
+
+        /**
+         * @brief Answers a request
+         * @param client The socket of the connection
+         * @param header The header of the request
+         * @param payload The payload of the request
+         */
+        void answer (const UnixSocket& client, const RequestHeader& header, const std::vector<char>& payload);
+
+        /**
+         * @brief Sends a response
+         * @param client The socket of the connection
+         * @param request The header of the request
+         * @param status The outcome of the request
+         * @param data The payload of the response
+         * @param size Size of the payload in bytes
+         */
+        static void respond (
+            const UnixSocket& client,
+            const RequestHeader& request,
+            ResponseStatus status,
+            const void* data,
+            std::size_t size);
+
+        /**
+         * @brief Queues a job and waits until the batching thread computed it
+         * @param job The job
+         */
+        void submit (Job& job);
+
+        /**
+         * @brief Reconstructs the queued jobs by batches until a stop is requested and the queue is empty
+         */
+        void batchLoop ();
+
+        /**
+         * @brief Reconstructs a batch of jobs together
+         * @param jobs The jobs
+         */
+        void processBatch (const std::vector<Job*>& jobs);
+
+        /**
+         * @brief Reads the latent coordinates at the beginning of a payload
+         * @param coord The coordinates to fill
+         * @param payload The payload of the request
+         * @param offset Offset of the coordinates in the payload in bytes
+         * @return False if the payload is too short
+         */
+        bool readCoordinates (Vector<Scalar>& coord, const std::vector<char>& payload, std::size_t offset) const;
+
+        /**
+         * @brief Time between two checks of the stop request by the waiting threads (milliseconds)
+         */
+        static constexpr int pollInterval = 100;
+
+        /**
+         * @brief Reconstructor of the BRDFs
+         */
+        const BRDFReconstructor<Scalar, Dim>& reconstructor;
+
+        /**
+         * @brief Maximum number of BRDFs reconstructed together
+         */
+        const unsigned int maxBatchSize;
+
+        /**
+         * @brief Time the batching thread waits for other requests
+         */
+        const std::chrono::microseconds batchDelay;
+
+        /**
+         * @brief Set to stop the server
+         */
+        std::atomic<bool> stopRequested;
+
+        /**
+         * @brief Jobs waiting for the batching thread
+         */
+        std::deque<Job*> queue;
+
+        /**
+         * @brief Protects the queue and the number of connections
+         */
+        std::mutex mutex;
+
+        /**
+         * @brief Signals the queued jobs and the end of the connections
+         */
+        std::condition_variable condition;
+
+        /**
+         * @brief Number of connections being served
+         */
+        unsigned int nbClients;
+
+        /**
+         * @brief Reconstruction errors of the BRDFs (one row per BRDF), empty until requested
+         */
+        std::vector<double> errors;
+
+        /**
+         * @brief Protects the reconstruction errors
+         */
+        std::mutex errorsMutex;
+
+        /**
+         * @brief Number of batches reconstructed
+         */
+        std::atomic<unsigned long> batches;
+
+        /**
+         * @brief Number of requests answered by the batches
+         */
+        std::atomic<unsigned long> batchedRequests;
+    };
+
+} // ChefDevr
+
+#include "ReconstructionServer.hpp"
+
+#endif // RECONSTRUCTION_SERVER__H
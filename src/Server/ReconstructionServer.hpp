@@ -0,0 +1,369 @@
+#include "Optimisation/Albedo.h"
+#include "Parametrisation/MERLReader.h"
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+#include <unistd.h>
+
+/**
+ * @file ReconstructionServer.hpp
+ */
+
+namespace ChefDevr
+{
+    template <typename Scalar, int Dim>
+    constexpr int ReconstructionServer<Scalar, Dim>::pollInterval;
+
+    template <typename Scalar, int Dim>
+    ReconstructionServer<Scalar, Dim>::ReconstructionServer (
+        const BRDFReconstructor<Scalar, Dim>& _reconstructor,
+        const unsigned int _maxBatchSize,
+        const std::chrono::microseconds _batchDelay):
+        reconstructor(_reconstructor),
+        maxBatchSize(std::max(_maxBatchSize, 1u)),
+        batchDelay(_batchDelay),
+        stopRequested(false),
+        nbClients(0),
+        batches(0),
+        batchedRequests(0){}
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::run (const std::string& socketPath)
+    {
+        const UnixSocket listener(UnixSocket::listen(socketPath));
+        std::thread batcher(&ReconstructionServer::batchLoop, this);
+
+        while (!stopRequested)
+        {
+            if (!listener.waitReadable(pollInterval))
+            {
+                continue;
+            }
+            try
+            {
+                UnixSocket client(listener.accept());
+                std::lock_guard<std::mutex> lock(mutex);
+                ++nbClients;
+                std::thread(&ReconstructionServer::serveClient, this, std::move(client)).detach();
+            }
+            catch (const UnixSocket::SocketError& error)
+            {
+                std::cerr << error.what() << std::endl;
+            }
+        }
+
+        // The connections see the stop request at their next poll, the batching thread empties its queue
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.notify_all();
+            condition.wait(lock, [this] { return nbClients == 0; });
+        }
+        batcher.join();
+        unlink(socketPath.c_str());
+    }
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::serveClient (UnixSocket client)
+    {
+        try
+        {
+            RequestHeader header;
+            std::vector<char> payload;
+            while (!stopRequested)
+            {
+                if (!client.waitReadable(pollInterval))
+                {
+                    continue;
+                }
+                if (!client.readAll(&header, sizeof(header)))
+                {
+                    break;
+                }
+                if (header.magic != protocolMagic || header.payloadSize > maxRequestPayload)
+                {
+                    // The stream cannot be resynchronised
+                    const std::string message("Malformed request header");
+                    respond(client, header, ResponseStatus::BadRequest, message.data(), message.size());
+                    break;
+                }
+                payload.resize(header.payloadSize);
+                if (header.payloadSize > 0 && !client.readAll(payload.data(), payload.size()))
+                {
+                    break;
+                }
+                answer(client, header, payload);
+            }
+        }
+        catch (const std::exception& error)
+        {
+            std::cerr << "Connection closed : " << error.what() << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        --nbClients;
+        condition.notify_all();
+    }
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::answer (
+        const UnixSocket& client,
+        const RequestHeader& header,
+        const std::vector<char>& payload)
+    {
+        const unsigned int latentDim(reconstructor.getLatentDim());
+        const long nbCoefficients(reconstructor.getBRDFCoeffNb());
+        const bool merl(nbCoefficients == long(MERLReader::num_coefficientsBRDF));
+        std::string message;
+        Vector<Scalar> coord;
+
+        try
+        {
+            switch (RequestType(header.type))
+            {
+                case RequestType::Info:
+                {
+                    ModelInfo info;
+                    info.latentDim = latentDim;
+                    info.nbBRDFs = reconstructor.getNbBRDFs();
+                    info.nbCoefficients = nbCoefficients;
+                    respond(client, header, ResponseStatus::Ok, &info, sizeof(info));
+                    return;
+                }
+                case RequestType::Reconstruct:
+                case RequestType::Albedo:
+                {
+                    Job job;
+                    job.albedo = RequestType(header.type) == RequestType::Albedo;
+                    job.sampling = 0;
+                    if (job.albedo && payload.size() >= sizeof(std::uint32_t))
+                    {
+                        std::uint32_t sampling;
+                        std::memcpy(&sampling, payload.data(), sizeof(sampling));
+                        job.sampling = sampling;
+                    }
+                    const std::size_t offset(job.albedo ? sizeof(std::uint32_t) : 0);
+                    if (!readCoordinates(job.coord, payload, offset) ||
+                        payload.size() != offset + latentDim * sizeof(double))
+                    {
+                        message = "The request must hold the coordinates of a latent space point";
+                        break;
+                    }
+                    if (job.albedo && (!merl || job.sampling == 0))
+                    {
+                        message = "The albedo needs MERL BRDFs and a positive number of sampled angles";
+                        break;
+                    }
+                    submit(job);
+                    respond(client, header, ResponseStatus::Ok, job.values.data(), job.values.size() * sizeof(double));
+                    return;
+                }
+                case RequestType::PointQuery:
+                {
+                    const std::size_t directionsBytes(payload.size() - std::min(payload.size(), latentDim * sizeof(double)));
+                    if (!readCoordinates(coord, payload, 0) || directionsBytes % (4 * sizeof(double)) != 0)
+                    {
+                        message = "The request must hold the coordinates of a latent space point and pairs of directions";
+                        break;
+                    }
+                    if (!merl)
+                    {
+                        message = "Point queries need MERL BRDFs";
+                        break;
+                    }
+                    const long nbDirections(directionsBytes / (4 * sizeof(double)));
+                    Eigen::Matrix<double, Eigen::Dynamic, 4, Eigen::RowMajor> directions(nbDirections, 4);
+                    std::memcpy(directions.data(), payload.data() + latentDim * sizeof(double), directionsBytes);
+                    Matrix<double> colors;
+                    reconstructor.lookupBRDFValues(colors, coord, directions);
+                    const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> rows(colors);
+                    respond(client, header, ResponseStatus::Ok, rows.data(), rows.size() * sizeof(double));
+                    return;
+                }
+                case RequestType::Errors:
+                {
+                    std::lock_guard<std::mutex> lock(errorsMutex);
+                    if (errors.empty())
+                    {
+                        Matrix<Scalar> brdfErrors;
+                        reconstructor.reconstructionErrors(brdfErrors);
+                        const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> rows(brdfErrors.template cast<double>());
+                        errors.assign(rows.data(), rows.data() + rows.size());
+                    }
+                    respond(client, header, ResponseStatus::Ok, errors.data(), errors.size() * sizeof(double));
+                    return;
+                }
+                case RequestType::Shutdown:
+                    requestStop();
+                    respond(client, header, ResponseStatus::Ok, nullptr, 0);
+                    return;
+                default:
+                    message = "Unknown request type";
+            }
+        }
+        catch (const UnixSocket::SocketError&)
+        {
+            throw;
+        }
+        catch (const std::exception& error)
+        {
+            message = error.what();
+            respond(client, header, ResponseStatus::Failure, message.data(), message.size());
+            return;
+        }
+        respond(client, header, ResponseStatus::BadRequest, message.data(), message.size());
+    }
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::respond (
+        const UnixSocket& client,
+        const RequestHeader& request,
+        const ResponseStatus status,
+        const void* data,
+        const std::size_t size)
+    {
+        ResponseHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = protocolMagic;
+        header.type = request.type;
+        header.status = std::uint8_t(status);
+        header.id = request.id;
+        header.payloadSize = size;
+        client.writeAll(&header, sizeof(header));
+        if (size > 0)
+        {
+            client.writeAll(data, size);
+        }
+    }
+
+    template <typename Scalar, int Dim>
+    bool ReconstructionServer<Scalar, Dim>::readCoordinates (
+        Vector<Scalar>& coord,
+        const std::vector<char>& payload,
+        const std::size_t offset) const
+    {
+        const unsigned int latentDim(reconstructor.getLatentDim());
+        if (payload.size() < offset + latentDim * sizeof(double))
+        {
+            return false;
+        }
+        std::vector<double> values(latentDim);
+        std::memcpy(values.data(), payload.data() + offset, latentDim * sizeof(double));
+        coord.resize(latentDim);
+        for (unsigned int c(0); c < latentDim; ++c)
+        {
+            coord[c] = Scalar(values[c]);
+        }
+        return true;
+    }
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::submit (Job& job)
+    {
+        std::future<void> done(job.done.get_future());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(&job);
+        }
+        condition.notify_all();
+        // Rethrows the exception of the batch, if any
+        done.get();
+    }
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::batchLoop ()
+    {
+        std::vector<Job*> jobs;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait_for(lock, std::chrono::milliseconds(pollInterval),
+                                   [this] { return stopRequested || !queue.empty(); });
+                if (queue.empty())
+                {
+                    if (stopRequested && nbClients == 0)
+                    {
+                        return;
+                    }
+                    continue;
+                }
+                // Lets the concurrent requests join the batch
+                if (queue.size() < maxBatchSize)
+                {
+                    condition.wait_for(lock, batchDelay, [this] { return queue.size() >= maxBatchSize; });
+                }
+                const std::size_t size(std::min<std::size_t>(queue.size(), maxBatchSize));
+                jobs.assign(queue.begin(), queue.begin() + size);
+                queue.erase(queue.begin(), queue.begin() + size);
+            }
+            processBatch(jobs);
+        }
+    }
+
+    template <typename Scalar, int Dim>
+    void ReconstructionServer<Scalar, Dim>::processBatch (const std::vector<Job*>& jobs)
+    {
+        const long nbCoefficients(reconstructor.getBRDFCoeffNb());
+        const long nbJobs(jobs.size());
+        Matrix<Scalar> coords(reconstructor.getLatentDim(), nbJobs);
+        // The albedos need the BRDFs in the computation type
+        std::vector<RowVector<Scalar>> brdfs(nbJobs);
+        for (long p = 0; p < nbJobs; ++p)
+        {
+            coords.col(p) = jobs[p]->coord;
+            if (jobs[p]->albedo)
+            {
+                brdfs[p].resize(nbCoefficients);
+            }
+            else
+            {
+                jobs[p]->values.resize(nbCoefficients);
+            }
+        }
+
+        try
+        {
+            reconstructor.reconstructBatchBlocks(coords, [&](const long first, const Matrix<Scalar>& block)
+            {
+                for (long p = 0; p < nbJobs; ++p)
+                {
+                    if (jobs[p]->albedo)
+                    {
+                        brdfs[p].segment(first, block.cols()) = block.row(p);
+                    }
+                    else
+                    {
+                        Eigen::Map<RowVector<double>>(jobs[p]->values.data() + first, block.cols()) =
+                            block.row(p).template cast<double>();
+                    }
+                }
+            });
+            for (long p = 0; p < nbJobs; ++p)
+            {
+                if (jobs[p]->albedo)
+                {
+                    jobs[p]->values.resize(3);
+                    Albedo::computeAlbedo<Scalar>(brdfs[p], jobs[p]->values[0], jobs[p]->values[1],
+                                                  jobs[p]->values[2], jobs[p]->sampling);
+                }
+            }
+        }
+        catch (...)
+        {
+            for (Job* job : jobs)
+            {
+                job->done.set_exception(std::current_exception());
+            }
+            return;
+        }
+        ++batches;
+        batchedRequests += nbJobs;
+        for (Job* job : jobs)
+        {
+            job->done.set_value();
+        }
+    }
+} // namespace ChefDevr
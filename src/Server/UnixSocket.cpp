@@ -0,0 +1,167 @@
+#include "UnixSocket.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief Fills the address of a socket file
+     * @param address The address to fill
+     * @param path Path of the socket file
+     */
+    static void socketAddress(sockaddr_un &address, const std::string &path) {
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw UnixSocket::SocketError{"The socket path " + path + " is too long"};
+        }
+        std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    }
+
+    /**
+     * @brief Removes the socket file left by a server that is not running anymore
+     * @param address The address of the socket file
+     * @param path Path of the socket file
+     *
+     * Nothing is done if the path does not exist. A path that is not a socket,
+     * or a socket that still accepts connections, is an error.
+     */
+    static void removeStaleSocket(const sockaddr_un &address, const std::string &path) {
+        struct stat status;
+        if (lstat(path.c_str(), &status) < 0) {
+            if (errno == ENOENT) {
+                return;
+            }
+            throw UnixSocket::SocketError{"The path " + path + " could not have been checked : " + std::strerror(errno)};
+        }
+        if (!S_ISSOCK(status.st_mode)) {
+            throw UnixSocket::SocketError{"The path " + path + " exists and is not a socket"};
+        }
+        const int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe < 0) {
+            throw UnixSocket::SocketError{std::string("A socket could not have been created : ") + std::strerror(errno)};
+        }
+        const bool refused = ::connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0 &&
+                             errno == ECONNREFUSED;
+        close(probe);
+        if (!refused) {
+            throw UnixSocket::SocketError{"The socket " + path + " is already in use"};
+        }
+        unlink(path.c_str());
+    }
+
+    UnixSocket UnixSocket::listen(const std::string &path, const int backlog) {
+        sockaddr_un address;
+        socketAddress(address, path);
+        UnixSocket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.isOpen()) {
+            throw SocketError{std::string("A socket could not have been created : ") + std::strerror(errno)};
+        }
+        removeStaleSocket(address, path);
+        if (bind(socket.descriptor, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0 ||
+            ::listen(socket.descriptor, backlog) < 0) {
+            throw SocketError{"The socket " + path + " could not have been bound : " + std::strerror(errno)};
+        }
+        return socket;
+    }
+
+    UnixSocket UnixSocket::connect(const std::string &path) {
+        sockaddr_un address;
+        socketAddress(address, path);
+        UnixSocket socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (!socket.isOpen()) {
+            throw SocketError{std::string("A socket could not have been created : ") + std::strerror(errno)};
+        }
+        if (::connect(socket.descriptor, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0) {
+            throw SocketError{"Could not connect to " + path + " : " + std::strerror(errno)};
+        }
+        return socket;
+    }
+
+    UnixSocket::UnixSocket(const int _descriptor) : descriptor(_descriptor) {}
+
+    UnixSocket::UnixSocket(UnixSocket &&other) : descriptor(other.descriptor) {
+        other.descriptor = -1;
+    }
+
+    UnixSocket &UnixSocket::operator=(UnixSocket &&other) {
+        if (this != &other) {
+            if (isOpen()) {
+                close(descriptor);
+            }
+            descriptor = other.descriptor;
+            other.descriptor = -1;
+        }
+        return *this;
+    }
+
+    UnixSocket::~UnixSocket() {
+        if (isOpen()) {
+            close(descriptor);
+        }
+    }
+
+    UnixSocket UnixSocket::accept() const {
+        const int connection = ::accept(descriptor, nullptr, nullptr);
+        if (connection < 0) {
+            throw SocketError{std::string("A connection could not have been accepted : ") + std::strerror(errno)};
+        }
+        return UnixSocket(connection);
+    }
+
+    bool UnixSocket::waitReadable(const int timeout) const {
+        pollfd request{descriptor, POLLIN, 0};
+        const int ready = poll(&request, 1, timeout);
+        if (ready < 0 && errno != EINTR) {
+            throw SocketError{std::string("Could not wait for the socket : ") + std::strerror(errno)};
+        }
+        return ready > 0;
+    }
+
+    bool UnixSocket::readAll(void *data, const std::size_t size) const {
+        char *bytes = static_cast<char *>(data);
+        std::size_t done = 0;
+        while (done < size) {
+            const ssize_t count = recv(descriptor, bytes + done, size - done, 0);
+            if (count == 0) {
+                if (done == 0) {
+                    return false;
+                }
+                throw SocketError{"The connection has been closed in the middle of a message"};
+            }
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw SocketError{std::string("Could not read from the socket : ") + std::strerror(errno)};
+            }
+            done += std::size_t(count);
+        }
+        return true;
+    }
+
+    void UnixSocket::writeAll(const void *data, const std::size_t size) const {
+        const char *bytes = static_cast<const char *>(data);
+        std::size_t done = 0;
+        while (done < size) {
+            // A closed peer is reported as an error instead of a SIGPIPE
+            const ssize_t count = send(descriptor, bytes + done, size - done, MSG_NOSIGNAL);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw SocketError{std::string("Could not write to the socket : ") + std::strerror(errno)};
+            }
+            done += std::size_t(count);
+        }
+    }
+
+}
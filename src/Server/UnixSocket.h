@@ -0,0 +1,105 @@
+#ifndef UNIX_SOCKET_H_
+#define UNIX_SOCKET_H_
+
+/**
+ * @file UnixSocket.h
+ * @brief Stream sockets of the Unix domain
+ */
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+
+namespace ChefDevr {
+
+    /**
+     * @brief Stream socket bound to a path of the file system, closed when destroyed
+     */
+    class UnixSocket {
+    public:
+        /**
+         * @brief Creates a socket listening on a path
+         * @param path Path of the socket file
+         * @param backlog Maximum number of pending connections
+         * @return The listening socket
+         *
+         * The socket file of a server that has stopped is replaced. Any other existing path is an error.
+         */
+        static UnixSocket listen(const std::string &path, int backlog = 64);
+
+        /**
+         * @brief Connects to a listening socket
+         * @param path Path of the socket file
+         * @return The connected socket
+         */
+        static UnixSocket connect(const std::string &path);
+
+        /**
+         * @brief Takes the ownership of a socket descriptor
+         * @param _descriptor The descriptor (-1 for no socket)
+         */
+        explicit UnixSocket(int _descriptor = -1);
+
+        UnixSocket(UnixSocket &&other);
+
+        UnixSocket &operator=(UnixSocket &&other);
+
+        UnixSocket(const UnixSocket &) = delete;
+
+        UnixSocket &operator=(const UnixSocket &) = delete;
+
+        ~UnixSocket();
+
+        /**
+         * @return True if the object holds a socket
+         */
+        inline bool isOpen() const { return descriptor >= 0; }
+
+        /**
+         * @brief Accepts a connection
+         * @return The socket of the connection
+         * @pre The socket is listening
+         */
+        UnixSocket accept() const;
+
+        /**
+         * @brief Waits until data (or a connection for a listening socket) is available
+         * @param timeout Maximum waiting time in milliseconds
+         * @return True if data is available, false on timeout
+         */
+        bool waitReadable(int timeout) const;
+
+        /**
+         * @brief Reads exactly the given number of bytes
+         * @param data The buffer to fill
+         * @param size Number of bytes to read
+         * @return False if the peer closed the connection before the first byte
+         *
+         * A connection closed in the middle of the bytes is an error
+         */
+        bool readAll(void *data, std::size_t size) const;
+
+        /**
+         * @brief Writes exactly the given number of bytes
+         * @param data The bytes to write
+         * @param size Number of bytes to write
+         */
+        void writeAll(const void *data, std::size_t size) const;
+
+        class SocketError : public std::runtime_error {
+        public:
+            explicit SocketError(const std::string &msg) :
+                    std::runtime_error(msg) {}
+        };
+
+    private:
+        /**
+         * @brief Descriptor of the socket (-1 for no socket)
+         */
+        int descriptor;
+    };
+
+}
+
+#endif // UNIX_SOCKET_H_
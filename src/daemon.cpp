@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <utility>
+
+#include <pthread.h>
+
+#include "Parametrisation/types.h"
+#include "Parametrisation/MERLReader.h"
+#include "Parametrisation/ParametrisationWithZ.h"
+#include "Parametrisation/ParametrisationSmallStorage.h"
+#include "Parametrisation/ParametrisationMapped.h"
+#include "Optimisation/OptiDataReader.h"
+#include "Server/ReconstructionServer.h"
+
+
+#define WRONG_USAGE 1
+#define LOADING_FAILURE 2
+
+
+using namespace ChefDevr;
+using Scalar = long double;
+
+
+static void show_usage(const char *name_program)
+{
+    std::cerr << "Usage: " << name_program << " [<option> [<option> [...]]] " << std::endl
+              << "Loads a parametrisation once and serves its reconstructions on a Unix domain socket\n"
+              << "Options:\n"
+              << "\t-h,--help\t\tShow the usage\n"
+              << "\t-b <BRDFs folder path>\t\tSpecify the path of the BRDF (\"../data\" by default)\n"
+              << "\t-p <parametrisation data path>\t\tSpecify the file written by the parametrisation (\"../paramtrzData\" by default)\n"
+              << "\t-m <model file path>\t\tMap the model file written by brdf3000 --model instead of loading the BRDFs (they are then only read for the reconstruction errors)\n"
+              << "\t-s <socket path>\t\tSpecify the path of the socket (\"/tmp/brdf3000.sock\" by default)\n"
+              << "\t--batch <unsigned int>\t\tSpecify the maximum number of BRDFs reconstructed together (8 by default)\n"
+              << "\t--delay <unsigned int>\t\tSpecify the time in microseconds a batch waits for concurrent requests (500 by default)\n"
+              << "\t--smallRam\t\tKeep the Ram storage low : the reconstruction basis is streamed from ../reconstructionBasis, written first unless it matches the parametrisation" << std::endl;
+}
+
+bool is_number(const std::string& s)
+{
+    return !s.empty() && std::find_if(s.begin(),
+        s.end(), [](char c) { return !std::isdigit(c); }) == s.end();
+}
+
+
+/**
+ * @brief Options of the program read from the command line
+ */
+struct Options
+{
+    bool smallStorage = false;
+    std::string brdfsDir = "../data";
+    std::string paramtrzDataPath = "../paramtrzData";
+    std::string socketPath = "/tmp/brdf3000.sock";
+    std::string modelPath;
+    unsigned int batchSize = 8;
+    unsigned int batchDelay = 500;
+};
+
+/**
+ * @brief Maps a model file with the storage type it was written with
+ * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+ * @param options Options of the program
+ * @return The reconstructor of the model
+ */
+template <int Dim>
+BRDFReconstructor<Scalar, Dim>* mapModel(const Options& options)
+{
+    const ModelHeader header(readModelHeader(options.modelPath));
+    if (header.storageDigits == unsigned(std::numeric_limits<float>::digits)) {
+        return new BRDFReconstructorMapped<Scalar, Dim, float>(options.modelPath, options.brdfsDir);
+    }
+    if (header.storageDigits == unsigned(std::numeric_limits<double>::digits)) {
+        return new BRDFReconstructorMapped<Scalar, Dim, double>(options.modelPath, options.brdfsDir);
+    }
+    return new BRDFReconstructorMapped<Scalar, Dim>(options.modelPath, options.brdfsDir);
+}
+
+/**
+ * @brief Loads the parametrisation and serves its reconstructions until SIGINT or SIGTERM
+ * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+ * @param options Options of the program
+ * @param brdfsFilenames The BRDF files of the parametrisation (empty with a model file)
+ * @param X Latent variables vector (empty with a model file)
+ * @param K_minus1 Inverse mapping matrix (empty with a model file)
+ * @param dim Dimension of the latent space
+ */
+template <int Dim>
+void serve(
+    const Options& options,
+    const std::vector<std::string>& brdfsFilenames,
+    const Vector<Scalar>& X,
+    const ChefDevr::Matrix<Scalar>& K_minus1,
+    unsigned int dim);
+
+int main(int argc, const char *argv[]) {
+
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "-h" || argument == "--help") {
+            show_usage(argv[0]);
+            exit(WRONG_USAGE);
+        } else if (argument == "--smallRam") {
+            options.smallStorage = true;
+        } else if (argument == "-b" || argument == "-p" || argument == "-m" || argument == "-s") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a path after " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "-b" ? options.brdfsDir : argument == "-p" ? options.paramtrzDataPath :
+             argument == "-m" ? options.modelPath : options.socketPath) = argv[++i];
+        } else if (argument == "--batch" || argument == "--delay") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string value(argv[++i]);
+            if (!is_number(value)) {
+                std::cerr << "the argument after " << argument << " must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "--batch" ? options.batchSize : options.batchDelay) = std::stoi(value);
+        } else {
+            std::cerr << argument << " is not a valid argument" << std::endl;
+            show_usage(argv[0]);
+            exit(WRONG_USAGE);
+        }
+    }
+
+    if (options.smallStorage && !options.modelPath.empty()) {
+        std::cerr << "A model file is mapped : it needs neither the BRDFs in Ram nor a reconstruction basis" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+
+    std::vector<std::string> brdfsFilenames;
+    Vector<Scalar> X;
+    ChefDevr::Matrix<Scalar> K_minus1;
+    unsigned int dim;
+    try {
+        if (options.modelPath.empty()) {
+            dim = readParametrisationData<Scalar>(options.paramtrzDataPath, brdfsFilenames, X, K_minus1);
+        } else {
+            dim = readModelHeader(options.modelPath).latentDim;
+        }
+    } catch (const std::runtime_error& error) {
+        std::cerr << error.what() << std::endl;
+        exit(LOADING_FAILURE);
+    }
+
+    // The signals are handled by a dedicated thread : the threads of the server inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    switch (dim) {
+        case 1:
+            serve<1>(options, brdfsFilenames, X, K_minus1, dim);
+            break;
+        case 2:
+            serve<2>(options, brdfsFilenames, X, K_minus1, dim);
+            break;
+        case 3:
+            serve<3>(options, brdfsFilenames, X, K_minus1, dim);
+            break;
+        case 4:
+            serve<4>(options, brdfsFilenames, X, K_minus1, dim);
+            break;
+        default:
+            serve<Eigen::Dynamic>(options, brdfsFilenames, X, K_minus1, dim);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+template <int Dim>
+void serve(
+    const Options& options,
+    const std::vector<std::string>& brdfsFilenames,
+    const Vector<Scalar>& X,
+    const ChefDevr::Matrix<Scalar>& K_minus1,
+    const unsigned int dim)
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
+    std::chrono::duration<double, std::milli> duration{};
+    const std::string basisPath("../reconstructionBasis");
+    long num_brdf(brdfsFilenames.size());
+    std::vector<std::string> brdfFilePaths;
+    for (const auto& filename : brdfsFilenames) {
+        brdfFilePaths.push_back(options.brdfsDir + "/" + filename);
+    }
+
+    BRDFReconstructor<Scalar, Dim> *reconstructor;
+    RowVector<Scalar> meanBRDF;
+    ChefDevr::Matrix<Scalar> Z;
+
+    start = std::chrono::system_clock::now();
+    try {
+        if (!options.modelPath.empty()) {
+            reconstructor = mapModel<Dim>(options);
+            num_brdf = reconstructor->getNbBRDFs();
+        } else if (options.smallStorage) {
+            // The basis written for this parametrisation by a previous run is mapped without reading the BRDFs
+            auto basis = BRDFReconstructorSmallStorage<Scalar, Dim>::mapBasis(basisPath, K_minus1, meanBRDF);
+            if (basis) {
+                std::cout << "Reusing the reconstruction basis " << basisPath << std::endl;
+                reconstructor = new BRDFReconstructorSmallStorage<Scalar, Dim>(K_minus1, X, meanBRDF, dim,
+                                                                               brdfFilePaths, std::move(basis));
+            } else {
+                meanBRDF = RowVector<Scalar>::Zero(MERLReader::num_coefficientsBRDF);
+                for (const auto& path : brdfFilePaths) {
+                    meanBRDF += MERLReader::read_brdf<Scalar>(path.c_str());
+                }
+                meanBRDF /= num_brdf;
+                reconstructor = new BRDFReconstructorSmallStorage<Scalar, Dim>(K_minus1, X, meanBRDF, dim,
+                                                                               brdfFilePaths, basisPath);
+            }
+        } else {
+            Z.resize(num_brdf, MERLReader::num_coefficientsBRDF);
+#pragma omp parallel for
+            for (long i = 0; i < num_brdf; ++i) {
+                Z.row(i) = MERLReader::read_brdf<Scalar>(brdfFilePaths[i].c_str());
+            }
+            centerMat(Z, meanBRDF);
+            reconstructor = new BRDFReconstructorWithZ<Scalar, Dim>(Z, K_minus1, X, meanBRDF, dim);
+        }
+    } catch (const std::exception& error) {
+        std::cerr << "The model could not have been loaded : " << error.what() << std::endl;
+        exit(LOADING_FAILURE);
+    }
+    end = std::chrono::system_clock::now();
+    duration = end - start;
+    std::cout << "Loading the model of " << num_brdf << " BRDFs took " << duration.count() * 0.001 << " seconds" << std::endl;
+
+    ReconstructionServer<Scalar, Dim> server(*reconstructor, options.batchSize,
+                                             std::chrono::microseconds(options.batchDelay));
+    std::thread signalHandler([&server]() {
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        int signal;
+        sigwait(&signals, &signal);
+        server.requestStop();
+    });
+    // A Shutdown request stops the server without a signal
+    signalHandler.detach();
+
+    std::cout << "Serving on " << options.socketPath << std::endl;
+    try {
+        server.run(options.socketPath);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        delete reconstructor;
+        exit(LOADING_FAILURE);
+    }
+    std::cout << "Answered " << server.getBatchedRequests() << " reconstructions in "
+              << server.getBatches() << " batches" << std::endl;
+
+    delete reconstructor;
+}
@@ -0,0 +1,228 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Server/ReconstructionClient.h"
+
+
+#define WRONG_USAGE 1
+#define REQUEST_FAILURE 2
+
+
+using namespace ChefDevr;
+
+
+static void show_usage(const char *name_program)
+{
+    std::cerr << "Usage: " << name_program << " [<option> [<option> [...]]] " << std::endl
+              << "Sends concurrent requests to a reconstruction service and reports their latencies\n"
+              << "Options:\n"
+              << "\t-h,--help\t\tShow the usage\n"
+              << "\t-s <socket path>\t\tSpecify the path of the socket (\"/tmp/brdf3000.sock\" by default)\n"
+              << "\t--clients <unsigned int>\t\tSpecify the number of concurrent connections (4 by default)\n"
+              << "\t--requests <unsigned int>\t\tSpecify the number of requests of each connection (16 by default)\n"
+              << "\t--type <reconstruct|point|albedo|mixed>\t\tSpecify the kind of requests (reconstruct by default)\n"
+              << "\t--range <number>\t\tDraw the latent coordinates uniformly in [-range, range] (4 by default)" << std::endl;
+}
+
+bool is_number(const std::string& s)
+{
+    return !s.empty() && std::find_if(s.begin(),
+        s.end(), [](char c) { return !std::isdigit(c); }) == s.end();
+}
+
+bool is_decimal(const std::string& s)
+{
+    char* end(nullptr);
+    std::strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
+
+
+/**
+ * @brief Options of the program read from the command line
+ */
+struct Options
+{
+    std::string socketPath = "/tmp/brdf3000.sock";
+    unsigned int nbClients = 4;
+    unsigned int nbRequests = 16;
+    std::string type = "reconstruct";
+    double range = 4.;
+};
+
+/**
+ * @brief Sends the requests of a connection
+ * @param options Options of the program
+ * @param latentDim Dimension of the latent space
+ * @param seed Seed of the random coordinates
+ * @param latencies The latency of each request to fill (milliseconds)
+ */
+void sendRequests(const Options& options, const unsigned int latentDim, const unsigned int seed, std::vector<double>& latencies)
+{
+    // Pairs of directions of the point queries : (theta_in, phi_in, theta_out, phi_out)
+    const unsigned int nbDirections(64), albedoSampling(16);
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> coordinate(-options.range, options.range);
+    std::uniform_real_distribution<double> theta(0., M_PI / 2.), phi(0., 2. * M_PI);
+
+    ReconstructionClient client(options.socketPath);
+    std::vector<double> coord(latentDim), directions(4 * nbDirections), values;
+    double r, g, b;
+    for (unsigned int i = 0; i < options.nbRequests; ++i) {
+        for (double& c : coord) {
+            c = coordinate(generator);
+        }
+        std::string type(options.type);
+        if (type == "mixed") {
+            const char *types[3] = {"reconstruct", "point", "albedo"};
+            type = types[i % 3];
+        }
+        if (type == "point") {
+            for (unsigned int d = 0; d < nbDirections; ++d) {
+                directions[4 * d] = theta(generator);
+                directions[4 * d + 1] = phi(generator);
+                directions[4 * d + 2] = theta(generator);
+                directions[4 * d + 3] = phi(generator);
+            }
+        }
+
+        const auto start(std::chrono::steady_clock::now());
+        if (type == "reconstruct") {
+            client.reconstruct(values, coord);
+        } else if (type == "point") {
+            client.lookup(values, coord, directions);
+        } else {
+            client.albedo(r, g, b, coord, albedoSampling);
+        }
+        const std::chrono::duration<double, std::milli> duration(std::chrono::steady_clock::now() - start);
+        latencies.push_back(duration.count());
+    }
+}
+
+/**
+ * @param sorted Sorted values
+ * @param p Percentile between 0 and 100
+ * @return The nearest rank percentile of the values
+ */
+double percentile(const std::vector<double>& sorted, const double p)
+{
+    const std::size_t rank(std::size_t(std::ceil(p / 100. * sorted.size())));
+    return sorted[std::min(std::max(rank, std::size_t(1)), sorted.size()) - 1];
+}
+
+int main(int argc, const char *argv[]) {
+
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "-h" || argument == "--help") {
+            show_usage(argv[0]);
+            exit(WRONG_USAGE);
+        } else if (argument == "-s" || argument == "--type") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a value after " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "-s" ? options.socketPath : options.type) = argv[++i];
+            if (argument == "--type" && options.type != "reconstruct" && options.type != "point" &&
+                options.type != "albedo" && options.type != "mixed") {
+                std::cerr << "the argument after --type must be reconstruct, point, albedo or mixed" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+        } else if (argument == "--clients" || argument == "--requests") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string value(argv[++i]);
+            if (!is_number(value) || std::stoi(value) == 0) {
+                std::cerr << "the argument after " << argument << " must be a positive number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "--clients" ? options.nbClients : options.nbRequests) = std::stoi(value);
+        } else if (argument == "--range") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a number after the argument --range" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string range(argv[++i]);
+            if (!is_decimal(range)) {
+                std::cerr << "the argument after --range must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.range = std::strtod(range.c_str(), nullptr);
+        } else {
+            std::cerr << argument << " is not a valid argument" << std::endl;
+            show_usage(argv[0]);
+            exit(WRONG_USAGE);
+        }
+    }
+
+    unsigned int latentDim;
+    try {
+        ReconstructionClient client(options.socketPath);
+        const ModelInfo info(client.info());
+        latentDim = info.latentDim;
+        std::cout << "Model of " << info.nbBRDFs << " BRDFs of " << info.nbCoefficients
+                  << " coefficients in a latent space of dimension " << latentDim << std::endl;
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        exit(REQUEST_FAILURE);
+    }
+
+    std::vector<std::vector<double>> latencies(options.nbClients);
+    std::vector<std::string> failures(options.nbClients);
+    std::vector<std::thread> clients;
+    const auto start(std::chrono::steady_clock::now());
+    for (unsigned int c = 0; c < options.nbClients; ++c) {
+        clients.emplace_back([&, c]() {
+            try {
+                sendRequests(options, latentDim, c + 1, latencies[c]);
+            } catch (const std::exception& error) {
+                failures[c] = error.what();
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    const std::chrono::duration<double> duration(std::chrono::steady_clock::now() - start);
+
+    std::vector<double> all;
+    for (unsigned int c = 0; c < options.nbClients; ++c) {
+        if (!failures[c].empty()) {
+            std::cerr << "Client " << c << " failed : " << failures[c] << std::endl;
+        }
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+    }
+    if (all.empty()) {
+        exit(REQUEST_FAILURE);
+    }
+    std::sort(all.begin(), all.end());
+    double mean(0.);
+    for (const double latency : all) {
+        mean += latency;
+    }
+    mean /= all.size();
+
+    std::cout << all.size() << " " << options.type << " requests from " << options.nbClients << " clients in "
+              << duration.count() << " seconds : " << all.size() / duration.count() << " requests per second" << std::endl;
+    std::cout << "Latency (milliseconds) : mean " << mean << ", p50 " << percentile(all, 50.)
+              << ", p95 " << percentile(all, 95.) << ", p99 " << percentile(all, 99.)
+              << ", max " << all.back() << std::endl;
+    exit(all.size() == std::size_t(options.nbClients) * options.nbRequests ? EXIT_SUCCESS : REQUEST_FAILURE);
+}
@@ -1,11 +1,18 @@
 #include <chrono>
 #include <cstdio>
+#include <cstdlib>
 
 #include "Parametrisation/types.h"
 #include "Parametrisation/ParametrisationWithZ.h"
 #include "Parametrisation/ParametrisationSmallStorage.h"
+#include "Parametrisation/ParametrisationSparse.h"
+#include "Parametrisation/ParametrisationLowRank.h"
+#include "Parametrisation/ModelFile.h"
 #include "BRDFReader/BRDFReader.h"
 #include "Optimisation/OptimisationSolver.h"
+#include "Optimisation/LBFGSOptimisationSolver.h"
+#include "Optimisation/SparseOptimisationSolver.h"
+#include "Optimisation/MultiStartOptimisation.h"
 #include "Optimisation/OptiDataWriter.h"
 #include "Optimisation/Albedo.h"
 
@@ -52,7 +59,26 @@ static void show_usage(const char *name_program)
               << "\t-d <unsigned int>\t\tSpecify the dimention of the result latent space (2 by default)\n"
               << "\t-m <unsigned int>\t\tSpecify the size of the map (200 by default)\n"
               << "\t-b <BRDFs folder path>\t\tSpecify the path of the BRDF (\"../data\" by default)\n"
-              << "\t--smallRam\t\tThe program will keep the Ram storage low but will take longer to execute" << std::endl;
+              << "\t--lbfgs\t\tOptimise with L-BFGS-B instead of Hooke & Jeeves pattern search\n"
+              << "\t--speculative <unsigned int>\t\tSpecify the number of coordinates whose moves are evaluated concurrently (1 by default)\n"
+              << "\t--checkpoint <unsigned int>\t\tWrite a checkpoint of the optimisation every given number of seconds\n"
+              << "\t--checkpointSweeps <unsigned int>\t\tWrite a checkpoint of the optimisation every given number of exploratory moves\n"
+              << "\t--resume\t\tResume the optimisation from the last checkpoint\n"
+              << "\t--tolerance <number>\t\tStop the optimisation when the relative decrease of the cost over the last sweeps is below the given value\n"
+              << "\t--maxSweeps <unsigned int>\t\tStop the optimisation after the given number of sweeps\n"
+              << "\t--timeBudget <unsigned int>\t\tStop the optimisation after the given number of seconds\n"
+              << "\t--adaptiveStep\t\tExpand the step after successful pattern moves and reduce it faster after failed sweeps\n"
+              << "\t--driftCheck <unsigned int>\t\tProbe the numerical drift of the inverse mapping every given number of accepted moves and refactorise it when needed\n"
+              << "\t--activeSet <unsigned int>\t\tKeep the step while the cost decreases and evaluate the stagnant coordinates only every given number of sweeps\n"
+              << "\t--log <CSV file path>\t\tWrite the statistics of each sweep of the optimisation in a CSV file\n"
+              << "\t--progress <unsigned int>\t\tPrint the progress of the optimisation at most every given number of seconds\n"
+              << "\t--starts <unsigned int>\t\tRun the given number of optimisations concurrently from perturbed starting points and keep the best one\n"
+              << "\t--earlyStop <number>\t\tStop a run when its cost exceeds the best cost of the runs at the same step by more than the given relative margin (with --starts)\n"
+              << "\t--sparse <unsigned int>\t\tOptimise a sparse approximation with the given number of inducing points (the BRDFs are streamed, no n x n matrix is built)\n"
+              << "\t--storage <float|double>\t\tStore the reconstruction matrix in the given type instead of the computation type\n"
+              << "\t--model <model file path>\t\tWrite the trained parametrisation in a model file that brdf3000d maps without loading the BRDFs (in the storage type)\n"
+              << "\t--lowRank <number>\t\tReconstruct from a truncated factorisation of the reconstruction matrix whose relative error is below the given value\n"
+              << "\t--smallRam\t\tThe program will keep the Ram storage low but will take longer to execute (the reconstruction basis is written in ../reconstructionBasis)" << std::endl;
 
 }
 
@@ -62,12 +88,55 @@ bool is_number(const std::string& s)
         s.end(), [](char c) { return !std::isdigit(c); }) == s.end();
 }
 
-int main(int argc, const char *argv[]) {
+bool is_decimal(const std::string& s)
+{
+    char* end(nullptr);
+    std::strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0';
+}
 
+
+/**
+ * @brief Options of the program read from the command line
+ */
+struct Options
+{
     bool smallStorage = false;
-    std::string brdfsDir("../data");
+    bool lbfgs = false;
+    std::string brdfsDir = "../data";
     unsigned int dimension = 2;
     unsigned int mapSize = 200;
+    unsigned int speculativeBatch = 1;
+    unsigned int nbInducing = 0;
+    unsigned int nbStarts = 1;
+    double earlyStopMargin = -1.;
+    unsigned int checkpointInterval = 0;
+    unsigned int checkpointSweeps = 0;
+    bool resume = false;
+    double tolerance = 0.;
+    unsigned int maxSweeps = 0;
+    unsigned int timeBudget = 0;
+    bool adaptiveStep = false;
+    unsigned int activeSetPeriod = 0;
+    unsigned int driftInterval = 0;
+    std::string logPath;
+    int progressInterval = -1;
+    std::string storage;
+    double lowRankTolerance = 0.;
+    std::string modelPath;
+};
+
+/**
+ * @brief Computes the parametrisation of the BRDFs and writes its results
+ * @tparam Dim Dimension of the latent space when known at compile time, Eigen::Dynamic otherwise
+ * @param options Options of the program
+ */
+template <int Dim>
+void parametrise(const Options& options);
+
+int main(int argc, const char *argv[]) {
+
+    Options options;
 
     /*if (argc > 2) {
         std::cerr << "Too much arguments" << std::endl;
@@ -94,8 +163,53 @@ int main(int argc, const char *argv[]) {
             show_usage(argv[0]);
             exit(WRONG_USAGE);
         } else if (argument == "--smallRam") {
-            smallStorage = true;
-        } else if (argument == "-d") { // dimension of latent space
+            options.smallStorage = true;
+        } else if (argument == "--lbfgs") {
+            options.lbfgs = true;
+        } else if (argument == "--adaptiveStep") {
+            options.adaptiveStep = true;
+        } else if (argument == "--resume") {
+            options.resume = true;
+        } else if (argument == "--tolerance") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a number after the argument --tolerance" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string tolerance(argv[++i]);
+            if (!is_decimal(tolerance)) {
+                std::cerr << "the argument after --tolerance must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.tolerance = std::strtod(tolerance.c_str(), nullptr);
+        } else if (argument == "--maxSweeps" || argument == "--timeBudget") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string limit(argv[++i]);
+            if (!is_number(limit)) {
+                std::cerr << "the argument after " << argument << " must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "--maxSweeps" ? options.maxSweeps : options.timeBudget) = std::stoi(limit);
+        } else if (argument == "--activeSet" || argument == "--driftCheck") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string period(argv[++i]);
+            if (!is_number(period)) {
+                std::cerr << "the argument after " << argument << " must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "--activeSet" ? options.activeSetPeriod : options.driftInterval) = std::stoi(period);
+        } else if (argument == "-d") { // options.dimension of latent space
             if (argc < i+1) {
                 std::cerr << "You have to specify an unsigned int after the argument -d" << std::endl;
                 show_usage(argv[0]);
@@ -107,7 +221,7 @@ int main(int argc, const char *argv[]) {
                 show_usage(argv[0]);
                 exit(WRONG_USAGE);
             }
-            dimension = std::stoi(latentDim);
+            options.dimension = std::stoi(latentDim);
         } else if (argument == "-m") {
             if (argc < i+1) {
                 std::cerr << "You have to specify an unsigned int after the argument -m" << std::endl;
@@ -120,14 +234,131 @@ int main(int argc, const char *argv[]) {
                 show_usage(argv[0]);
                 exit(WRONG_USAGE);
             }
-            mapSize = std::stoi(mapDim);
+            options.mapSize = std::stoi(mapDim);
         } else if (argument == "-b") {
             if (argc < i+1) {
                 std::cerr << "You have to specify a BRDFs folder path after -b" << std::endl;
                 show_usage(argv[0]);
                 exit(WRONG_USAGE);
             }
-            brdfsDir = std::string(argv[++i]);
+            options.brdfsDir = std::string(argv[++i]);
+        } else if (argument == "--speculative") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument --speculative" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string batch(argv[++i]);
+            if (!is_number(batch)) {
+                std::cerr << "the argument after --speculative must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.speculativeBatch = std::stoi(batch);
+        } else if (argument == "--sparse") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument --sparse" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string inducing(argv[++i]);
+            if (!is_number(inducing)) {
+                std::cerr << "the argument after --sparse must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.nbInducing = std::stoi(inducing);
+        } else if (argument == "--starts") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument --starts" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string starts(argv[++i]);
+            if (!is_number(starts)) {
+                std::cerr << "the argument after --starts must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.nbStarts = std::stoi(starts);
+        } else if (argument == "--earlyStop") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a number after the argument --earlyStop" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string margin(argv[++i]);
+            if (!is_decimal(margin) || std::strtod(margin.c_str(), nullptr) < 0.) {
+                std::cerr << "the argument after --earlyStop must be a positive number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.earlyStopMargin = std::strtod(margin.c_str(), nullptr);
+        } else if (argument == "--log") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a CSV file path after --log" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.logPath = std::string(argv[++i]);
+        } else if (argument == "--model") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a model file path after --model" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.modelPath = std::string(argv[++i]);
+        } else if (argument == "--lowRank") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify a number after the argument --lowRank" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string tolerance(argv[++i]);
+            if (!is_decimal(tolerance) || std::strtod(tolerance.c_str(), nullptr) <= 0.) {
+                std::cerr << "the argument after --lowRank must be a positive number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.lowRankTolerance = std::strtod(tolerance.c_str(), nullptr);
+        } else if (argument == "--storage") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify float or double after --storage" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.storage = std::string(argv[++i]);
+            if (options.storage != "float" && options.storage != "double") {
+                std::cerr << "the argument after --storage must be float or double" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+        } else if (argument == "--progress") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument --progress" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string interval(argv[++i]);
+            if (!is_number(interval)) {
+                std::cerr << "the argument after --progress must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            options.progressInterval = std::stoi(interval);
+        } else if (argument == "--checkpoint" || argument == "--checkpointSweeps") {
+            if (argc <= i+1) {
+                std::cerr << "You have to specify an unsigned int after the argument " << argument << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            std::string period(argv[++i]);
+            if (!is_number(period)) {
+                std::cerr << "the argument after " << argument << " must be a number" << std::endl;
+                show_usage(argv[0]);
+                exit(WRONG_USAGE);
+            }
+            (argument == "--checkpoint" ? options.checkpointInterval : options.checkpointSweeps) = std::stoi(period);
         } else {
             std::cerr << argument << " is not a valid argument" << std::endl;
             show_usage(argv[0]);
@@ -135,17 +366,105 @@ int main(int argc, const char *argv[]) {
         }
     }
 
+    if ((options.lbfgs || options.nbInducing) && (options.resume || options.checkpointInterval || options.checkpointSweeps)) {
+        std::cerr << "Checkpoints are only available for the pattern search optimisation" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+    if ((options.lbfgs || options.nbInducing) &&
+        (options.tolerance > 0. || options.maxSweeps || options.timeBudget || options.adaptiveStep || options.activeSetPeriod || options.driftInterval)) {
+        std::cerr << "Stopping criteria, step policy, active set and drift monitor are only available for the pattern search optimisation" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+    if ((options.lbfgs || options.nbInducing) && options.speculativeBatch > 1) {
+        std::cerr << "Speculative batches of exploratory moves are only available for the pattern search optimisation" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+    if ((options.smallStorage || options.nbInducing || !options.storage.empty()) && options.lowRankTolerance > 0.) {
+        std::cerr << "The low rank reconstruction only applies to the full mapping held in Ram, in the computation type" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+    if ((options.smallStorage || options.nbInducing) && !options.storage.empty()) {
+        std::cerr << "The storage type only applies to the reconstruction matrix of the full mapping held in Ram" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+    if ((options.smallStorage || options.nbInducing) && !options.modelPath.empty()) {
+        std::cerr << "The model file holds the reconstruction matrix of the full mapping, computed from the BRDFs held in Ram" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+    if (options.nbInducing && (!options.logPath.empty() || options.progressInterval >= 0)) {
+        std::cerr << "The sparse optimisation does not report its progress" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+
+    if (options.nbStarts > 1 && (options.lbfgs || options.nbInducing || options.resume ||
+                                 options.checkpointInterval || options.checkpointSweeps ||
+                                 !options.logPath.empty() || options.progressInterval >= 0)) {
+        std::cerr << "Multiple starts are only available for the pattern search optimisation, without checkpoints nor progress report" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+
+    if (options.earlyStopMargin >= 0. && options.nbStarts <= 1) {
+        std::cerr << "The early stop compares the runs of multiple starts : it needs --starts" << std::endl;
+        show_usage(argv[0]);
+        exit(WRONG_USAGE);
+    }
+
+    // Latent spaces of small dimension use fixed size latent vectors
+    switch (options.dimension) {
+        case 1:
+            parametrise<1>(options);
+            break;
+        case 2:
+            parametrise<2>(options);
+            break;
+        case 3:
+            parametrise<3>(options);
+            break;
+        case 4:
+            parametrise<4>(options);
+            break;
+        default:
+            parametrise<Eigen::Dynamic>(options);
+    }
+    exit(EXIT_SUCCESS);
+}
+
+template <int Dim>
+void parametrise(const Options& options)
+{
+    std::vector<OptimisationObserver<Scalar>*> observers;
+    if (!options.logPath.empty()) {
+        observers.push_back(new CSVObserver<Scalar>(options.logPath));
+    }
+    if (options.progressInterval >= 0) {
+        observers.push_back(new ConsoleObserver<Scalar>(options.progressInterval));
+    }
+
 
     std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
     std::chrono::duration<double, std::milli> duration{};
     BRDFReader reader;
-    BRDFReconstructor<Scalar> *reconstructor;
-    OptimisationSolver<Scalar> *optimizer;
+    BRDFReconstructor<Scalar, Dim> *reconstructor;
+    OptimisationSolver<Scalar, Dim> *optimizer(nullptr);
+    SparseOptimisationSolver<Scalar> *sparseOptimizer(nullptr);
+    MultiStartOptimisation<Scalar, Dim> *multiStart(nullptr);
+    const Vector<Scalar> *latentVariables;
 
     const Scalar minStep = 0.0005;
-    const std::string mapPath("../map.bmp"), optiDataPath("../paramtrzData");
-    const unsigned int dim = dimension;
-    const unsigned int mapWidth(mapSize), mapHeight(mapSize), albedoSampling(16);
+    const Scalar gradientTolerance = 0.001;
+    const Scalar driftTolerance = 1e-8;
+    const std::string mapPath("../map.bmp"), optiDataPath("../paramtrzData"), checkpointPath("../optimisation.ckpt");
+    const std::string basisPath("../reconstructionBasis");
+    const unsigned int dim = options.dimension;
+    const unsigned int mapWidth(options.mapSize), mapHeight(options.mapSize), albedoSampling(16);
     const unsigned int reconstBRDFindex(0);
     const double latentSize(8.);
     RowVector<Scalar> meanBRDF;
@@ -155,31 +474,102 @@ int main(int argc, const char *argv[]) {
 
 
 
-    if (smallStorage) {
+    if (options.nbInducing) {
+        // Neither Z nor ZZt is built : the BRDF files are streamed to get a low rank factor of ZZt
+        start = std::chrono::system_clock::now();
+        Scalar traceZZt;
+        const auto V = reader.createLowRankFactor_centered<Scalar>(options.brdfsDir.c_str(), std::max(options.nbInducing, dim),
+                                                                   meanBRDF, traceZZt);
+        end = std::chrono::system_clock::now();
+        duration = end - start;
+        std::cout << "Streaming the low rank factor of ZZt took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
+
+        num_brdf = V.rows();
+        sparseOptimizer = new SparseOptimisationSolver<Scalar>(meanBRDF.cols(), minStep, V, traceZZt, dim, options.nbInducing);
+
         start = std::chrono::system_clock::now();
-        auto ZZt = reader.createZZt_centered<Scalar>(brdfsDir.c_str(), meanBRDF);
+        sparseOptimizer->optimizeMapping();
+        latentVariables = &sparseOptimizer->getLatentVariables();
+        end = std::chrono::system_clock::now();
+        duration = end - start;
+        std::cout << "Optimisation took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
+
+        start = std::chrono::system_clock::now();
+        reconstructor = new BRDFReconstructorSparse<Scalar, Dim>(reader.getBRDFFilePaths(), sparseOptimizer->getInverseMapping(),
+                                                                 sparseOptimizer->getInducingPoints(), *latentVariables, meanBRDF, dim);
+        end = std::chrono::system_clock::now();
+        duration = end - start;
+        std::cout << "Reconstructor creation took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
+    } else if (options.smallStorage) {
+        start = std::chrono::system_clock::now();
+        auto ZZt = reader.createZZt_centered<Scalar>(options.brdfsDir.c_str(), meanBRDF);
         end = std::chrono::system_clock::now();
         duration = end - start;
         std::cout << "Loading ZZt took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
 
         num_brdf = ZZt.rows();
 
-        optimizer = new OptimisationSolver<Scalar>(meanBRDF.cols(), minStep, ZZt, dim);
+        if (options.nbStarts > 1) {
+            multiStart = new MultiStartOptimisation<Scalar, Dim>(meanBRDF.cols(), minStep, ZZt, dim, options.nbStarts);
+            multiStart->setSpeculativeBatch(options.speculativeBatch);
+            multiStart->setStoppingCriteria(options.tolerance, options.maxSweeps, options.timeBudget);
+            multiStart->setAdaptiveStep(options.adaptiveStep);
+            multiStart->setActiveSet(options.activeSetPeriod);
+            multiStart->setDriftMonitor(options.driftInterval, driftTolerance);
+            multiStart->setEarlyStop(options.earlyStopMargin);
+        } else if (options.lbfgs) {
+            optimizer = new LBFGSOptimisationSolver<Scalar, Dim>(meanBRDF.cols(), gradientTolerance, ZZt, dim);
+        } else {
+            optimizer = new OptimisationSolver<Scalar, Dim>(meanBRDF.cols(), minStep, ZZt, dim);
+            optimizer->setSpeculativeBatch(options.speculativeBatch);
+            optimizer->setStoppingCriteria(options.tolerance, options.maxSweeps, options.timeBudget);
+            optimizer->setAdaptiveStep(options.adaptiveStep);
+            optimizer->setActiveSet(options.activeSetPeriod);
+            optimizer->setDriftMonitor(options.driftInterval, driftTolerance);
+            optimizer->setCheckpoint(checkpointPath, options.checkpointInterval, options.checkpointSweeps);
+            if (options.resume) {
+                optimizer->loadCheckpoint(checkpointPath);
+            }
+        }
+        if (optimizer) {
+            for (auto observer : observers) {
+                optimizer->addObserver(observer);
+            }
+        }
         start = std::chrono::system_clock::now();
-        optimizer->optimizeMapping();
+        if (multiStart) {
+            multiStart->optimizeMapping();
+            std::cout << "Best of " << options.nbStarts << " starts : " << multiStart->getBestStart() << std::endl;
+            for (unsigned int i = 0; i < options.nbStarts; ++i) {
+                if (multiStart->wasStopped(i)) {
+                    std::cout << "Start " << i << " stopped early at cost " << multiStart->getCostValue(i) << std::endl;
+                }
+            }
+            optimizer = multiStart->releaseBestSolver();
+            delete multiStart;
+            latentVariables = &optimizer->getLatentVariables();
+        } else {
+            optimizer->optimizeMapping();
+            latentVariables = &optimizer->getLatentVariables();
+        }
         end = std::chrono::system_clock::now();
         duration = end - start;
         std::cout << "Optimisation took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
+        if (optimizer && !options.lbfgs) {
+            std::cout << optimizer->getSummary() << std::endl;
+        }
 
         start = std::chrono::system_clock::now();
-        reconstructor = new BRDFReconstructorSmallStorage<Scalar>(optimizer->getInverseMapping(),
-                                                                  optimizer->getLatentVariables(), meanBRDF, dim, reader.getBRDFFilePaths());
+        // The BRDF files are read once to write the basis, the reconstructions then stream the mapped basis
+        reconstructor = new BRDFReconstructorSmallStorage<Scalar, Dim>(optimizer->getInverseMapping(),
+                                                                       *latentVariables, meanBRDF, dim, reader.getBRDFFilePaths(),
+                                                                       basisPath);
         end = std::chrono::system_clock::now();
         duration = end - start;
         std::cout << "Reconstructor creation took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
     } else {
         start = std::chrono::system_clock::now();
-        Z = reader.createZ<Scalar>(brdfsDir.c_str());
+        Z = reader.createZ<Scalar>(options.brdfsDir.c_str());
         end = std::chrono::system_clock::now();
         duration = end - start;
         std::cout << "Loading Z took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
@@ -187,44 +577,133 @@ int main(int argc, const char *argv[]) {
         centerMat(Z, meanBRDF);
         num_brdf = Z.rows();
 
-        const auto ZZt = Z * Z.transpose();
-        optimizer = new OptimisationSolver<Scalar>(meanBRDF.cols(), minStep, ZZt, dim);
+        const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+        if (options.nbStarts > 1) {
+            multiStart = new MultiStartOptimisation<Scalar, Dim>(meanBRDF.cols(), minStep, ZZt, dim, options.nbStarts);
+            multiStart->setSpeculativeBatch(options.speculativeBatch);
+            multiStart->setStoppingCriteria(options.tolerance, options.maxSweeps, options.timeBudget);
+            multiStart->setAdaptiveStep(options.adaptiveStep);
+            multiStart->setActiveSet(options.activeSetPeriod);
+            multiStart->setDriftMonitor(options.driftInterval, driftTolerance);
+            multiStart->setEarlyStop(options.earlyStopMargin);
+        } else if (options.lbfgs) {
+            optimizer = new LBFGSOptimisationSolver<Scalar, Dim>(meanBRDF.cols(), gradientTolerance, ZZt, dim);
+        } else {
+            optimizer = new OptimisationSolver<Scalar, Dim>(meanBRDF.cols(), minStep, ZZt, dim);
+            optimizer->setSpeculativeBatch(options.speculativeBatch);
+            optimizer->setStoppingCriteria(options.tolerance, options.maxSweeps, options.timeBudget);
+            optimizer->setAdaptiveStep(options.adaptiveStep);
+            optimizer->setActiveSet(options.activeSetPeriod);
+            optimizer->setDriftMonitor(options.driftInterval, driftTolerance);
+            optimizer->setCheckpoint(checkpointPath, options.checkpointInterval, options.checkpointSweeps);
+            if (options.resume) {
+                optimizer->loadCheckpoint(checkpointPath);
+            }
+        }
+        if (optimizer) {
+            for (auto observer : observers) {
+                optimizer->addObserver(observer);
+            }
+        }
         start = std::chrono::system_clock::now();
-        optimizer->optimizeMapping();
+        if (multiStart) {
+            multiStart->optimizeMapping();
+            std::cout << "Best of " << options.nbStarts << " starts : " << multiStart->getBestStart() << std::endl;
+            for (unsigned int i = 0; i < options.nbStarts; ++i) {
+                if (multiStart->wasStopped(i)) {
+                    std::cout << "Start " << i << " stopped early at cost " << multiStart->getCostValue(i) << std::endl;
+                }
+            }
+            optimizer = multiStart->releaseBestSolver();
+            delete multiStart;
+            latentVariables = &optimizer->getLatentVariables();
+        } else {
+            optimizer->optimizeMapping();
+            latentVariables = &optimizer->getLatentVariables();
+        }
         end = std::chrono::system_clock::now();
         duration = end - start;
         std::cout << "Optimisation took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
+        if (optimizer && !options.lbfgs) {
+            std::cout << optimizer->getSummary() << std::endl;
+        }
 
         start = std::chrono::system_clock::now();
-        reconstructor = new BRDFReconstructorWithZ<Scalar>(Z, optimizer->getInverseMapping(),
-                                                           optimizer->getLatentVariables(), meanBRDF, dim);
+        if (options.lowRankTolerance > 0.) {
+            const auto lowRankReconstructor = new BRDFReconstructorLowRank<Scalar, Dim>(Z, ZZt, optimizer->getInverseMapping(),
+                                                                                       *latentVariables, meanBRDF, dim, options.lowRankTolerance);
+            std::cout << "Rank of the reconstruction : " << lowRankReconstructor->getRank() << " (relative error "
+                      << lowRankReconstructor->getRelativeError() << ")" << std::endl;
+            reconstructor = lowRankReconstructor;
+        } else if (options.storage == "float") {
+            const auto reducedReconstructor = new BRDFReconstructorWithZ<Scalar, Dim, float>(Z, optimizer->getInverseMapping(),
+                                                                                             *latentVariables, meanBRDF, dim);
+            std::cout << "Largest reconstruction deviation due to float storage : " << reducedReconstructor->getStorageDeviation() << std::endl;
+            reconstructor = reducedReconstructor;
+        } else if (options.storage == "double") {
+            const auto reducedReconstructor = new BRDFReconstructorWithZ<Scalar, Dim, double>(Z, optimizer->getInverseMapping(),
+                                                                                              *latentVariables, meanBRDF, dim);
+            std::cout << "Largest reconstruction deviation due to double storage : " << reducedReconstructor->getStorageDeviation() << std::endl;
+            reconstructor = reducedReconstructor;
+        } else {
+            reconstructor = new BRDFReconstructorWithZ<Scalar, Dim>(Z, optimizer->getInverseMapping(),
+                                                                    *latentVariables, meanBRDF, dim);
+        }
         end = std::chrono::system_clock::now();
         duration = end - start;
         std::cout << "Reconstructor creation took " << duration.count() * 0.001<< " seconds" << std::endl << std::endl;
     }
 
-    writeParametrisationData<Scalar>(
-        optiDataPath,
-        reader.getBRDFFilenames(),
-        optimizer->getLatentVariables(),
-        optimizer->getInverseMapping(),
-        dim);
+    // The parametrisation data format holds a n x n inverse mapping : not written for the sparse mapping
+    if (optimizer) {
+        writeParametrisationData<Scalar>(
+            optiDataPath,
+            reader.getBRDFFilenames(),
+            *latentVariables,
+            optimizer->getInverseMapping(),
+            dim);
+    }
+    if (!options.modelPath.empty()) {
+        start = std::chrono::system_clock::now();
+        if (options.storage == "float") {
+            writeModelFile<Scalar, float>(options.modelPath, Z, optimizer->getInverseMapping(), *latentVariables,
+                                          meanBRDF, dim, reader.getBRDFFilenames());
+        } else if (options.storage == "double") {
+            writeModelFile<Scalar, double>(options.modelPath, Z, optimizer->getInverseMapping(), *latentVariables,
+                                           meanBRDF, dim, reader.getBRDFFilenames());
+        } else {
+            writeModelFile<Scalar>(options.modelPath, Z, optimizer->getInverseMapping(), *latentVariables,
+                                   meanBRDF, dim, reader.getBRDFFilenames());
+        }
+        end = std::chrono::system_clock::now();
+        duration = end - start;
+        std::cout << "Writing the model file took " << duration.count() * 0.001 << " seconds" << std::endl << std::endl;
+    }
     
     RowVector<Scalar> brdf_r(reconstructor->getBRDFCoeffNb());
     
     start = std::chrono::system_clock::now();
-    reconstructor->reconstruct(brdf_r, optimizer->getLatentVariables().segment(reconstBRDFindex*dim,dim));
+    reconstructor->reconstruct(brdf_r, latentVariables->segment(reconstBRDFindex*dim,dim));
     end = std::chrono::system_clock::now();
     duration = end - start;
     std::cout <<"Reconstruction of " << reader.getBRDFFilenames()[reconstBRDFindex] << " took " << duration.count()*0.001 << " seconds" << std::endl << std::endl;
     
     writeBRDF<Scalar>("../r_" + reader.getBRDFFilenames()[reconstBRDFindex], brdf_r);
     
-    for (unsigned int i(0); i < std::min(static_cast<int>(num_brdf), 10); ++i)
+    ChefDevr::Matrix<Scalar> errors;
+    start = std::chrono::system_clock::now();
+    reconstructor->reconstructionErrors(errors);
+    end = std::chrono::system_clock::now();
+    duration = end - start;
+    std::cout << "Reconstruction errors of the " << num_brdf << " BRDFs took " << duration.count()*0.001 << " seconds" << std::endl;
+    std::cout << "Reconstruction errors (mean square error : whole BRDF, red, green, blue)" << std::endl;
+    for (long i(0); i < errors.rows(); ++i)
     {
-        std::cout << "Reconstruction error for " << reader.getBRDFFilenames()[i] <<  " : " << reconstructor->reconstructionError(i) << std::endl;
+        std::cout << reader.getBRDFFilenames()[i] << " : " << errors(i, 0) << ", "
+                  << errors(i, 1) << ", " << errors(i, 2) << ", " << errors(i, 3) << std::endl;
     }
-    std::cout << std::endl;
+    std::cout << "Mean : " << errors.col(0).mean() << ", " << errors.col(1).mean() << ", "
+              << errors.col(2).mean() << ", " << errors.col(3).mean() << std::endl << std::endl;
         
     start = std::chrono::system_clock::now();
     Albedo::computeAlbedo<Scalar>(brdf_r, r, g, b, albedoSampling);
@@ -249,5 +728,8 @@ int main(int argc, const char *argv[]) {
 
     delete reconstructor;
     delete optimizer;
-    exit(EXIT_SUCCESS);
+    delete sparseOptimizer;
+    for (auto observer : observers) {
+        delete observer;
+    }
 }
@@ -2,11 +2,13 @@
 
 #include "Parametrisation/types.h"
 #include "Optimisation/OptimisationSolver.h"
+#include "Optimisation/LBFGSOptimisationSolver.h"
 #include "BRDFReader/BRDFReader.h"
 
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <cstdio>
 
 
 
@@ -21,6 +23,20 @@ OptimisationTest::OptimisationTest(): BaseTest("Optimisation"){
             "../tests/data/Optimisation/cost/costSet2_output");
     addTest(&testCost, "Cost 3", "../tests/data/Optimisation/cost/costSet3",
             "../tests/data/Optimisation/cost/costSet3_output");
+    addTest(&testGradient, "Gradient 1", "../tests/data/Optimisation/gradient/gradientSet1",
+            "../tests/data/Optimisation/gradient/gradientSet1_output");
+    addTest(&testCheckpoint, "Checkpoint 1", "../tests/data/Optimisation/checkpoint/checkpointSet1",
+            "../tests/data/Optimisation/checkpoint/checkpointSet1_output");
+    addTest(&testStoppingCriteria, "Stopping criteria 1", "../tests/data/Optimisation/stopping/stoppingSet1",
+            "../tests/data/Optimisation/stopping/stoppingSet1_output");
+    addTest(&testActiveSet, "Active set 1", "../tests/data/Optimisation/activeSet/activeSetSet1",
+            "../tests/data/Optimisation/activeSet/activeSetSet1_output");
+    addTest(&testDriftMonitor, "Drift monitor 1", "../tests/data/Optimisation/drift/driftSet1",
+            "../tests/data/Optimisation/drift/driftSet1_output");
+    addTest(&testCovarianceUpdate, "Covariance update 1", "../tests/data/Optimisation/covarianceUpdate/covarianceUpdateSet1",
+            "../tests/data/Optimisation/covarianceUpdate/covarianceUpdateSet1_output");
+    addTest(&testSpeculativeCorrection, "Speculative correction 1", "../tests/data/Optimisation/speculative/speculativeSet1",
+            "../tests/data/Optimisation/speculative/speculativeSet1_output");
 }
 
 
@@ -46,6 +62,8 @@ std::istringstream OptimisationTest::testShermanMorissonUpdate(std::istream& ist
     }
 
     optimisation.shermanMorissonUpdate(K_minus1, new_K_minus1, detK, new_detK, lv_num, diff_vector);
+    // Only the lower triangle is updated
+    new_K_minus1.triangularView<Eigen::StrictlyUpper>() = new_K_minus1.transpose();
 
     // Writing the output
 
@@ -74,7 +92,7 @@ std::istringstream OptimisationTest::testCost(std::istream& istr) {
     istr >> d;
 
     const auto Z = readMatrix(istr, num_rows, d);
-    const auto ZZt = Z * Z.transpose();
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
 
     ChefDevr::OptimisationSolver<Scalar> optimisation{d, 0.1, ZZt, 2};
 
@@ -123,3 +141,239 @@ std::istringstream OptimisationTest::testInitX(std::istream& istr) {
 
     return std::istringstream(ret.str());
 }
+
+std::istringstream OptimisationTest::testGradient(std::istream& istr) {
+    unsigned int num_rows, d, latentDim;
+    Scalar costval, detK;
+
+    istr >> num_rows;
+    istr >> d;
+    istr >> latentDim;
+
+    const auto Z = readMatrix(istr, num_rows, d);
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+    const auto X = readMatrix(istr, num_rows * latentDim, 1);
+
+    ChefDevr::LBFGSOptimisationSolver<Scalar> optimisation{d, 0.1, ZZt, latentDim};
+    ChefDevr::Matrix<Scalar> K_minus1{num_rows, num_rows};
+    ChefDevr::Vector<Scalar> gradient{num_rows * latentDim};
+
+    optimisation.evaluate(X, K_minus1, detK, costval);
+    optimisation.gradient(gradient, X, optimisation.K, K_minus1);
+
+    // Write Result
+    std::stringstream ret;
+    ret << gradient;
+
+    return std::istringstream(ret.str());
+}
+
+
+std::istringstream OptimisationTest::testCheckpoint(std::istream& istr) {
+    unsigned int num_rows, d, latentDim;
+    const std::string path("checkpointTest.ckpt");
+
+    istr >> num_rows;
+    istr >> d;
+    istr >> latentDim;
+
+    const auto Z = readMatrix(istr, num_rows, d);
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+
+    // The last checkpoint is written one exploratory move before the end
+    ChefDevr::OptimisationSolver<Scalar> optimisation{d, 0.01, ZZt, latentDim};
+    optimisation.setCheckpoint(path, 0, 1);
+    optimisation.optimizeMapping();
+
+    // Resuming from it must give the same solution
+    ChefDevr::OptimisationSolver<Scalar> resumed{d, 0.01, ZZt, latentDim};
+    resumed.loadCheckpoint(path);
+    const bool loaded(resumed.resumed && resumed.step < resumed.step0);
+    resumed.optimizeMapping();
+    std::remove(path.c_str());
+
+    std::stringstream ret;
+    ret << (loaded && resumed.X == optimisation.X && resumed.K_minus1 == optimisation.K_minus1 &&
+            resumed.costval == optimisation.costval);
+
+    return std::istringstream(ret.str());
+}
+
+
+std::istringstream OptimisationTest::testStoppingCriteria(std::istream& istr) {
+    unsigned int num_rows, d, latentDim;
+    using ChefDevr::StopReason;
+
+    istr >> num_rows;
+    istr >> d;
+    istr >> latentDim;
+
+    const auto Z = readMatrix(istr, num_rows, d);
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+
+    // Without criteria the optimisation stops on the minimum step
+    ChefDevr::OptimisationSolver<Scalar> reference{d, 0.01, ZZt, latentDim};
+    reference.optimizeMapping();
+    const auto& full(reference.getSummary());
+
+    // The first sweeps of a limited run are the ones of the reference run
+    ChefDevr::OptimisationSolver<Scalar> limited{d, 0.01, ZZt, latentDim};
+    limited.setStoppingCriteria(0, 2, 0);
+    limited.optimizeMapping();
+    const auto& partial(limited.getSummary());
+
+    // The adaptive policy never increases the cost either
+    ChefDevr::OptimisationSolver<Scalar> adaptive{d, 0.01, ZZt, latentDim};
+    adaptive.setAdaptiveStep(true);
+    adaptive.optimizeMapping();
+    const auto& adapted(adaptive.getSummary());
+
+    std::stringstream ret;
+    ret << (full.stopReason == StopReason::MinStep && full.finalStep < Scalar(0.01) &&
+            full.sweeps == full.reductions && full.finalCost == reference.costval &&
+            partial.stopReason == StopReason::MaxSweeps && partial.sweeps == 2 &&
+            partial.initialCost == full.initialCost && limited.costval >= reference.costval &&
+            adapted.adaptiveStep && adapted.stopReason == StopReason::MinStep &&
+            adapted.finalCost <= adapted.initialCost);
+
+    return std::istringstream(ret.str());
+}
+
+
+std::istringstream OptimisationTest::testActiveSet(std::istream& istr) {
+    unsigned int num_rows, d, latentDim;
+    using ChefDevr::StopReason;
+
+    istr >> num_rows;
+    istr >> d;
+    istr >> latentDim;
+
+    const auto Z = readMatrix(istr, num_rows, d);
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+    const unsigned long nbcoefs(num_rows * latentDim);
+
+    // Revisiting the stagnant coordinates at every sweep evaluates every coordinate
+    ChefDevr::OptimisationSolver<Scalar> full{d, 0.01, ZZt, latentDim};
+    full.setActiveSet(1);
+    full.optimizeMapping();
+    const auto& fullSummary(full.getSummary());
+
+    ChefDevr::OptimisationSolver<Scalar> active{d, 0.01, ZZt, latentDim};
+    active.setActiveSet(3);
+    active.optimizeMapping();
+    const auto& activeSummary(active.getSummary());
+
+    // The last sweep at each step is a complete sweep without any decrease of the cost
+    std::stringstream ret;
+    ret << (fullSummary.stopReason == StopReason::MinStep && fullSummary.skipped == 0 &&
+            fullSummary.evaluations == fullSummary.sweeps * nbcoefs &&
+            fullSummary.finalCost <= fullSummary.initialCost &&
+            activeSummary.stopReason == StopReason::MinStep &&
+            activeSummary.evaluations + activeSummary.skipped == activeSummary.sweeps * nbcoefs &&
+            activeSummary.finalCost <= activeSummary.initialCost && !active.X_move.any() &&
+            active.step < Scalar(0.01));
+
+    return std::istringstream(ret.str());
+}
+
+
+std::istringstream OptimisationTest::testDriftMonitor(std::istream& istr) {
+    unsigned int num_rows, d, latentDim;
+
+    istr >> num_rows;
+    istr >> d;
+    istr >> latentDim;
+
+    const auto Z = readMatrix(istr, num_rows, d);
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+
+    ChefDevr::OptimisationSolver<Scalar> reference{d, 0.01, ZZt, latentDim};
+    reference.optimizeMapping();
+
+    // Probes alone do not change the path of the optimisation
+    ChefDevr::OptimisationSolver<Scalar> probed{d, 0.01, ZZt, latentDim};
+    probed.setDriftMonitor(1, 1);
+    probed.optimizeMapping();
+    const auto& probedSummary(probed.getSummary());
+
+    // A null tolerance refactorises K at each probe
+    ChefDevr::OptimisationSolver<Scalar> refactorised{d, 0.01, ZZt, latentDim};
+    refactorised.setDriftMonitor(5, 0);
+    refactorised.optimizeMapping();
+    const auto& refactorisedSummary(refactorised.getSummary());
+
+    std::stringstream ret;
+    ret << (probed.X == reference.X && probed.costval == reference.costval &&
+            probedSummary.driftProbes > 0 && probedSummary.refactorisations == 0 &&
+            probedSummary.maxResidual < Scalar(1e-6) &&
+            refactorisedSummary.refactorisations == refactorisedSummary.driftProbes &&
+            refactorisedSummary.refactorisations > 0 &&
+            abs(refactorised.costval - reference.costval) < Scalar(1e-6) * abs(reference.costval));
+
+    return std::istringstream(ret.str());
+}
+
+std::istringstream OptimisationTest::testCovarianceUpdate(std::istream& istr) {
+    unsigned int num_rows, latentDim;
+    Scalar step;
+
+    istr >> num_rows;
+    istr >> latentDim;
+    istr >> step;
+
+    const auto X = readMatrix(istr, num_rows * latentDim, 1);
+    const ChefDevr::Matrix<Scalar> ZZt(ChefDevr::Matrix<Scalar>::Identity(num_rows, num_rows));
+    ChefDevr::OptimisationSolver<Scalar> optimisation{1, 0.1, ZZt, latentDim};
+    optimisation.X = X;
+    optimisation.step = step;
+    optimisation.updateCovarianceCache();
+
+    // Covariance vector of the moving latent variable after each move of each coordinate
+    std::stringstream ret;
+    ChefDevr::Vector<Scalar> diff_cov_vector(num_rows);
+    for (unsigned int i = 0; i < num_rows * latentDim; ++i) {
+        for (const bool positive : {true, false}) {
+            optimisation.computeDiffCovVector(diff_cov_vector, i / latentDim, i % latentDim, positive);
+            ret << (optimisation.K.col(i / latentDim) + diff_cov_vector).transpose() << std::endl;
+        }
+    }
+
+    return std::istringstream(ret.str());
+}
+
+std::istringstream OptimisationTest::testSpeculativeCorrection(std::istream& istr) {
+    unsigned int num_rows, d, latentDim, nbPairs;
+    Scalar step;
+
+    istr >> num_rows;
+    istr >> d;
+    istr >> latentDim;
+
+    const auto Z = readMatrix(istr, num_rows, d);
+    const ChefDevr::Matrix<Scalar> ZZt = Z * Z.transpose();
+    const auto X = readMatrix(istr, num_rows * latentDim, 1);
+    istr >> step;
+    istr >> nbPairs;
+
+    // Cost change of the +step move of j evaluated before the +step move of i, then corrected after it
+    std::stringstream ret;
+    for (unsigned int k = 0; k < nbPairs; ++k) {
+        unsigned int i, j;
+        istr >> i >> j;
+        ChefDevr::OptimisationSolver<Scalar> optimisation{d, 0.1, ZZt, latentDim};
+        optimisation.X = X;
+        optimisation.step = step;
+        ChefDevr::computeCovMatrix<Scalar>(optimisation.K_minus1, X, latentDim);
+        optimisation.invertCovariance(optimisation.K_minus1, optimisation.detK);
+        optimisation.updateCovarianceCache();
+
+        ChefDevr::OptimisationSolver<Scalar>::MoveCandidate first, second;
+        optimisation.evaluateMove(i, true, first);
+        optimisation.evaluateMove(j, true, second);
+        optimisation.acceptMove(i, first);
+        optimisation.correctMove(j, second, i / latentDim, first);
+        ret << second.deltaCost << std::endl;
+    }
+
+    return std::istringstream(ret.str());
+}
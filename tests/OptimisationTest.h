@@ -18,6 +18,20 @@ private:
 
     static std::istringstream testInitX(std::istream& istr);
 
+    static std::istringstream testGradient(std::istream& istr);
+
+    static std::istringstream testCheckpoint(std::istream& istr);
+
+    static std::istringstream testStoppingCriteria(std::istream& istr);
+
+    static std::istringstream testActiveSet(std::istream& istr);
+
+    static std::istringstream testDriftMonitor(std::istream& istr);
+
+    static std::istringstream testCovarianceUpdate(std::istream& istr);
+
+    static std::istringstream testSpeculativeCorrection(std::istream& istr);
+
     static ChefDevr::Matrix<Scalar> readMatrix(std::istream &istr, unsigned int num_rows, unsigned int num_cols);
 
 
@@ -1,13 +1,39 @@
 #include "ParametrisationTest.h"
 #include "Parametrisation/Parametrisation.h"
 #include "Parametrisation/types.h"
+#include "Parametrisation/Reduction.h"
+#include "Parametrisation/ParametrisationWithZ.h"
+#include "Parametrisation/ParametrisationLowRank.h"
+#include "Parametrisation/ReconstructionCache.h"
+#include "Parametrisation/ParametrisationMapped.h"
+#include <Eigen/Cholesky>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include "Parametrisation/MERLReader.h"
 #include "BRDFReaderTest.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 ParametrisationTest::ParametrisationTest(): BaseTest("Parametrisation") {
     addTest(&testCovariance, "Covariance1", "../tests/data/Parametrisation/covTestSet1", "../tests/data/Parametrisation/GT_covTestSet1");
     addTest(&testCovariance, "Covariance2", "../tests/data/Parametrisation/covTestSet2", "../tests/data/Parametrisation/GT_covTestSet2");
+    addTest(&testComputeCovVector, "CovVector1", "../tests/data/Parametrisation/covVectorTestSet1", "../tests/data/Parametrisation/GT_covVectorTestSet1");
+    addTest(&testComputeCovVector, "CovVector2", "../tests/data/Parametrisation/covVectorTestSet2", "../tests/data/Parametrisation/GT_covVectorTestSet2");
     addTest(&testCenter, "Center1", "../tests/data/Parametrisation/centerTestSet1", "../tests/data/Parametrisation/GT_centerTestSet1");
     addTest(&testCenter, "Center2", "../tests/data/Parametrisation/centerTestSet2", "../tests/data/Parametrisation/GT_centerTestSet2");
+    addTest(&testDeterministicSum, "Reduction1", "../tests/data/Parametrisation/reductionTestSet1", "../tests/data/Parametrisation/GT_reductionTestSet1");
+    addTest(&testReconstructBatch, "ReconstructBatch1", "../tests/data/Parametrisation/reconstructBatchTestSet1", "../tests/data/Parametrisation/GT_reconstructBatchTestSet1");
+    addTest(&testReducedStorage, "ReducedStorage1", "../tests/data/Parametrisation/reducedStorageTestSet1", "../tests/data/Parametrisation/GT_reducedStorageTestSet1");
+    addTest(&testLowRank, "LowRank1", "../tests/data/Parametrisation/lowRankTestSet1", "../tests/data/Parametrisation/GT_lowRankTestSet1");
+    addTest(&testPointQuery, "PointQuery1", "../tests/data/Parametrisation/pointQueryTestSet1", "../tests/data/Parametrisation/GT_pointQueryTestSet1");
+    addTest(&testReconstructionErrors, "ReconstructionErrors1", "../tests/data/Parametrisation/reconstructionErrorsTestSet1", "../tests/data/Parametrisation/GT_reconstructionErrorsTestSet1");
+    addTest(&testReconstructionCache, "ReconstructionCache1", "../tests/data/Parametrisation/reconstructionCacheTestSet1", "../tests/data/Parametrisation/GT_reconstructionCacheTestSet1");
+    addTest(&testModelFile, "ModelFile1", "../tests/data/Parametrisation/modelFileTestSet1", "../tests/data/Parametrisation/GT_modelFileTestSet1");
 }
 
 std::istringstream ParametrisationTest::testCovariance(std::istream& istr) {
@@ -27,6 +53,34 @@ std::istringstream ParametrisationTest::testCovariance(std::istream& istr) {
     return std::istringstream(std::to_string(ChefDevr::covariance(A,B)));
 }
 
+// The covariance vector computed with a fixed dimension, then with a dynamic one
+template <int Dim>
+static std::string covarianceVectors(const ChefDevr::Vector<double>& X, const ChefDevr::Vector<double>& coord, uint nb_data) {
+    ChefDevr::Vector<double> dynamicCov(nb_data), fixedCov(nb_data);
+    ChefDevr::computeCovVector<double>(dynamicCov.data(), X, coord, Dim, nb_data);
+    ChefDevr::computeCovVector<double, Dim>(fixedCov.data(), X, coord, Dim, nb_data);
+    std::stringstream ret;
+    ret << fixedCov << std::endl << dynamicCov;
+    return ret.str();
+}
+
+std::istringstream ParametrisationTest::testComputeCovVector(std::istream& istr) {
+    uint dim, nb_data;
+    istr >> dim >> nb_data;
+    ChefDevr::Vector<double> X(dim*nb_data), coord(dim);
+    for(uint i=0; i<dim*nb_data; i++) {
+        istr >> X[i];
+    }
+    for(uint i=0; i<dim; i++) {
+        istr >> coord[i];
+    }
+    switch (dim) {
+        case 2: return std::istringstream(covarianceVectors<2>(X, coord, nb_data));
+        case 3: return std::istringstream(covarianceVectors<3>(X, coord, nb_data));
+        default: return std::istringstream();
+    }
+}
+
 std::istringstream ParametrisationTest::testCenter(std::istream& istr) {
     uint w,h;
     istr >> w >> h;
@@ -44,3 +98,428 @@ std::istringstream ParametrisationTest::testCenter(std::istream& istr) {
     ret << M;
     return std::istringstream(ret.str());
 }
+
+std::istringstream ParametrisationTest::testDeterministicSum(std::istream& istr) {
+    uint n;
+    istr >> n;
+    std::vector<double> values(n);
+    for(uint i=0; i<n; i++) {
+        istr >> values[i];
+    }
+    const auto term = [&values](long i) { return values[i]; };
+    // The sum must not depend on the number of threads, bit for bit : one line per number of threads
+    std::stringstream ret;
+    double reference = 0;
+    for(int threads=1; threads<=7; threads+=2) {
+        #ifdef _OPENMP
+        const int previousThreads(omp_get_max_threads());
+        omp_set_num_threads(threads);
+        #endif
+        const double sum(ChefDevr::deterministicSum<double>(n, term, 0., 4));
+        #ifdef _OPENMP
+        omp_set_num_threads(previousThreads);
+        #endif
+        if(threads == 1) {
+            reference = sum;
+            ret << reference << std::endl;
+        } else {
+            ret << (sum == reference) << std::endl;
+        }
+    }
+    // A single chunk is the pairwise sum
+    std::vector<double> copy(values);
+    ret << (ChefDevr::pairwiseSum(copy, 0.) == ChefDevr::deterministicSum<double>(n, term, 0., 1));
+    return std::istringstream(ret.str());
+}
+
+/**
+ * @brief Reads latent variables, BRDFs and latent space points, then centers the BRDFs and inverts their covariance
+ */
+static uint readReconstructionData(std::istream& istr, ChefDevr::Vector<double>& X, ChefDevr::Matrix<double>& Z,
+                                   ChefDevr::RowVector<double>& meanBRDF, ChefDevr::Matrix<double>& K_minus1,
+                                   ChefDevr::Matrix<double>& coords) {
+    uint dim, nb_data, nb_coefs, nb_points;
+    istr >> dim >> nb_data >> nb_coefs;
+    X.resize(dim*nb_data);
+    Z.resize(nb_data, nb_coefs);
+    for(uint i=0; i<dim*nb_data; i++) {
+        istr >> X[i];
+    }
+    for(uint i=0; i<nb_data; i++) {
+        for(uint j=0; j<nb_coefs; j++) {
+            istr >> Z(i, j);
+        }
+    }
+    istr >> nb_points;
+    coords.resize(dim, nb_points);
+    for(uint p=0; p<nb_points; p++) {
+        for(uint c=0; c<dim; c++) {
+            istr >> coords(c, p);
+        }
+    }
+    ChefDevr::Matrix<double> K;
+    ChefDevr::centerMat(Z, meanBRDF);
+    ChefDevr::computeCovMatrix<double>(K, X, dim);
+    K_minus1 = K.llt().solve(ChefDevr::Matrix<double>::Identity(nb_data, nb_data));
+    return dim;
+}
+
+std::istringstream ParametrisationTest::testReconstructBatch(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    const long nb_points(coords.cols()), nb_coefs(Z.cols());
+    const ChefDevr::BRDFReconstructorWithZ<double> reconstructor(Z, K_minus1, X, meanBRDF, dim);
+
+    // The batch, the single reconstructions and the blocks are each compared with the reference BRDFs
+    ChefDevr::Matrix<double> brdfs, blocks(nb_points, nb_coefs);
+    ChefDevr::RowVector<double> brdf(nb_coefs);
+    std::stringstream ret;
+    reconstructor.reconstructBatch(brdfs, coords);
+    ret << brdfs.rows() << " " << brdfs.cols() << std::endl << brdfs << std::endl;
+    for(uint p=0; p<nb_points; p++) {
+        reconstructor.reconstruct(brdf, coords.col(p));
+        ret << brdf << std::endl;
+    }
+    // Blocks must cover every coefficient once, in order
+    bool ordered = true;
+    long next = 0;
+    reconstructor.reconstructBatchBlocks(coords, [&](long first, const ChefDevr::Matrix<double>& block) {
+        ordered = ordered && first == next && block.rows() == nb_points;
+        blocks.middleCols(first, block.cols()) = block;
+        next += block.cols();
+    }, 3);
+    ret << ordered << " " << next << std::endl << blocks;
+    return std::istringstream(ret.str());
+}
+
+std::istringstream ParametrisationTest::testReducedStorage(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    const long nb_data(Z.rows()), nb_coefs(Z.cols());
+    const ChefDevr::BRDFReconstructorWithZ<double> full(Z, K_minus1, X, meanBRDF, dim);
+    const ChefDevr::BRDFReconstructorWithZ<double, Eigen::Dynamic, float> reduced(Z, K_minus1, X, meanBRDF, dim);
+
+    // The reported deviation is the largest one at the latent variables
+    ChefDevr::RowVector<double> brdf(nb_coefs), reducedBrdf(nb_coefs);
+    double deviation = 0;
+    for(long i=0; i<nb_data; i++) {
+        const ChefDevr::Vector<double> coord(X.segment(i*dim, dim));
+        full.reconstruct(brdf, coord);
+        reduced.reconstruct(reducedBrdf, coord);
+        deviation = std::max(deviation, (brdf - reducedBrdf).cwiseAbs().maxCoeff());
+    }
+    // Elsewhere only the rounding of the stored values is lost
+    ChefDevr::Matrix<double> reducedBrdfs;
+    reduced.reconstructBatch(reducedBrdfs, coords);
+    std::stringstream ret;
+    ret << reducedBrdfs << std::endl << reduced.getStorageDeviation() << std::endl << deviation << std::endl
+        << full.getStorageDeviation();
+    return std::istringstream(ret.str());
+}
+
+std::istringstream ParametrisationTest::testLowRank(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    double tolerance;
+    istr >> tolerance;
+    const long nb_data(Z.rows());
+    const ChefDevr::Matrix<double> ZZt(Z * Z.transpose());
+    const ChefDevr::BRDFReconstructorWithZ<double> full(Z, K_minus1, X, meanBRDF, dim);
+    const ChefDevr::BRDFReconstructorLowRank<double> exact(Z, ZZt, K_minus1, X, meanBRDF, dim, 0.);
+    const ChefDevr::BRDFReconstructorLowRank<double> truncated(Z, ZZt, K_minus1, X, meanBRDF, dim, tolerance);
+
+    // Batched and single truncated reconstructions are each compared with the reference
+    ChefDevr::Matrix<double> brdfs, exactBrdfs, truncatedBrdfs;
+    ChefDevr::RowVector<double> brdf(Z.cols());
+    truncated.reconstructBatch(truncatedBrdfs, coords);
+    std::stringstream ret;
+    ret << truncated.getRank() << std::endl << truncated.getRelativeError() << std::endl
+        << truncatedBrdfs << std::endl;
+    for(long p=0; p<coords.cols(); p++) {
+        truncated.reconstruct(brdf, coords.col(p));
+        ret << brdf << std::endl;
+    }
+    // Without tolerance only the null space of the centered BRDFs is dropped and the reconstruction
+    // is unchanged, up to the resolution of the singular vectors computed from the gram matrix
+    full.reconstructBatch(brdfs, coords);
+    exact.reconstructBatch(exactBrdfs, coords);
+    ret << (exact.getRank() >= nb_data-1) << std::endl << exact.getRelativeError() << std::endl
+        << ((brdfs - exactBrdfs).cwiseAbs().maxCoeff() <= 1e-5 * brdfs.cwiseAbs().maxCoeff());
+    return std::istringstream(ret.str());
+}
+
+std::istringstream ParametrisationTest::testPointQuery(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    uint nb_indices, nb_directions;
+    istr >> nb_indices;
+    std::vector<unsigned int> indices(nb_indices);
+    for(uint k=0; k<nb_indices; k++) {
+        istr >> indices[k];
+    }
+    const ChefDevr::Matrix<double> ZZt(Z * Z.transpose());
+    const ChefDevr::BRDFReconstructorWithZ<double> full(Z, K_minus1, X, meanBRDF, dim);
+    const ChefDevr::BRDFReconstructorLowRank<double> lowRank(Z, ZZt, K_minus1, X, meanBRDF, dim, 0.);
+
+    // The coefficients are the ones of the whole reconstructed BRDF
+    bool fullMatch = true, lowRankMatch = true, lookupMatch = true;
+    std::stringstream fullValues, lowRankValues, lookups;
+    ChefDevr::RowVector<double> brdf(Z.cols());
+    ChefDevr::Vector<double> values;
+    for(long p=0; p<coords.cols(); p++) {
+        full.reconstruct(brdf, coords.col(p));
+        const double tolerance(1e-9 * (1 + brdf.cwiseAbs().maxCoeff()));
+        full.reconstructCoefficients(values, coords.col(p), indices);
+        fullValues << values.transpose() << std::endl;
+        for(uint k=0; k<nb_indices; k++) {
+            fullMatch = fullMatch && std::abs(values[k] - brdf[indices[k]]) <= tolerance;
+        }
+        lowRank.reconstruct(brdf, coords.col(p));
+        lowRank.reconstructCoefficients(values, coords.col(p), indices);
+        lowRankValues << values.transpose() << std::endl;
+        for(uint k=0; k<nb_indices; k++) {
+            lowRankMatch = lowRankMatch && std::abs(values[k] - brdf[indices[k]]) <= tolerance;
+        }
+    }
+
+    // The index of a pair of directions is the one read by lookup_brdf_val
+    istr >> nb_directions;
+    ChefDevr::RowVector<double> ramp(ChefDevr::RowVector<double>::LinSpaced(ChefDevr::MERLReader::num_coefficientsBRDF, 1., ChefDevr::MERLReader::num_coefficientsBRDF));
+    lookups.precision(10);
+    for(uint d=0; d<nb_directions; d++) {
+        double theta_in, phi_in, theta_out, phi_out, red, green, blue;
+        istr >> theta_in >> phi_in >> theta_out >> phi_out;
+        ChefDevr::MERLReader::lookup_brdf_val(ramp, theta_in, phi_in, theta_out, phi_out, red, green, blue);
+        lookups << std::endl << red << " " << green << " " << blue;
+        const unsigned int index(ChefDevr::MERLReader::lookup_index(theta_in, phi_in, theta_out, phi_out));
+        lookupMatch = lookupMatch && red == ramp[index] * ChefDevr::MERLReader::red_scale &&
+                green == ramp[index + ChefDevr::MERLReader::channelStride] * ChefDevr::MERLReader::green_scale &&
+                blue == ramp[index + 2 * ChefDevr::MERLReader::channelStride] * ChefDevr::MERLReader::blue_scale;
+    }
+    std::stringstream ret;
+    ret << fullValues.str() << lowRankValues.str() << fullMatch << std::endl << lowRankMatch << std::endl
+        << lookupMatch << lookups.str();
+    return std::istringstream(ret.str());
+}
+
+// One line per check : the errors computed at once match the ones computed one brdf at a time,
+// then the channels add up to the whole brdf
+static std::string checkReconstructionErrors(const ChefDevr::BRDFReconstructor<double>& reconstructor, long nb_data, double scale) {
+    const long nbCoefficients(reconstructor.getBRDFCoeffNb());
+    ChefDevr::Matrix<double> errors;
+    reconstructor.reconstructionErrors(errors);
+    const bool shape(errors.rows() == nb_data && errors.cols() == 4);
+    bool atOnce = shape, channelsAddUp = shape;
+    for(long i=0; shape && i<nb_data; i++) {
+        const double error(reconstructor.reconstructionError(i));
+        double channels(0);
+        for(long c=0; c<3; c++) {
+            channels += errors(i, c+1) * ((c+1)*nbCoefficients/3 - c*nbCoefficients/3);
+        }
+        atOnce = atOnce && std::abs(errors(i, 0) - error) <= 1e-9 * error + 1e-12 * scale;
+        channelsAddUp = channelsAddUp && std::abs(channels / nbCoefficients - errors(i, 0)) <= 1e-12 * (errors(i, 0) + scale);
+    }
+    std::stringstream ret;
+    ret << atOnce << std::endl << channelsAddUp;
+    return ret.str();
+}
+
+std::istringstream ParametrisationTest::testReconstructionErrors(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    double tolerance;
+    istr >> tolerance;
+    const ChefDevr::Matrix<double> ZZt(Z * Z.transpose());
+    const ChefDevr::BRDFReconstructorWithZ<double> full(Z, K_minus1, X, meanBRDF, dim);
+    const ChefDevr::BRDFReconstructorLowRank<double> truncated(Z, ZZt, K_minus1, X, meanBRDF, dim, tolerance);
+
+    // The truncated reconstructor does not interpolate the brdfs
+    const double scale(Z.cwiseAbs2().mean());
+    ChefDevr::Matrix<double> errors;
+    truncated.reconstructionErrors(errors);
+    std::stringstream ret;
+    ret << errors << std::endl << checkReconstructionErrors(full, Z.rows(), scale) << std::endl
+        << checkReconstructionErrors(truncated, Z.rows(), scale);
+    return std::istringstream(ret.str());
+}
+
+std::istringstream ParametrisationTest::testReconstructionCache(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    double quantum, errorBound;
+    uint resolution;
+    istr >> quantum >> resolution >> errorBound;
+    const long nb_coefs(Z.cols());
+    const std::size_t brdfBytes(nb_coefs * sizeof(double));
+    const ChefDevr::BRDFReconstructorWithZ<double> reconstructor(Z, K_minus1, X, meanBRDF, dim);
+    ChefDevr::RowVector<double> brdf(nb_coefs), exact(nb_coefs);
+
+    // Room for 2 BRDFs : nearby queries share an entry reconstructed at the quantised coordinates
+    ChefDevr::ReconstructionCache<double> lru(reconstructor, 2 * brdfBytes, quantum);
+    const ChefDevr::Vector<double> p0(coords.col(0)), p1(coords.col(1)), p2(coords.col(2));
+    lru.reconstruct(brdf, p0);
+    const ChefDevr::Vector<double> quantised((p0 / quantum).array().round() * quantum);
+    const ChefDevr::Vector<double> nearby(quantised.array() + 0.3 * quantum);
+    reconstructor.reconstruct(exact, quantised);
+    const bool firstExact(brdf == exact);
+    lru.reconstruct(brdf, nearby);
+    const bool nearbyHit(brdf == exact && lru.getHits() == 1 && lru.getMisses() == 1);
+    // The least recently used entry is evicted
+    lru.reconstruct(brdf, p1);
+    lru.reconstruct(brdf, p2);
+    lru.reconstruct(brdf, p0);
+    std::stringstream ret;
+    ret << lru.getHits() << " " << lru.getMisses() << " " << lru.getSize();
+
+    // A grid of resolution^dim BRDFs and 2 cached ones
+    std::size_t nbNodes(1);
+    for(uint c=0; c<dim; c++) {
+        nbNodes *= resolution;
+    }
+    ChefDevr::ReconstructionCache<double> cache(reconstructor, (nbNodes + 2) * brdfBytes, quantum);
+    const ChefDevr::Vector<double> lower(ChefDevr::Vector<double>::Constant(dim, -1.5)), upper(-lower);
+    bool thrown = false;
+    try {
+        lru.buildGrid(lower, upper, resolution, errorBound);
+    } catch (const ChefDevr::ReconstructionCache<double>::ReconstructionCacheError&) {
+        thrown = true;
+    }
+    cache.buildGrid(lower, upper, resolution, errorBound);
+    ret << " " << cache.getCapacity() << std::endl;
+    for(const double cellError : cache.getCellErrors()) {
+        ret << cellError << " ";
+    }
+
+    // The grid interpolates the nodes exactly, the cells are used only below the error bound
+    const double step(3. / (resolution - 1));
+    bool nodeExact = true, boundFollowed = true, errorsMatch = true;
+    if (cache.reconstructApproximate(brdf, lower)) {
+        reconstructor.reconstruct(exact, lower);
+        nodeExact = (brdf - exact).cwiseAbs().maxCoeff() <= 1e-9 * (1 + exact.cwiseAbs().maxCoeff());
+    }
+    bool interpolated = false, reconstructed = false;
+    for(std::size_t cell=0; cell<cache.getCellErrors().size(); cell++) {
+        ChefDevr::Vector<double> center(dim);
+        std::size_t rest(cell);
+        for(uint c=0; c<dim; c++) {
+            center[c] = lower[c] + (rest % (resolution - 1) + 0.5) * step;
+            rest /= resolution - 1;
+        }
+        const bool approximate(cache.reconstructApproximate(brdf, center));
+        reconstructor.reconstruct(exact, center);
+        const double error((brdf - exact).squaredNorm() / nb_coefs);
+        boundFollowed = boundFollowed && approximate == (cache.getCellErrors()[cell] <= errorBound);
+        errorsMatch = errorsMatch && (!approximate || std::abs(error - cache.getCellErrors()[cell]) <= 1e-9 * (1 + error));
+        interpolated = interpolated || approximate;
+        reconstructed = reconstructed || !approximate;
+    }
+    // One line per check, out of the grid last
+    ret << std::endl << firstExact << std::endl << nearbyHit << std::endl << thrown << std::endl << nodeExact
+        << std::endl << boundFollowed << std::endl << errorsMatch << std::endl << interpolated << std::endl
+        << reconstructed << std::endl << !cache.reconstructApproximate(brdf, upper * 2.);
+    return std::istringstream(ret.str());
+}
+
+std::istringstream ParametrisationTest::testModelFile(std::istream& istr) {
+    ChefDevr::Vector<double> X;
+    ChefDevr::Matrix<double> Z, K_minus1, coords;
+    ChefDevr::RowVector<double> meanBRDF;
+    const uint dim(readReconstructionData(istr, X, Z, meanBRDF, K_minus1, coords));
+    const long nb_points(coords.cols()), nb_coefs(Z.cols());
+    std::vector<std::string> filenames;
+    for(long i=0; i<Z.rows(); i++) {
+        filenames.push_back("brdf" + std::to_string(i) + ".binary");
+    }
+    const std::string path("../tests/data/Parametrisation/model.tmp"), floatPath(path + ".float"), truncatedPath(path + ".truncated");
+    {
+        // The model must not depend on the objects it was written from
+        const ChefDevr::Matrix<double> Zcopy(Z), K_minus1copy(K_minus1);
+        const ChefDevr::Vector<double> Xcopy(X);
+        const ChefDevr::RowVector<double> meanCopy(meanBRDF);
+        ChefDevr::writeModelFile<double>(path, Zcopy, K_minus1copy, Xcopy, meanCopy, dim, filenames);
+        ChefDevr::writeModelFile<double, float>(floatPath, Zcopy, K_minus1copy, Xcopy, meanCopy, dim, filenames);
+    }
+    const ChefDevr::BRDFReconstructorWithZ<double> reference(Z, K_minus1, X, meanBRDF, dim);
+    const ChefDevr::BRDFReconstructorWithZ<double, Eigen::Dynamic, float> referenceFloat(Z, K_minus1, X, meanBRDF, dim);
+    const ChefDevr::BRDFReconstructorMapped<double> mapped(path);
+    const ChefDevr::BRDFReconstructorMapped<double, 2, float> mappedFloat(floatPath);
+
+    // The header of the float model, the filenames and latent variables, the dimensions of the mapped model
+    std::stringstream ret, coefficients, floatBrdfs;
+    const ChefDevr::ModelHeader header(ChefDevr::readModelHeader(floatPath));
+    ret << header.latentDim << " " << header.nbBRDFs << " " << header.nbCoefficients << " " << header.storageSize << std::endl
+        << (mapped.getBRDFFilenames() == filenames) << std::endl << (mapped.getLatentVariables() == X) << std::endl
+        << mapped.getLatentDim() << " " << mapped.getBRDFCoeffNb() << std::endl;
+
+    // The mapped BRDFs, then the mapped coefficients, then the BRDFs mapped from the float storage
+    ChefDevr::RowVector<double> brdf(nb_coefs), expected(nb_coefs);
+    ChefDevr::Matrix<double> brdfs;
+    ChefDevr::Vector<double> values, expectedValues;
+    const std::vector<unsigned int> indices{0, 3, uint(nb_coefs - 1)};
+    bool singleMatch = true, batchMatch = true, coefficientsMatch = true, floatMatch = true;
+    mapped.reconstructBatch(brdfs, coords);
+    ret << brdfs << std::endl;
+    for(long p=0; p<nb_points; p++) {
+        const ChefDevr::Vector<double> coord(coords.col(p));
+        reference.reconstruct(expected, coord);
+        const double tolerance(1e-9 * (1 + expected.cwiseAbs().maxCoeff()));
+        mapped.reconstruct(brdf, coord);
+        singleMatch = singleMatch && (brdf - expected).cwiseAbs().maxCoeff() <= tolerance;
+        batchMatch = batchMatch && (brdfs.row(p) - expected).cwiseAbs().maxCoeff() <= tolerance;
+        mapped.reconstructCoefficients(values, coord, indices);
+        coefficients << values.transpose() << std::endl;
+        reference.reconstructCoefficients(expectedValues, coord, indices);
+        coefficientsMatch = coefficientsMatch && (values - expectedValues).cwiseAbs().maxCoeff() <= tolerance;
+        referenceFloat.reconstruct(expected, coord);
+        mappedFloat.reconstruct(brdf, coord);
+        floatBrdfs << brdf << std::endl;
+        floatMatch = floatMatch && (brdf - expected).cwiseAbs().maxCoeff() <= tolerance;
+    }
+    ret << coefficients.str() << floatBrdfs.str() << singleMatch << std::endl << batchMatch << std::endl
+        << coefficientsMatch << std::endl << floatMatch;
+
+    // Files of other types or dimension, truncated files and missing references are refused : one line each
+    bool wrongStorageRefused = false, wrongDimensionRefused = false, truncatedRefused = false, errorsRefused = false;
+    std::ifstream source(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    std::ofstream(truncatedPath, std::ios::binary).write(bytes.data(), bytes.size() - 8);
+    try {
+        ChefDevr::BRDFReconstructorMapped<double, Eigen::Dynamic, float> wrongStorage(path);
+    } catch (const ChefDevr::ModelFileError&) {
+        wrongStorageRefused = true;
+    }
+    try {
+        ChefDevr::BRDFReconstructorMapped<double, 3> wrongDimension(path);
+    } catch (const ChefDevr::ModelFileError&) {
+        wrongDimensionRefused = true;
+    }
+    try {
+        ChefDevr::BRDFReconstructorMapped<double> truncated(truncatedPath);
+    } catch (const ChefDevr::ModelFileError&) {
+        truncatedRefused = true;
+    }
+    try {
+        ChefDevr::Matrix<double> errors;
+        mapped.reconstructionErrors(errors);
+    } catch (const ChefDevr::ModelFileError&) {
+        errorsRefused = true;
+    }
+    std::remove(path.c_str());
+    std::remove(floatPath.c_str());
+    std::remove(truncatedPath.c_str());
+    ret << std::endl << wrongStorageRefused << std::endl << wrongDimensionRefused << std::endl << truncatedRefused
+        << std::endl << errorsRefused;
+    return std::istringstream(ret.str());
+}
@@ -11,8 +11,16 @@ private:
         static std::istringstream testComputeCovVector(std::istream&);
         static std::istringstream testReconstructWithoutMean(std::istream&);
         static std::istringstream testCenter(std::istream&);
+        static std::istringstream testDeterministicSum(std::istream&);
         static std::istringstream testReconstructionError(std::istream&);
         static std::istringstream testReconstruct(std::istream&);
+        static std::istringstream testReconstructBatch(std::istream&);
+        static std::istringstream testReducedStorage(std::istream&);
+        static std::istringstream testLowRank(std::istream&);
+        static std::istringstream testPointQuery(std::istream&);
+        static std::istringstream testReconstructionErrors(std::istream&);
+        static std::istringstream testReconstructionCache(std::istream&);
+        static std::istringstream testModelFile(std::istream&);
 };
 
 #endif // PARAMETRISATIONTEST_H
@@ -0,0 +1,152 @@
+#include "ServerTest.h"
+#include "Parametrisation/Parametrisation.h"
+#include "Parametrisation/types.h"
+#include "Parametrisation/ParametrisationWithZ.h"
+#include "Server/ReconstructionServer.h"
+#include "Server/ReconstructionClient.h"
+#include <Eigen/Cholesky>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+
+ServerTest::ServerTest(): BaseTest("Server") {
+    addTest(&testRoundTrip, "RoundTrip1", "../tests/data/Server/serverTestSet1", "../tests/data/Server/GT_serverTestSet1");
+    addTest(&testSocketPath, "SocketPath1", "../tests/data/Server/socketTestSet1", "../tests/data/Server/GT_socketTestSet1");
+}
+
+std::istringstream ServerTest::testRoundTrip(std::istream& istr) {
+    uint dim, nb_data, nb_coefs, nb_points;
+    istr >> dim >> nb_data >> nb_coefs;
+    ChefDevr::Vector<double> X(dim*nb_data);
+    ChefDevr::Matrix<double> Z(nb_data, nb_coefs);
+    for(uint i=0; i<dim*nb_data; i++) {
+        istr >> X[i];
+    }
+    for(uint i=0; i<nb_data; i++) {
+        for(uint j=0; j<nb_coefs; j++) {
+            istr >> Z(i, j);
+        }
+    }
+    istr >> nb_points;
+    std::vector<std::vector<double>> coords(nb_points, std::vector<double>(dim));
+    for(uint p=0; p<nb_points; p++) {
+        for(uint c=0; c<dim; c++) {
+            istr >> coords[p][c];
+        }
+    }
+    ChefDevr::Matrix<double> K;
+    ChefDevr::RowVector<double> meanBRDF;
+    ChefDevr::centerMat(Z, meanBRDF);
+    ChefDevr::computeCovMatrix<double>(K, X, dim);
+    const ChefDevr::Matrix<double> K_minus1(K.llt().solve(ChefDevr::Matrix<double>::Identity(nb_data, nb_data)));
+    const ChefDevr::BRDFReconstructorWithZ<double> reconstructor(Z, K_minus1, X, meanBRDF, dim);
+
+    const std::string socketPath("/tmp/brdf3000_test_" + std::to_string(getpid()) + ".sock");
+    ChefDevr::ReconstructionServer<double> server(reconstructor, 4, std::chrono::microseconds(100000));
+    std::thread serving([&]() { server.run(socketPath); });
+    // The client waits until the server listens
+    std::unique_ptr<ChefDevr::ReconstructionClient> client;
+    for(uint attempt=0; !client && attempt<100; attempt++) {
+        try {
+            client.reset(new ChefDevr::ReconstructionClient(socketPath));
+        } catch (const ChefDevr::UnixSocket::SocketError&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    if (!client) {
+        server.requestStop();
+        serving.join();
+        return std::istringstream(std::to_string(false));
+    }
+
+    // One line per value or check
+    const ChefDevr::ModelInfo info(client->info());
+    std::stringstream ret;
+    ret << info.latentDim << " " << info.nbBRDFs << " " << info.nbCoefficients << std::endl;
+
+    // Concurrent connections share batches, each one receives its own BRDF
+    std::vector<std::vector<double>> brdfs(nb_points);
+    std::vector<std::thread> clients;
+    for(uint p=0; p<nb_points; p++) {
+        clients.emplace_back([&, p]() {
+            ChefDevr::ReconstructionClient(socketPath).reconstruct(brdfs[p], coords[p]);
+        });
+    }
+    for(auto& thread : clients) {
+        thread.join();
+    }
+    for(uint p=0; p<nb_points; p++) {
+        for(const double value : brdfs[p]) {
+            ret << value << " ";
+        }
+        ret << std::endl;
+    }
+    ret << server.getBatchedRequests() << std::endl << (server.getBatches() < nb_points) << std::endl;
+
+    std::vector<double> errors;
+    client->reconstructionErrors(errors);
+    ChefDevr::Matrix<double> expected;
+    reconstructor.reconstructionErrors(expected);
+    bool errorsMatch = errors.size() == 4 * nb_data;
+    for(uint i=0; errorsMatch && i<nb_data; i++) {
+        for(uint c=0; c<4; c++) {
+            errorsMatch = errorsMatch && errors[4*i + c] == expected(i, c);
+        }
+    }
+    ret << errors.size() << std::endl << errorsMatch << std::endl;
+
+    // Malformed requests and requests the model does not support are refused, the connection stays usable
+    bool malformedRefused = false;
+    try {
+        client->reconstruct(brdfs[0], std::vector<double>(dim + 1));
+    } catch (const ChefDevr::ReconstructionClient::ClientError&) {
+        malformedRefused = true;
+    }
+    bool lookupRefused = false;
+    try {
+        std::vector<double> colors;
+        client->lookup(colors, coords[0], std::vector<double>(4));
+    } catch (const ChefDevr::ReconstructionClient::ClientError&) {
+        lookupRefused = true;
+    }
+    ret << malformedRefused << std::endl << lookupRefused << std::endl << client->info().latentDim << std::endl;
+
+    client->shutdown();
+    serving.join();
+    ret << (access(socketPath.c_str(), F_OK) != 0);
+    return std::istringstream(ret.str());
+}
+
+std::istringstream ServerTest::testSocketPath(std::istream& istr) {
+    std::string prefix;
+    istr >> prefix;
+    const std::string path(prefix + "_" + std::to_string(getpid()));
+    const auto listens = [&path]() {
+        try {
+            ChefDevr::UnixSocket::listen(path);
+            return true;
+        } catch (const ChefDevr::UnixSocket::SocketError&) {
+            return false;
+        }
+    };
+    std::stringstream ret;
+
+    // A file that is not a socket is neither replaced nor listened on
+    std::ofstream(path) << "not a socket";
+    ret << !listens() << std::endl;
+    ret << (access(path.c_str(), F_OK) == 0) << std::endl;
+    unlink(path.c_str());
+
+    // The socket of a running server is kept
+    {
+        const ChefDevr::UnixSocket server(ChefDevr::UnixSocket::listen(path));
+        ret << !listens() << std::endl;
+    }
+
+    // The socket file left by a stopped server is replaced
+    ret << listens() << std::endl;
+    unlink(path.c_str());
+    return std::istringstream(ret.str());
+}
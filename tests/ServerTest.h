@@ -0,0 +1,14 @@
+#ifndef SERVERTEST_H
+#define SERVERTEST_H
+
+#include "BaseTest.h"
+
+class ServerTest : public BaseTest{
+public:
+    ServerTest();
+private:
+    static std::istringstream testRoundTrip(std::istream&);
+    static std::istringstream testSocketPath(std::istream&);
+};
+
+#endif // SERVERTEST_H
@@ -0,0 +1,24 @@
+name_file = 'gradientSet1';
+
+num_rows = 10;
+d = 20;
+latent_dim = 2;
+
+#num_rows
+dlmwrite(name_file, num_rows);
+
+#num_cols
+dlmwrite(name_file, d, ' ', 1, "-append");
+
+#latent_dim
+dlmwrite(name_file, latent_dim, ' ', 1, "-append");
+
+#Z
+Z = rand(num_rows, d);
+dlmwrite(name_file, Z, ' ', 1, "-append", "precision", "%.20f");
+
+#X
+X = rand(1, num_rows * latent_dim) .* 1.6 - 0.8;
+dlmwrite(name_file, X, ' ', 1, "-append", "precision", "%.20f");
+
+# The output, the gradient of the cost at X, is written by ../../reference.py
@@ -0,0 +1,463 @@
+#!/usr/bin/env python3
+"""
+Independent reference of the numeric outputs of the tests.
+
+Reads the test sets and writes their ground truth files, computed from the formulas of the research
+paper with 50 significant digits (standard library only, no code shared with the C++ sources).
+The values are written with 6 significant digits, the default precision of the C++ streams.
+
+Usage (from any folder) : python3 reference.py
+"""
+
+import decimal
+import math
+import os
+import struct
+from decimal import Decimal as D
+
+decimal.getcontext().prec = 50
+
+DATA = os.path.dirname(os.path.abspath(__file__))
+
+# MU_DEFAULT and L_DEFAULT are float literals
+MU = D(struct.unpack('f', struct.pack('f', 0.0001))[0])
+L = D(1)
+
+
+def tokens(path):
+    with open(os.path.join(DATA, path)) as f:
+        return iter(f.read().split())
+
+
+def read(it, count):
+    return [D(next(it)) for _ in range(count)]
+
+
+def fmt(value):
+    return '{:.6g}'.format(float(value))
+
+
+def write(path, lines):
+    with open(os.path.join(DATA, path), 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+# Linear algebra on lists of rows
+
+def matmul(A, B):
+    Bt = list(zip(*B))
+    return [[sum(a * b for a, b in zip(row, col)) for col in Bt] for row in A]
+
+
+def transpose(A):
+    return [list(col) for col in zip(*A)]
+
+
+def determinant(A):
+    """Gaussian elimination with partial pivoting"""
+    n = len(A)
+    M = [list(row) for row in A]
+    det = D(1)
+    for c in range(n):
+        p = max(range(c, n), key=lambda r: abs(M[r][c]))
+        if p != c:
+            M[c], M[p] = M[p], M[c]
+            det = -det
+        det *= M[c][c]
+        for r in range(c + 1, n):
+            f = M[r][c] / M[c][c]
+            M[r] = [v - f * w for v, w in zip(M[r], M[c])]
+    return det
+
+
+def inverse(A):
+    """Gauss-Jordan elimination with partial pivoting"""
+    n = len(A)
+    M = [list(row) + [D(int(i == j)) for j in range(n)] for i, row in enumerate(A)]
+    for c in range(n):
+        p = max(range(c, n), key=lambda r: abs(M[r][c]))
+        M[c], M[p] = M[p], M[c]
+        pivot = M[c][c]
+        M[c] = [v / pivot for v in M[c]]
+        for r in range(n):
+            if r != c and M[r][c] != 0:
+                f = M[r][c]
+                M[r] = [v - f * w for v, w in zip(M[r], M[c])]
+    return [row[n:] for row in M]
+
+
+def eigen(A, sweeps=50):
+    """
+    Cyclic Jacobi eigen decomposition of a symmetric matrix
+    :return: the eigen values in increasing order and the matching eigen vectors as columns
+    """
+    n = len(A)
+    A = [list(row) for row in A]
+    V = [[D(int(i == j)) for j in range(n)] for i in range(n)]
+    threshold = D(10) ** (-decimal.getcontext().prec + 5)
+    for _ in range(sweeps):
+        off = sum(A[i][j] ** 2 for i in range(n) for j in range(n) if i != j)
+        if off <= threshold * sum(A[i][i] ** 2 for i in range(n)):
+            break
+        for p in range(n - 1):
+            for q in range(p + 1, n):
+                if A[p][q] == 0:
+                    continue
+                theta = (A[q][q] - A[p][p]) / (2 * A[p][q])
+                t = (1 if theta >= 0 else -1) / (abs(theta) + (theta * theta + 1).sqrt())
+                c = 1 / (t * t + 1).sqrt()
+                s = t * c
+                for k in range(n):
+                    A[k][p], A[k][q] = c * A[k][p] - s * A[k][q], s * A[k][p] + c * A[k][q]
+                for k in range(n):
+                    A[p][k], A[q][k] = c * A[p][k] - s * A[q][k], s * A[p][k] + c * A[q][k]
+                for k in range(n):
+                    V[k][p], V[k][q] = c * V[k][p] - s * V[k][q], s * V[k][p] + c * V[k][q]
+    order = sorted(range(n), key=lambda i: A[i][i])
+    return [A[i][i] for i in order], [[row[i] for i in order] for row in V]
+
+
+# Gaussian process
+
+def covariance(x1, x2, mu=MU, l=L):
+    sqnorm = sum((a - b) ** 2 for a, b in zip(x1, x2))
+    value = (-sqnorm / (2 * l * l)).exp()
+    return value + mu if sqnorm == 0 else value
+
+
+def latent(X, dim):
+    return [X[i:i + dim] for i in range(0, len(X), dim)]
+
+
+def cov_matrix(points):
+    return [[covariance(a, b) for b in points] for a in points]
+
+
+def read_reconstruction(path):
+    """
+    Reads latent variables, BRDFs and latent space points (see readReconstructionData in ParametrisationTest.cpp)
+    :return: the model, the points and the iterator on the rest of the set
+    """
+    it = tokens(path)
+    dim, n, nb_coefs = int(next(it)), int(next(it)), int(next(it))
+    points = latent(read(it, n * dim), dim)
+    Z = [read(it, nb_coefs) for _ in range(n)]
+    coords = latent(read(it, int(next(it)) * dim), dim)
+    return Model(points, Z), coords, it
+
+
+class Model:
+    """Reconstruction of the BRDFs : cov(x) K^-1 Zcentered + mean"""
+
+    def __init__(self, points, Z):
+        n = len(Z)
+        self.points = points
+        self.mean = [sum(col) / n for col in zip(*Z)]
+        self.Zc = [[z - m for z, m in zip(row, self.mean)] for row in Z]
+        self.Km1 = inverse(cov_matrix(points))
+        self.Km1Zc = matmul(self.Km1, self.Zc)
+
+    def cov(self, coord):
+        return [covariance(coord, x) for x in self.points]
+
+    def reconstruct(self, coord, mapping=None):
+        mapping = mapping or self.Km1Zc
+        return [m + v for m, v in zip(self.mean, matmul([self.cov(coord)], mapping)[0])]
+
+
+def covariance_vectors():
+    """Covariance vector of a latent space point, once for the fixed dimension and once for the dynamic one"""
+    for test in ('covVectorTestSet1', 'covVectorTestSet2'):
+        it = tokens('Parametrisation/' + test)
+        dim, n = int(next(it)), int(next(it))
+        points = latent(read(it, n * dim), dim)
+        coord = read(it, dim)
+        cov = [fmt(covariance(coord, x)) for x in points]
+        write('Parametrisation/GT_' + test, cov + cov)
+
+
+def deterministic_sum():
+    """
+    Sum of the values, then one line per check : the sums with 3, 5 and 7 threads are the one with 1 thread,
+    and a single chunk is the pairwise sum
+    """
+    it = tokens('Parametrisation/reductionTestSet1')
+    values = read(it, int(next(it)))
+    write('Parametrisation/GT_reductionTestSet1', [fmt(sum(values))] + ['1'] * 4)
+
+
+def reconstructions(path):
+    """BRDFs of the latent space points of a test set, one per line"""
+    model, coords, _ = read_reconstruction(path)
+    return [' '.join(fmt(v) for v in model.reconstruct(c)) for c in coords]
+
+
+def reconstruct_batch():
+    """
+    Size of the batch and the BRDFs of the latent space points reconstructed by the batch, then one by one,
+    then 1 and the number of coefficients : the blocks are in order and cover the BRDFs, then the BRDFs of the blocks
+    """
+    model, coords, _ = read_reconstruction('Parametrisation/reconstructBatchTestSet1')
+    brdfs = reconstructions('Parametrisation/reconstructBatchTestSet1')
+    write('Parametrisation/GT_reconstructBatchTestSet1',
+          ['{} {}'.format(len(coords), len(model.mean))] + brdfs + brdfs + ['1 {}'.format(len(model.mean))] + brdfs)
+
+
+def server():
+    """
+    Latent dimension, number of BRDFs and of coefficients served, the BRDFs received from the server,
+    the number of batched requests and 1 : they share batches, the number of errors and 1 : they are the ones
+    of the model, then 1 twice : malformed and lookup requests are refused, the latent dimension served afterwards
+    and 1 : the socket is removed
+    """
+    model, coords, _ = read_reconstruction('Server/serverTestSet1')
+    dim, n = len(model.points[0]), len(model.points)
+    write('Server/GT_serverTestSet1',
+          ['{} {} {}'.format(dim, n, len(model.mean))] + reconstructions('Server/serverTestSet1') +
+          [str(len(coords)), '1', str(4 * n), '1', '1', '1', str(dim), '1'])
+
+
+def socket_path():
+    """One line per check : a file is not replaced and is kept, a running socket is kept, a stale socket is replaced"""
+    write('Server/GT_socketTestSet1', ['1'] * 4)
+
+
+def to_float(value):
+    return D(struct.unpack('f', struct.pack('f', float(value)))[0])
+
+
+def reduced_storage():
+    """
+    BRDFs of the latent space points reconstructed from K^-1 Zcentered stored in float, then the largest deviation
+    due to the storage at the latent variables reported by the reconstructor, then measured on single reconstructions,
+    then the deviation reported without reduced storage
+    """
+    model, coords, _ = read_reconstruction('Parametrisation/reducedStorageTestSet1')
+    stored = [[to_float(v) for v in row] for row in model.Km1Zc]
+    rounding = [[e - s for e, s in zip(exact, row)] for exact, row in zip(model.Km1Zc, stored)]
+    deviation = max(abs(v) for x in model.points for v in matmul([model.cov(x)], rounding)[0])
+    write('Parametrisation/GT_reducedStorageTestSet1',
+          [' '.join(fmt(v) for v in model.reconstruct(c, stored)) for c in coords] + [fmt(deviation), fmt(deviation), '0'])
+
+
+def truncate(model, tolerance):
+    """
+    Truncation of the reconstruction to the main eigen vectors A of K^-1 Zcentered Zcenteredt K^-1
+    :return: the rank, the relative error and A At K^-1 Zcentered
+    """
+    n = len(model.points)
+    energies, vectors = eigen(matmul(model.Km1Zc, transpose(model.Km1Zc)))
+    energies = [max(e, D(0)) for e in energies]
+    total = sum(energies)
+    rank, discarded = n, D(0)
+    while rank > 1 and discarded + energies[n - rank] <= tolerance * tolerance * total:
+        discarded += energies[n - rank]
+        rank -= 1
+    A = [row[n - rank:] for row in vectors]
+    return rank, (discarded / total).sqrt(), matmul(A, matmul(transpose(A), model.Km1Zc))
+
+
+def low_rank():
+    """
+    Rank, relative error and BRDFs of the latent space points of the truncated reconstruction, batched then single,
+    then for the reconstruction without tolerance : 1 (at most the null space is dropped), its relative error 0,
+    and 1 (it is the full reconstruction)
+    """
+    model, coords, it = read_reconstruction('Parametrisation/lowRankTestSet1')
+    rank, error, mapping = truncate(model, D(next(it)))
+    brdfs = [' '.join(fmt(v) for v in model.reconstruct(c, mapping)) for c in coords]
+    write('Parametrisation/GT_lowRankTestSet1', [str(rank), fmt(error)] + brdfs + brdfs + ['1', '0', '1'])
+
+
+def reconstruction_errors():
+    """
+    Mean square errors of the truncated reconstruction of each BRDF, on the whole BRDF then on each channel,
+    then one line per check, for the full then the truncated reconstructor : the errors computed at once match
+    the ones of each BRDF, the errors of the channels add up to the error of the whole BRDF
+    """
+    model, _, it = read_reconstruction('Parametrisation/reconstructionErrorsTestSet1')
+    _, _, mapping = truncate(model, D(next(it)))
+    nb_coefs = len(model.mean)
+    channels = [range(c * nb_coefs // 3, (c + 1) * nb_coefs // 3) for c in range(3)]
+    lines = []
+    for x, z in zip(model.points, model.Zc):
+        squares = [(r - m - v) ** 2 for r, m, v in zip(model.reconstruct(x, mapping), model.mean, z)]
+        errors = [sum(squares) / nb_coefs] + [sum(squares[k] for k in channel) / len(channel) for channel in channels]
+        lines.append(' '.join(fmt(e) for e in errors))
+    write('Parametrisation/GT_reconstructionErrorsTestSet1', lines + ['1'] * 4)
+
+
+def reconstruction_cache():
+    """
+    Hits, misses and size of a cache holding 2 BRDFs, the capacity left beside a grid, then the mean square
+    error of the reconstruction at the centre of each cell of the grid interpolated by the average of its corners,
+    then one line per check : the first query and a nearby hit give the reconstruction at the quantised
+    coordinates, the grid is refused without room, the grid is exact at its nodes, the cells are interpolated
+    below the error bound only and with the measured error, both interpolated and reconstructed cells are used,
+    and points out of the grid are not interpolated
+    """
+    model, _, it = read_reconstruction('Parametrisation/reconstructionCacheTestSet1')
+    _, resolution = D(next(it)), int(next(it))
+    dim = len(model.points[0])
+    lower, step = D('-1.5'), D(3) / (resolution - 1)
+    errors = []
+    for cell in range((resolution - 1) ** dim):
+        index = [cell // (resolution - 1) ** c % (resolution - 1) for c in range(dim)]
+        center = [lower + (i + D('0.5')) * step for i in index]
+        corners = [[lower + (i + (corner >> c & 1)) * step for c, i in enumerate(index)] for corner in range(2 ** dim)]
+        brdfs = [model.reconstruct(x) for x in corners]
+        interpolated = [sum(values) / len(brdfs) for values in zip(*brdfs)]
+        errors.append(sum((r - v) ** 2 for r, v in zip(model.reconstruct(center), interpolated)) / len(interpolated))
+    write('Parametrisation/GT_reconstructionCacheTestSet1', ['1 4 2 2', ' '.join(fmt(e) for e in errors)] + ['1'] * 9)
+
+
+# MERL sampling of the half and difference angles
+
+THETA_H, THETA_D, PHI_D = 90, 90, 360
+CHANNEL_STRIDE = THETA_H * THETA_D * PHI_D // 2
+SCALES = (1.0 / 1500.0, 1.15 / 1500.0, 1.66 / 1500.0)
+
+
+def direction(theta, phi):
+    v = (math.sin(theta) * math.cos(phi), math.sin(theta) * math.sin(phi), math.cos(theta))
+    norm = math.sqrt(sum(c * c for c in v))
+    return [c / norm for c in v]
+
+
+def rotate(v, axis, angle):
+    dot = sum(a * b for a, b in zip(axis, v))
+    cross = (axis[1] * v[2] - axis[2] * v[1], axis[2] * v[0] - axis[0] * v[2], axis[0] * v[1] - axis[1] * v[0])
+    return [c * math.cos(angle) + a * dot * (1 - math.cos(angle)) + x * math.sin(angle)
+            for c, a, x in zip(v, axis, cross)]
+
+
+def lookup_index(theta_in, phi_in, theta_out, phi_out):
+    """Index of the red coefficient of a pair of directions in a MERL BRDF"""
+    w_in, w_out = direction(theta_in, phi_in), direction(theta_out, phi_out)
+    half = [(a + b) * 0.5 for a, b in zip(w_in, w_out)]
+    norm = math.sqrt(sum(c * c for c in half))
+    half = [c / norm for c in half]
+    theta_half, phi_half = math.acos(half[2]), math.atan2(half[1], half[0])
+    diff = rotate(rotate(w_in, (0, 0, 1), -phi_half), (0, 1, 0), -theta_half)
+    theta_diff, phi_diff = math.acos(diff[2]), math.atan2(diff[1], diff[0])
+    half_index = 0 if theta_half <= 0 else min(max(int(math.sqrt(theta_half / (math.pi / 2) * THETA_H * THETA_H)), 0),
+                                               THETA_H - 1)
+    diff_index = min(max(int(theta_diff / (math.pi * 0.5) * THETA_D), 0), THETA_D - 1)
+    if phi_diff < 0:
+        phi_diff += math.pi
+    phi_index = min(max(int(phi_diff / math.pi * PHI_D / 2), 0), PHI_D // 2 - 1)
+    return phi_index + diff_index * PHI_D // 2 + half_index * PHI_D // 2 * THETA_D
+
+
+def point_query():
+    """
+    Coefficients of the latent space points reconstructed by the full then the low rank reconstructor,
+    then one line per check : the coefficients of each reconstructor are the ones of its whole reconstructed BRDFs,
+    the lookups read lookup_index, then the red, green and blue values of directions looked up in the BRDF
+    whose k-th coefficient is k+1
+    """
+    model, coords, it = read_reconstruction('Parametrisation/pointQueryTestSet1')
+    indices = [int(next(it)) for _ in range(int(next(it)))]
+    values = [' '.join(fmt(brdf[k]) for k in indices) for brdf in (model.reconstruct(c) for c in coords)]
+    lines = values + values + ['1'] * 3
+    for _ in range(int(next(it))):
+        index = lookup_index(*(float(next(it)) for _ in range(4)))
+        lines.append(' '.join('{:.10g}'.format((index + c * CHANNEL_STRIDE + 1.0) * scale)
+                              for c, scale in enumerate(SCALES)))
+    write('Parametrisation/GT_pointQueryTestSet1', lines)
+
+
+def model_file():
+    """
+    Latent dimension, number of BRDFs and of coefficients and storage size in the header of a model file storing
+    K^-1 Zcentered in float, 1 twice : the filenames and latent variables are mapped, the latent dimension and
+    number of coefficients of the mapped model, then the BRDFs of the latent space points mapped from a model file,
+    their coefficients 0, 3 and the last one, the BRDFs mapped from the float model, then one line per check :
+    the single, batch, coefficient and float reconstructions match the ones in memory, then files of another
+    storage, of another dimension, truncated files and missing references are refused
+    """
+    model, coords, _ = read_reconstruction('Parametrisation/modelFileTestSet1')
+    brdfs = [model.reconstruct(c) for c in coords]
+    stored = [[to_float(v) for v in row] for row in model.Km1Zc]
+    dim, nb_coefs = len(model.points[0]), len(model.mean)
+    indices = (0, 3, nb_coefs - 1)
+    write('Parametrisation/GT_modelFileTestSet1',
+          ['{} {} {} 4'.format(dim, len(model.points), nb_coefs), '1', '1', '{} {}'.format(dim, nb_coefs)] +
+          [' '.join(fmt(v) for v in brdf) for brdf in brdfs] +
+          [' '.join(fmt(brdf[k]) for k in indices) for brdf in brdfs] +
+          [' '.join(fmt(v) for v in model.reconstruct(c, stored)) for c in coords] + ['1'] * 8)
+
+
+def gradient():
+    """Gradient of the cost 1/2 (D log|K| + tr(K^-1 Z Zt)) with respect to the latent coordinates"""
+    it = tokens('Optimisation/gradient/gradientSet1')
+    n, d, dim = int(next(it)), int(next(it)), int(next(it))
+    Z = [read(it, d) for _ in range(n)]
+    points = latent(read(it, n * dim), dim)
+    K = cov_matrix(points)
+    Km1 = inverse(K)
+    Km1_ZZt_Km1 = matmul(matmul(Km1, matmul(Z, transpose(Z))), Km1)
+    # dcost/dK = 1/2 (D K^-1 - K^-1 ZZt K^-1), dK_ij/dx_ic = -(x_ic - x_jc) / l^2 K_ij
+    H = [[(d * Km1[i][j] - Km1_ZZt_Km1[i][j]) * K[i][j] for j in range(n)] for i in range(n)]
+    grad = [-sum(H[i][j] * (points[i][c] - points[j][c]) for j in range(n)) / (L * L)
+            for i in range(n) for c in range(dim)]
+    write('Optimisation/gradient/gradientSet1_output', [fmt(g) for g in grad])
+
+
+def optimisation_cost(ZZt, X, dim, d):
+    """Cost 1/2 (D log|K| + tr(K^-1 Z Zt)) of latent variables"""
+    K = cov_matrix(latent(X, dim))
+    Km1 = inverse(K)
+    trace = sum(Km1[i][j] * ZZt[j][i] for i in range(len(K)) for j in range(len(K)))
+    return (d * determinant(K).ln() + trace) / 2
+
+
+def speculative_correction():
+    """Cost change of the +step move of j after the +step move of i, for each pair (i, j)"""
+    it = tokens('Optimisation/speculative/speculativeSet1')
+    n, d, dim = int(next(it)), int(next(it)), int(next(it))
+    Z = [read(it, d) for _ in range(n)]
+    ZZt = matmul(Z, transpose(Z))
+    X = read(it, n * dim)
+    step = D(next(it))
+    lines = []
+    for _ in range(int(next(it))):
+        i, j = int(next(it)), int(next(it))
+        moved = list(X)
+        moved[i] += step
+        before = optimisation_cost(ZZt, moved, dim, d)
+        moved[j] += step
+        lines.append(fmt(optimisation_cost(ZZt, moved, dim, d) - before))
+    write('Optimisation/speculative/speculativeSet1_output', lines)
+
+
+def covariance_update():
+    """Covariance vector of the moving latent variable after each move of each coordinate by +step then -step"""
+    it = tokens('Optimisation/covarianceUpdate/covarianceUpdateSet1')
+    n, dim, step = int(next(it)), int(next(it)), D(next(it))
+    points = latent(read(it, n * dim), dim)
+    lines = []
+    for i in range(n * dim):
+        for move in (step, -step):
+            moved = list(points[i // dim])
+            moved[i % dim] += move
+            # The covariance of a latent variable with itself does not depend on its position
+            lines.append(' '.join(fmt(covariance(moved, x) if j != i // dim else 1 + MU) for j, x in enumerate(points)))
+    write('Optimisation/covarianceUpdate/covarianceUpdateSet1_output', lines)
+
+
+if __name__ == '__main__':
+    covariance_vectors()
+    deterministic_sum()
+    reconstruct_batch()
+    server()
+    socket_path()
+    reduced_storage()
+    low_rank()
+    reconstruction_errors()
+    reconstruction_cache()
+    model_file()
+    point_query()
+    gradient()
+    covariance_update()
+    speculative_correction()
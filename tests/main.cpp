@@ -3,13 +3,16 @@
 #include "BRDFReaderTest.h"
 #include "OptimisationTest.h"
 #include "ParametrisationTest.h"
+#include "ServerTest.h"
 
 int main(){
     ParametrisationTest pt;
     OptimisationTest ot;
     BRDFReaderTest bt;
+    ServerTest st;
     pt.doAllTests(std::cout);
     ot.doAllTests(std::cout);
+    st.doAllTests(std::cout);
     bt.doAllTests(std::cout);
     return 0;
 }